@@ -0,0 +1,310 @@
+#include "aabb_tree.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace sandbox {
+
+  namespace {
+
+    float perimeter(rectangle const & rectangle) {
+      return 2.0f * (rectangle.width() + rectangle.height());
+    }
+
+  }
+
+  int const aabb_tree::null_node;
+
+  void aabb_tree::update(std::vector<rectangle> const & bounding_boxes) {
+    previous_pairs_.swap(pairs_);
+    moved_.clear();
+
+    if(bounding_boxes.size() != leaves_.size()) {
+      nodes_.clear();
+      root_ = null_node;
+      free_ = null_node;
+      leaves_.resize(bounding_boxes.size());
+      for(std::size_t body(0); body < bounding_boxes.size(); ++body) {
+        auto const leaf(allocate_node());
+        nodes_[leaf].box = fatten(bounding_boxes[body]);
+        nodes_[leaf].body = body;
+        insert_leaf(leaf);
+        leaves_[body] = leaf;
+        moved_.push_back(body);
+      }
+    } else {
+      for(std::size_t body(0); body < bounding_boxes.size(); ++body) {
+        auto const leaf(leaves_[body]);
+        if(!nodes_[leaf].box.contains(bounding_boxes[body])) {
+          remove_leaf(leaf);
+          nodes_[leaf].box = fatten(bounding_boxes[body]);
+          insert_leaf(leaf);
+          moved_.push_back(body);
+        }
+      }
+    }
+    reinserted_ = moved_.size();
+
+    moved_flags_.assign(bounding_boxes.size(), 0);
+    for(auto const body : moved_) {
+      moved_flags_[body] = 1;
+    }
+
+    // Fat boxes of bodies that stayed put did not change, neither did their pairs
+    retained_pairs_.clear();
+    for(auto const & pair : previous_pairs_) {
+      if(pair.second < moved_flags_.size() && !moved_flags_[pair.first] && !moved_flags_[pair.second]) {
+        retained_pairs_.push_back(pair);
+      }
+    }
+
+    pair_buffers_.clear();
+    parallel_for(0, moved_.size(), [&](std::size_t const index) {
+      auto const body(moved_[index]);
+      auto & buffer(pair_buffers_.local());
+      auto report([&](std::size_t const other) {
+        // Two moved bodies find each other, the lower index reports the pair
+        if(other != body && (!moved_flags_[other] || body < other)) {
+          buffer.emplace_back(std::min(body, other), std::max(body, other));
+        }
+      });
+      query(root_, nodes_[leaves_[body]].box, report);
+    });
+    pair_buffers_.merge(queried_pairs_);
+
+    pairs_.clear();
+    std::merge(retained_pairs_.begin(), retained_pairs_.end(), queried_pairs_.begin(), queried_pairs_.end(), std::back_inserter(pairs_));
+
+    added_.clear();
+    removed_.clear();
+    std::set_difference(pairs_.begin(), pairs_.end(), previous_pairs_.begin(), previous_pairs_.end(), std::back_inserter(added_));
+    std::set_difference(previous_pairs_.begin(), previous_pairs_.end(), pairs_.begin(), pairs_.end(), std::back_inserter(removed_));
+  }
+
+  void aabb_tree::insert(std::size_t const body, rectangle const & bounding_box) {
+    if(body >= leaves_.size()) leaves_.resize(body + 1, null_node);
+    auto const leaf(allocate_node());
+    nodes_[leaf].box = bounding_box;
+    nodes_[leaf].body = body;
+    insert_leaf(leaf);
+    leaves_[body] = leaf;
+  }
+
+  void aabb_tree::remove(std::size_t const body) {
+    auto const leaf(leaves_[body]);
+    remove_leaf(leaf);
+    free_node(leaf);
+    leaves_[body] = null_node;
+  }
+
+  rectangle aabb_tree::fatten(rectangle const & bounding_box) const {
+    vector const margin(margin_, margin_);
+    return rectangle(bounding_box.top_left() - margin, bounding_box.bottom_right() + margin);
+  }
+
+  int aabb_tree::allocate_node() {
+    int index;
+    if(free_ != null_node) {
+      index = free_;
+      free_ = nodes_[index].parent;
+    } else {
+      index = static_cast<int>(nodes_.size());
+      nodes_.emplace_back();
+    }
+
+    auto & node(nodes_[index]);
+    node.parent = null_node;
+    node.left = null_node;
+    node.right = null_node;
+    node.height = 0;
+    node.body = 0;
+    return index;
+  }
+
+  void aabb_tree::free_node(int const index) {
+    nodes_[index].parent = free_;
+    nodes_[index].height = -1;
+    free_ = index;
+  }
+
+  void aabb_tree::insert_leaf(int const leaf) {
+    if(root_ == null_node) {
+      root_ = leaf;
+      nodes_[root_].parent = null_node;
+      return;
+    }
+
+    // Descend towards the sibling that grows the total perimeter the least
+    auto const box(nodes_[leaf].box);
+    auto index(root_);
+    while(!nodes_[index].leaf()) {
+      auto const & node(nodes_[index]);
+      auto const combined(perimeter(rectangle::create_union(node.box, box)));
+      auto const cost(2.0f * combined);
+      auto const inheritance(2.0f * (combined - perimeter(node.box)));
+
+      auto const child_cost([&](int const child) {
+        auto const & child_node(nodes_[child]);
+        auto const grown(perimeter(rectangle::create_union(child_node.box, box)));
+        return (child_node.leaf() ? grown : grown - perimeter(child_node.box)) + inheritance;
+      });
+      auto const left_cost(child_cost(node.left));
+      auto const right_cost(child_cost(node.right));
+
+      if(cost < left_cost && cost < right_cost) break;
+      index = left_cost < right_cost ? node.left : node.right;
+    }
+
+    auto const sibling(index);
+    auto const old_parent(nodes_[sibling].parent);
+    auto const new_parent(allocate_node());
+    nodes_[new_parent].parent = old_parent;
+    nodes_[new_parent].box = rectangle::create_union(box, nodes_[sibling].box);
+    nodes_[new_parent].height = nodes_[sibling].height + 1;
+    nodes_[new_parent].left = sibling;
+    nodes_[new_parent].right = leaf;
+    nodes_[sibling].parent = new_parent;
+    nodes_[leaf].parent = new_parent;
+
+    if(old_parent == null_node) {
+      root_ = new_parent;
+    } else if(nodes_[old_parent].left == sibling) {
+      nodes_[old_parent].left = new_parent;
+    } else {
+      nodes_[old_parent].right = new_parent;
+    }
+
+    refit(nodes_[leaf].parent);
+  }
+
+  void aabb_tree::remove_leaf(int const leaf) {
+    if(leaf == root_) {
+      root_ = null_node;
+      return;
+    }
+
+    auto const parent(nodes_[leaf].parent);
+    auto const grand_parent(nodes_[parent].parent);
+    auto const sibling(nodes_[parent].left == leaf ? nodes_[parent].right : nodes_[parent].left);
+
+    if(grand_parent == null_node) {
+      root_ = sibling;
+      nodes_[sibling].parent = null_node;
+      free_node(parent);
+      return;
+    }
+
+    if(nodes_[grand_parent].left == parent) {
+      nodes_[grand_parent].left = sibling;
+    } else {
+      nodes_[grand_parent].right = sibling;
+    }
+    nodes_[sibling].parent = grand_parent;
+    free_node(parent);
+
+    refit(grand_parent);
+  }
+
+  void aabb_tree::refit(int index) {
+    while(index != null_node) {
+      index = balance(index);
+
+      auto & node(nodes_[index]);
+      auto const & left(nodes_[node.left]);
+      auto const & right(nodes_[node.right]);
+      node.height = 1 + std::max(left.height, right.height);
+      node.box = rectangle::create_union(left.box, right.box);
+
+      index = node.parent;
+    }
+  }
+
+  int aabb_tree::balance(int const index) {
+    auto & a(nodes_[index]);
+    if(a.leaf() || a.height < 2) return index;
+
+    auto const b_index(a.left);
+    auto const c_index(a.right);
+    auto & b(nodes_[b_index]);
+    auto & c(nodes_[c_index]);
+
+    auto const replace_child([&](int const parent, int const child) {
+      if(parent == null_node) {
+        root_ = child;
+      } else if(nodes_[parent].left == index) {
+        nodes_[parent].left = child;
+      } else {
+        nodes_[parent].right = child;
+      }
+    });
+
+    auto const difference(c.height - b.height);
+
+    // Rotate c up
+    if(difference > 1) {
+      auto const f_index(c.left);
+      auto const g_index(c.right);
+      auto & f(nodes_[f_index]);
+      auto & g(nodes_[g_index]);
+
+      c.left = index;
+      c.parent = a.parent;
+      a.parent = c_index;
+      replace_child(c.parent, c_index);
+
+      if(f.height > g.height) {
+        c.right = f_index;
+        a.right = g_index;
+        g.parent = index;
+        a.box = rectangle::create_union(b.box, g.box);
+        c.box = rectangle::create_union(a.box, f.box);
+        a.height = 1 + std::max(b.height, g.height);
+        c.height = 1 + std::max(a.height, f.height);
+      } else {
+        c.right = g_index;
+        a.right = f_index;
+        f.parent = index;
+        a.box = rectangle::create_union(b.box, f.box);
+        c.box = rectangle::create_union(a.box, g.box);
+        a.height = 1 + std::max(b.height, f.height);
+        c.height = 1 + std::max(a.height, g.height);
+      }
+      return c_index;
+    }
+
+    // Rotate b up
+    if(difference < -1) {
+      auto const d_index(b.left);
+      auto const e_index(b.right);
+      auto & d(nodes_[d_index]);
+      auto & e(nodes_[e_index]);
+
+      b.left = index;
+      b.parent = a.parent;
+      a.parent = b_index;
+      replace_child(b.parent, b_index);
+
+      if(d.height > e.height) {
+        b.right = d_index;
+        a.left = e_index;
+        e.parent = index;
+        a.box = rectangle::create_union(c.box, e.box);
+        b.box = rectangle::create_union(a.box, d.box);
+        a.height = 1 + std::max(c.height, e.height);
+        b.height = 1 + std::max(a.height, d.height);
+      } else {
+        b.right = e_index;
+        a.left = d_index;
+        d.parent = index;
+        a.box = rectangle::create_union(c.box, d.box);
+        b.box = rectangle::create_union(a.box, e.box);
+        a.height = 1 + std::max(c.height, d.height);
+        b.height = 1 + std::max(a.height, e.height);
+      }
+      return b_index;
+    }
+
+    return index;
+  }
+
+}
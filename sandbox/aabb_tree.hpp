@@ -0,0 +1,133 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "rectangle.hpp"
+#include "misc.hpp"
+
+namespace sandbox {
+
+  // Dynamic bounding volume hierarchy broadphase. Leaves store bounding boxes
+  // fattened by a margin and a body is only reinserted once its box leaves its
+  // fat box. Insertion picks siblings by perimeter cost and the tree is kept
+  // balanced with rotations. Large static bodies occupy a single leaf no
+  // matter how much of the world they cover.
+  class aabb_tree {
+  public:
+    typedef std::pair<std::size_t, std::size_t> pair_t;
+
+    aabb_tree(float const margin = 2.0f) : margin_(margin), root_(null_node), free_(null_node), reinserted_(0) {
+    }
+
+    float margin() const {
+      return margin_;
+    }
+
+    void margin(float const value) {
+      margin_ = value;
+    }
+
+    int height() const {
+      return root_ == null_node ? 0 : nodes_[root_].height;
+    }
+
+    // Bodies that left their fat box during the last update
+    std::size_t reinserted() const {
+      return reinserted_;
+    }
+
+    // Pairs of bodies whose fat boxes overlap, sorted, each as (a, b) with a < b
+    std::vector<pair_t> const & pairs() const {
+      return pairs_;
+    }
+
+    // Pairs that started or stopped overlapping during the last update
+    std::vector<pair_t> const & added() const {
+      return added_;
+    }
+
+    std::vector<pair_t> const & removed() const {
+      return removed_;
+    }
+
+    void update(std::vector<rectangle> const & bounding_boxes);
+
+    // Maintains the tree body by body instead of through update, for sets
+    // that rarely change. Boxes are stored as given, without a margin.
+    void insert(std::size_t const body, rectangle const & bounding_box);
+    void remove(std::size_t const body);
+
+    // Calls function with every body whose stored box overlaps the rectangle
+    template<typename Function>
+    void query(rectangle const & rectangle, Function function) const {
+      if(root_ != null_node) query(root_, rectangle, function);
+    }
+
+    void clear() {
+      nodes_.clear();
+      root_ = null_node;
+      free_ = null_node;
+      leaves_.clear();
+      pairs_.clear();
+    }
+
+  private:
+    static int const null_node = -1;
+
+    struct node {
+      rectangle box;
+      int parent;
+      int left;
+      int right;
+      int height;
+      std::size_t body;
+
+      bool leaf() const {
+        return left == null_node;
+      }
+    };
+
+    float margin_;
+
+    std::vector<node> nodes_;
+    int root_;
+    int free_;
+    std::vector<int> leaves_;
+
+    std::size_t reinserted_;
+    std::vector<std::size_t> moved_;
+    std::vector<char> moved_flags_;
+
+    std::vector<pair_t> pairs_;
+    std::vector<pair_t> previous_pairs_;
+    std::vector<pair_t> retained_pairs_;
+    std::vector<pair_t> queried_pairs_;
+    thread_buffers<pair_t> pair_buffers_;
+    std::vector<pair_t> added_;
+    std::vector<pair_t> removed_;
+
+    rectangle fatten(rectangle const & bounding_box) const;
+
+    int allocate_node();
+    void free_node(int const index);
+
+    void insert_leaf(int const leaf);
+    void remove_leaf(int const leaf);
+    int balance(int const index);
+    void refit(int index);
+
+    template<typename Function>
+    void query(int const index, rectangle const & rectangle, Function & function) const {
+      auto const & node(nodes_[index]);
+      if(!node.box.overlaps(rectangle)) return;
+      if(node.leaf()) {
+        function(node.body);
+      } else {
+        query(node.left, rectangle, function);
+        query(node.right, rectangle, function);
+      }
+    }
+  };
+
+}
@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+
+#include "aabb_tree.hpp"
+
+BOOST_AUTO_TEST_SUITE(aabb_tree)
+
+BOOST_AUTO_TEST_CASE(pairs) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(0.0f, 200.0f);
+  std::uniform_real_distribution<float> movement(-2.0f, 2.0f);
+
+  std::vector<sandbox::rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 200; ++i) {
+    sandbox::vector const top_left(position(generator), position(generator));
+    bounding_boxes.emplace_back(top_left, top_left + sandbox::vector(10.0f, 10.0f));
+  }
+  // A floor spanning the whole area
+  bounding_boxes.emplace_back(sandbox::vector(0.0f, 200.0f), sandbox::vector(210.0f, 220.0f));
+
+  sandbox::aabb_tree aabb_tree;
+  std::vector<sandbox::aabb_tree::pair_t> previous;
+  for(unsigned int step(0); step < 20; ++step) {
+    aabb_tree.update(bounding_boxes);
+
+    auto const & pairs(aabb_tree.pairs());
+    BOOST_REQUIRE(std::is_sorted(pairs.begin(), pairs.end()));
+    BOOST_REQUIRE(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end());
+
+    // Every overlap is found, and a fat box reaches at most two margins past
+    // the box it holds, so nothing further apart than four margins is reported
+    for(std::size_t a(0); a < bounding_boxes.size(); ++a) {
+      for(std::size_t b(a + 1); b < bounding_boxes.size(); ++b) {
+        auto const found(std::binary_search(pairs.begin(), pairs.end(), std::make_pair(a, b)));
+        if(bounding_boxes[a].overlaps(bounding_boxes[b])) BOOST_REQUIRE(found);
+        sandbox::vector const margin(aabb_tree.margin() * 4.0f, aabb_tree.margin() * 4.0f);
+        sandbox::rectangle const grown(bounding_boxes[a].top_left() - margin, bounding_boxes[a].bottom_right() + margin);
+        if(found) BOOST_REQUIRE(grown.overlaps(bounding_boxes[b]));
+      }
+    }
+
+    // Previous pairs plus added minus removed gives the current pairs
+    std::vector<sandbox::aabb_tree::pair_t> kept, current;
+    std::set_difference(previous.begin(), previous.end(), aabb_tree.removed().begin(), aabb_tree.removed().end(), std::back_inserter(kept));
+    std::set_union(kept.begin(), kept.end(), aabb_tree.added().begin(), aabb_tree.added().end(), std::back_inserter(current));
+    BOOST_REQUIRE(current == pairs);
+    previous = pairs;
+
+    BOOST_CHECK_LE(aabb_tree.height(), 2 * std::log2(bounding_boxes.size()) + 2);
+
+    for(std::size_t i(0); i + 1 < bounding_boxes.size(); ++i) {
+      sandbox::vector const offset(movement(generator), movement(generator));
+      bounding_boxes[i] = sandbox::rectangle(bounding_boxes[i].top_left() + offset, bounding_boxes[i].bottom_right() + offset);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(reinsertion) {
+  std::vector<sandbox::rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 10; ++i) {
+    sandbox::vector const top_left(i * 20.0f, 0.0f);
+    bounding_boxes.emplace_back(top_left, top_left + sandbox::vector(10.0f, 10.0f));
+  }
+
+  sandbox::aabb_tree aabb_tree(2.0f);
+  aabb_tree.update(bounding_boxes);
+  BOOST_CHECK_EQUAL(aabb_tree.reinserted(), bounding_boxes.size());
+
+  // Moving within the margin keeps the leaf where it is
+  bounding_boxes[3] = sandbox::rectangle(bounding_boxes[3].top_left() + sandbox::vector(1.0f, 0.0f), bounding_boxes[3].bottom_right() + sandbox::vector(1.0f, 0.0f));
+  aabb_tree.update(bounding_boxes);
+  BOOST_CHECK_EQUAL(aabb_tree.reinserted(), 0u);
+  BOOST_CHECK(aabb_tree.added().empty());
+
+  // Moving next to a neighbour reinserts and reports the new pair
+  bounding_boxes[3] = sandbox::rectangle(sandbox::vector(75.0f, 0.0f), sandbox::vector(85.0f, 10.0f));
+  aabb_tree.update(bounding_boxes);
+  BOOST_CHECK_EQUAL(aabb_tree.reinserted(), 1u);
+  BOOST_REQUIRE_EQUAL(aabb_tree.added().size(), 1u);
+  BOOST_CHECK(aabb_tree.added().front() == std::make_pair(std::size_t(3), std::size_t(4)));
+
+  bounding_boxes[3] = sandbox::rectangle(sandbox::vector(60.0f, 0.0f), sandbox::vector(70.0f, 10.0f));
+  aabb_tree.update(bounding_boxes);
+  BOOST_REQUIRE_EQUAL(aabb_tree.removed().size(), 1u);
+  BOOST_CHECK(aabb_tree.removed().front() == std::make_pair(std::size_t(3), std::size_t(4)));
+}
+
+BOOST_AUTO_TEST_CASE(incremental) {
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> position(0.0f, 200.0f);
+
+  std::vector<sandbox::rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 100; ++i) {
+    sandbox::vector const top_left(position(generator), position(generator));
+    bounding_boxes.emplace_back(top_left, top_left + sandbox::vector(10.0f, 10.0f));
+  }
+
+  sandbox::aabb_tree aabb_tree;
+  std::vector<char> inserted(bounding_boxes.size(), 0);
+  for(std::size_t body(0); body < bounding_boxes.size(); body += 2) {
+    aabb_tree.insert(body, bounding_boxes[body]);
+    inserted[body] = 1;
+  }
+  for(std::size_t body(0); body < bounding_boxes.size(); body += 6) {
+    aabb_tree.remove(body);
+    inserted[body] = 0;
+  }
+
+  // Exactly the stored boxes overlapping the query come back
+  for(auto const & query : bounding_boxes) {
+    std::vector<std::size_t> found;
+    aabb_tree.query(query, [&](std::size_t const body) { found.push_back(body); });
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::size_t> expected;
+    for(std::size_t body(0); body < bounding_boxes.size(); ++body) {
+      if(inserted[body] && bounding_boxes[body].overlaps(query)) expected.push_back(body);
+    }
+    BOOST_CHECK(found == expected);
+  }
+  BOOST_CHECK_LE(aabb_tree.height(), 2 * std::log2(bounding_boxes.size()) + 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,21 @@
+#include <map>
+#include <string>
+
+#include "benchmark.hpp"
+#include "kernels.hpp"
+
+// Runs the benchmarks every *_bench.cpp registers, built on its own without
+// GLFW and without the profiling hooks so that the scenes time the pipeline
+// Release runs:
+//
+//   bench [--filter=REGEX] [--min_time=SECONDS] [--format=console|json] [--out=FILE]
+int main(int argc, char ** argv) {
+  std::map<std::string, std::string> context;
+  context["instruction_set"] = sandbox::kernels::instruction_set();
+#ifdef SANDBOX_PROFILE
+  context["profile"] = "on";
+#else
+  context["profile"] = "off";
+#endif
+  return sandbox::benchmark::run(argc, argv, context);
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Minimal stand-in for Google Benchmark for the bench program, which links
+// every *_bench.cpp and runs what they register. A benchmark is a function
+// looping on state::keep_running(); the runner grows the iteration count
+// until a run lasts min_time, unless the benchmark asks for a fixed count,
+// and writes the results as a console table or as the JSON Google Benchmark
+// writes, so its comparison tools read them.
+namespace sandbox {
+
+  namespace benchmark {
+
+    template<typename T>
+    T volatile sink = T();
+
+    // Keeps a value the optimizer would otherwise drop
+    template<typename T>
+    inline void keep(T const & value) {
+      sink<T> = value;
+    }
+
+    class state {
+    public:
+      state(std::size_t const iterations, std::vector<long> const & arguments) : iterations_(iterations), remaining_(iterations), arguments_(arguments), started_(false), paused_(), elapsed_(), items_(0) {
+      }
+
+      // Starts the clock on the first call and stops it once the iterations
+      // are used up
+      bool keep_running() {
+        if(!started_) {
+          started_ = true;
+          start_ = std::chrono::steady_clock::now();
+        }
+        if(remaining_) {
+          --remaining_;
+          return true;
+        }
+        elapsed_ = std::chrono::steady_clock::now() - start_ - paused_;
+        return false;
+      }
+
+      // Time between pause() and resume() does not count
+      void pause() {
+        pause_start_ = std::chrono::steady_clock::now();
+      }
+
+      void resume() {
+        paused_ += std::chrono::steady_clock::now() - pause_start_;
+      }
+
+      long argument(std::size_t const index) const {
+        return arguments_[index];
+      }
+
+      std::size_t iterations() const {
+        return iterations_;
+      }
+
+      // Items processed per iteration, reported as items_per_second
+      void items(std::size_t const value) {
+        items_ = value;
+      }
+
+      // Reported as is next to the times
+      void counter(std::string const & name, double const value) {
+        counters_[name] = value;
+      }
+
+      double seconds() const {
+        return std::chrono::duration<double>(elapsed_).count();
+      }
+
+      std::size_t items() const {
+        return items_;
+      }
+
+      std::map<std::string, double> const & counters() const {
+        return counters_;
+      }
+
+    private:
+      std::size_t const iterations_;
+      std::size_t remaining_;
+      std::vector<long> const arguments_;
+      bool started_;
+      std::chrono::steady_clock::time_point start_;
+      std::chrono::steady_clock::time_point pause_start_;
+      std::chrono::steady_clock::duration paused_;
+      std::chrono::steady_clock::duration elapsed_;
+      std::size_t items_;
+      std::map<std::string, double> counters_;
+    };
+
+    typedef void (*function_t)(state &);
+
+    struct entry {
+      std::string name;
+      function_t function;
+      std::vector<long> arguments;
+      // Zero grows the count until a run takes min_time
+      std::size_t iterations;
+    };
+
+    inline std::vector<entry> & registry() {
+      static std::vector<entry> entries;
+      return entries;
+    }
+
+    // Registers function once per argument list, the arguments appended to
+    // the name as /a/b
+    inline void add(std::string const & name, function_t const function, std::vector<std::vector<long>> const & arguments = { {} }, std::size_t const iterations = 0) {
+      for(auto const & list : arguments) {
+        std::string full(name);
+        for(auto const argument : list) full += "/" + std::to_string(argument);
+        registry().push_back({ full, function, list, iterations });
+      }
+    }
+
+    struct result {
+      std::string name;
+      std::size_t iterations;
+      double seconds;
+      std::size_t items;
+      std::map<std::string, double> counters;
+    };
+
+    inline result measure(entry const & entry, double const min_time) {
+      std::size_t iterations(entry.iterations ? entry.iterations : 1);
+      for(;;) {
+        state state(iterations, entry.arguments);
+        entry.function(state);
+        if(entry.iterations || state.seconds() >= min_time || iterations >= 1000000000) {
+          return { entry.name, iterations, state.seconds(), state.items(), state.counters() };
+        }
+        // Aim past min_time, at most ten times the last count
+        auto const target(state.seconds() > 0.0 ? min_time * 1.4 / state.seconds() * iterations : iterations * 10.0);
+        iterations = static_cast<std::size_t>(std::min(std::max(target, iterations + 1.0), iterations * 10.0));
+      }
+    }
+
+    inline void write_json(std::ostream & stream, std::vector<result> const & results, std::map<std::string, std::string> const & context) {
+      char date[64];
+      auto const now(std::time(nullptr));
+      std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+      stream << "{\n  \"context\": {\n    \"date\": \"" << date << "\",\n    \"num_cpus\": " << std::thread::hardware_concurrency();
+#ifdef NDEBUG
+      stream << ",\n    \"library_build_type\": \"release\"";
+#else
+      stream << ",\n    \"library_build_type\": \"debug\"";
+#endif
+      for(auto const & value : context) {
+        stream << ",\n    \"" << value.first << "\": \"" << value.second << "\"";
+      }
+      stream << "\n  },\n  \"benchmarks\": [";
+
+      for(std::size_t index(0); index < results.size(); ++index) {
+        auto const & result(results[index]);
+        auto const time(result.seconds * 1e9 / result.iterations);
+        stream << (index ? ",\n" : "\n") << "    {\n      \"name\": \"" << result.name << "\",\n      \"run_name\": \"" << result.name
+               << "\",\n      \"run_type\": \"iteration\",\n      \"iterations\": " << result.iterations
+               << ",\n      \"real_time\": " << time << ",\n      \"cpu_time\": " << time << ",\n      \"time_unit\": \"ns\"";
+        if(result.items) {
+          stream << ",\n      \"items_per_second\": " << result.items * result.iterations / result.seconds;
+        }
+        for(auto const & counter : result.counters) {
+          stream << ",\n      \"" << counter.first << "\": " << counter.second;
+        }
+        stream << "\n    }";
+      }
+      stream << "\n  ]\n}\n";
+    }
+
+    // Runs every registered benchmark matching --filter=REGEX for at least
+    // --min_time=SECONDS each, printing a table or, with --format=json, the
+    // JSON; --out=FILE writes the JSON to a file as well. context adds to the
+    // JSON's context.
+    inline int run(int const argc, char ** const argv, std::map<std::string, std::string> const & context = std::map<std::string, std::string>()) {
+      std::string filter(".*");
+      std::string format("console");
+      std::string out;
+      double min_time(0.5);
+      for(int index(1); index < argc; ++index) {
+        std::string const argument(argv[index]);
+        auto const value(argument.substr(argument.find('=') + 1));
+        if(argument.compare(0, 9, "--filter=") == 0) {
+          filter = value;
+        } else if(argument.compare(0, 9, "--format=") == 0) {
+          format = value;
+        } else if(argument.compare(0, 6, "--out=") == 0) {
+          out = value;
+        } else if(argument.compare(0, 11, "--min_time=") == 0) {
+          min_time = std::stod(value);
+        } else {
+          std::cerr << "usage: " << argv[0] << " [--filter=REGEX] [--min_time=SECONDS] [--format=console|json] [--out=FILE]\n";
+          return 1;
+        }
+      }
+
+      std::regex const pattern(filter);
+      bool const console(format != "json");
+      if(console) std::printf("%-44s %14s %12s %16s\n", "benchmark", "time/iteration", "iterations", "items/s");
+
+      std::vector<result> results;
+      for(auto const & entry : registry()) {
+        if(!std::regex_search(entry.name, pattern)) continue;
+        results.push_back(measure(entry, min_time));
+
+        auto const & result(results.back());
+        if(!console) continue;
+        auto const time(result.seconds / result.iterations);
+        std::printf("%-44s %11.3f %s %12lu", result.name.c_str(), time >= 1e-3 ? time * 1e3 : time >= 1e-6 ? time * 1e6 : time * 1e9, time >= 1e-3 ? "ms" : time >= 1e-6 ? "us" : "ns", static_cast<unsigned long>(result.iterations));
+        if(result.items) std::printf(" %16.4g", result.items * result.iterations / result.seconds);
+        for(auto const & counter : result.counters) std::printf("  %s=%g", counter.first.c_str(), counter.second);
+        std::printf("\n");
+        std::fflush(stdout);
+      }
+
+      if(!console) write_json(std::cout, results, context);
+      if(!out.empty()) {
+        std::ofstream file(out);
+        if(!file) {
+          std::cerr << "Cannot open " << out << '\n';
+          return 1;
+        }
+        write_json(file, results, context);
+      }
+      return 0;
+    }
+
+  }
+
+}
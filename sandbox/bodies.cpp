@@ -0,0 +1,74 @@
+#include "bodies.hpp"
+#include "object.hpp"
+
+namespace sandbox {
+
+  bodies::handle_t bodies::add(object & owner) {
+    if(owner.bodies_) owner.detach();
+
+    handle_t const body(owners_.size());
+    owners_.push_back(&owner);
+    shapes_.push_back(&owner.shape_);
+    cores_.push_back(&owner.core_);
+    materials_.push_back(&owner.material_);
+    masses_.push_back(owner.mass_);
+    moments_of_inertia_.push_back(owner.moment_of_inertia_);
+    positions_.push_back(owner.position_);
+    linear_velocities_.push_back(owner.linear_velocity_);
+    orientations_.push_back(owner.orientation_);
+    angular_velocities_.push_back(owner.angular_velocity_);
+    forces_.push_back(owner.force_);
+    torques_.push_back(owner.torque_);
+    kinematic_.push_back(owner.kinematic_);
+    dirty_.push_back(1);
+    sleeping_.push_back(owner.sleeping_);
+    sleep_times_.push_back(0.0f);
+
+    owner.bodies_ = this;
+    owner.handle_ = body;
+    return body;
+  }
+
+  bool bodies::synchronized(std::vector<std::shared_ptr<object>> const & objects) const {
+    if(objects.size() != owners_.size()) return false;
+    for(std::size_t i(0); i < objects.size(); ++i) {
+      if(objects[i].get() != owners_[i]) return false;
+    }
+    return true;
+  }
+
+  bool bodies::synchronize(std::vector<std::shared_ptr<object>> const & objects) {
+    if(synchronized(objects)) return false;
+
+    clear();
+    for(auto const & object : objects) {
+      add(*object);
+    }
+    return true;
+  }
+
+  void bodies::clear() {
+    for(auto const owner : owners_) {
+      if(owner) owner->detach();
+    }
+
+    owners_.clear();
+    shapes_.clear();
+    cores_.clear();
+    materials_.clear();
+    masses_.clear();
+    moments_of_inertia_.clear();
+    positions_.clear();
+    linear_velocities_.clear();
+    orientations_.clear();
+    angular_velocities_.clear();
+    forces_.clear();
+    torques_.clear();
+    kinematic_.clear();
+    dirty_.clear();
+    sleeping_.clear();
+    sleep_times_.clear();
+    woken_.clear();
+  }
+
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "vector.hpp"
+#include "shape.hpp"
+#include "material.hpp"
+
+namespace sandbox {
+
+  class object;
+
+  // Structure-of-arrays storage for rigid body state. Bodies are addressed by
+  // dense indices which match the order of the objects they were added from.
+  // Attached objects forward their accessors into these arrays.
+  class bodies {
+  public:
+    typedef std::size_t handle_t;
+
+    bodies() {
+    }
+
+    ~bodies() {
+      clear();
+    }
+
+    bodies(bodies const &) = delete;
+    bodies & operator =(bodies const &) = delete;
+
+    std::size_t size() const {
+      return owners_.size();
+    }
+
+    shape const & getShape(handle_t const body) const {
+      return *shapes_[body];
+    }
+
+    shape const & getCore(handle_t const body) const {
+      return *cores_[body];
+    }
+
+    material const & getMaterial(handle_t const body) const {
+      return *materials_[body];
+    }
+
+    std::vector<float> const & masses() const {
+      return masses_;
+    }
+
+    std::vector<float> const & moments_of_inertia() const {
+      return moments_of_inertia_;
+    }
+
+    std::vector<vector> const & positions() const {
+      return positions_;
+    }
+
+    std::vector<vector> & positions() {
+      return positions_;
+    }
+
+    std::vector<vector> const & linear_velocities() const {
+      return linear_velocities_;
+    }
+
+    std::vector<vector> & linear_velocities() {
+      return linear_velocities_;
+    }
+
+    std::vector<float> const & orientations() const {
+      return orientations_;
+    }
+
+    std::vector<float> & orientations() {
+      return orientations_;
+    }
+
+    std::vector<float> const & angular_velocities() const {
+      return angular_velocities_;
+    }
+
+    std::vector<float> & angular_velocities() {
+      return angular_velocities_;
+    }
+
+    std::vector<vector> const & forces() const {
+      return forces_;
+    }
+
+    std::vector<vector> & forces() {
+      return forces_;
+    }
+
+    std::vector<float> const & torques() const {
+      return torques_;
+    }
+
+    std::vector<float> & torques() {
+      return torques_;
+    }
+
+    // Flags are stored as char rather than bool so that they can be written
+    // from parallel tasks without sharing a word.
+    std::vector<char> const & kinematic() const {
+      return kinematic_;
+    }
+
+    std::vector<char> & kinematic() {
+      return kinematic_;
+    }
+
+    std::vector<char> const & sleeping() const {
+      return sleeping_;
+    }
+
+    std::vector<char> & sleeping() {
+      return sleeping_;
+    }
+
+    // Set when a body moved since its world shape was last computed
+    std::vector<char> const & dirty() const {
+      return dirty_;
+    }
+
+    std::vector<char> & dirty() {
+      return dirty_;
+    }
+
+    // Time each body has been below the sleep tolerances
+    std::vector<float> const & sleep_times() const {
+      return sleep_times_;
+    }
+
+    std::vector<float> & sleep_times() {
+      return sleep_times_;
+    }
+
+    // Bodies asked to wake since the simulation last took them
+    std::vector<handle_t> const & woken() const {
+      return woken_;
+    }
+
+    std::vector<handle_t> & woken() {
+      return woken_;
+    }
+
+    // Sleeping bodies are not looked at by the simulation, so changes made to
+    // them from outside only take effect once they are woken. object's setters
+    // ask for that.
+    void wake(handle_t const body) {
+      sleep_times_[body] = 0.0f;
+      woken_.push_back(body);
+    }
+
+    handle_t add(object & owner);
+    // Whether the bodies are those of the objects, in the same order
+    bool synchronized(std::vector<std::shared_ptr<object>> const & objects) const;
+    // Returns true when the bodies were rebuilt, which invalidates indices
+    bool synchronize(std::vector<std::shared_ptr<object>> const & objects);
+    void clear();
+
+  private:
+    friend class object;
+
+    std::vector<object *> owners_;
+    std::vector<shape const *> shapes_;
+    std::vector<shape const *> cores_;
+    std::vector<material const *> materials_;
+
+    std::vector<float> masses_;
+    std::vector<float> moments_of_inertia_;
+
+    std::vector<vector> positions_;
+    std::vector<vector> linear_velocities_;
+    std::vector<float> orientations_;
+    std::vector<float> angular_velocities_;
+
+    std::vector<vector> forces_;
+    std::vector<float> torques_;
+
+    std::vector<char> kinematic_;
+    std::vector<char> dirty_;
+    std::vector<char> sleeping_;
+    std::vector<float> sleep_times_;
+    std::vector<handle_t> woken_;
+
+    void release(handle_t const body) {
+      owners_[body] = nullptr;
+    }
+  };
+
+}
@@ -0,0 +1,342 @@
+#include "collision.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace sandbox {
+
+  namespace {
+
+    std::size_t next(shape const & shape, std::size_t const vertex) {
+      return vertex + 1 == shape.vertices().size() ? 0 : vertex + 1;
+    }
+
+    // Keeps the part of the segment with normal . point <= offset
+    bool clip(vector (& points)[2], vector const & normal, float const offset) {
+      float const distance0(normal.dot(points[0]) - offset);
+      float const distance1(normal.dot(points[1]) - offset);
+      if(distance0 > 0.0f && distance1 > 0.0f) return false;
+      if(distance0 > 0.0f || distance1 > 0.0f) {
+        vector const crossing(points[0] + (points[1] - points[0]) * (distance0 / (distance0 - distance1)));
+        points[distance0 > 0.0f ? 0 : 1] = crossing;
+      }
+      return true;
+    }
+
+    // The incident face clipped to the sides of the reference face, points
+    // below it or within tolerance above it making up the manifold
+    bool clip(shape const & reference, std::size_t const reference_face, shape const & incident, std::size_t const incident_face, bool const reference_is_a, float const tolerance, manifold & manifold) {
+      auto const & normal(reference.normals()[reference_face]);
+      auto const & start(reference.vertices()[reference_face]);
+      auto const & end(reference.vertices()[next(reference, reference_face)]);
+      vector points[2] = { incident.vertices()[incident_face], incident.vertices()[next(incident, incident_face)] };
+
+      vector const tangent((end - start).normalize());
+      if(!clip(points, -tangent, -tangent.dot(start)) || !clip(points, tangent, tangent.dot(end))) return false;
+
+      manifold.normal = reference_is_a ? -normal : normal;
+      manifold.count = 0;
+      for(auto const & point : points) {
+        float const separation(normal.dot(point - start));
+        if(separation > tolerance) continue;
+        vector const projected(point - normal * separation);
+        manifold.a_points[manifold.count] = reference_is_a ? projected : point;
+        manifold.b_points[manifold.count] = reference_is_a ? point : projected;
+        ++manifold.count;
+      }
+      return manifold.count > 0;
+    }
+
+    // Largest separation of b from one of the faces of a, and that face
+    float separation(shape const & a, shape const & b, std::size_t & face) {
+      float maximum(-std::numeric_limits<float>::max());
+      for(std::size_t i(0); i < a.normals().size(); ++i) {
+        auto const & normal(a.normals()[i]);
+        float const separation(normal.dot(b.vertices()[b.support(-normal)] - a.vertices()[i]));
+        if(separation > maximum) {
+          maximum = separation;
+          face = i;
+        }
+      }
+      return maximum;
+    }
+
+    // Face of the shape most opposed to the normal
+    std::size_t incident_face(shape const & shape, vector const & normal) {
+      std::size_t face(0);
+      float minimum(normal.dot(shape.normals()[0]));
+      for(std::size_t i(1); i < shape.normals().size(); ++i) {
+        float const dot(normal.dot(shape.normals()[i]));
+        if(dot < minimum) {
+          minimum = dot;
+          face = i;
+        }
+      }
+      return face;
+    }
+
+    // Closest points of segments p1 q1 and p2 q2, either possibly a point
+    void closest(vector const & p1, vector const & q1, vector const & p2, vector const & q2, vector & c1, vector & c2) {
+      auto const epsilon(std::numeric_limits<float>::epsilon());
+      auto const clamp([](float const value) {
+        return std::min(1.0f, std::max(0.0f, value));
+      });
+
+      vector const d1(q1 - p1), d2(q2 - p2), r(p1 - p2);
+      float const a(d1.dot(d1)), e(d2.dot(d2)), f(d2.dot(r));
+      float s(0.0f), t(0.0f);
+      if(a <= epsilon && e > epsilon) {
+        t = clamp(f / e);
+      } else if(a > epsilon) {
+        float const c(d1.dot(r));
+        if(e <= epsilon) {
+          s = clamp(-c / a);
+        } else {
+          float const b(d1.dot(d2));
+          float const denominator(a * e - b * b);
+          s = denominator > 0.0f ? clamp((b * f - c * e) / denominator) : 0.0f;
+          t = (b * s + f) / e;
+          if(t < 0.0f) {
+            t = 0.0f;
+            s = clamp(-c / a);
+          } else if(t > 1.0f) {
+            t = 1.0f;
+            s = clamp((b - c) / a);
+          }
+        }
+      }
+      c1 = p1 + d1 * s;
+      c2 = p2 + d2 * t;
+    }
+
+    // Points or segments with radii touching at a single point
+    bool touch(vector const & a_center, float const a_radius, vector const & b_center, float const b_radius, manifold & manifold) {
+      vector const offset(a_center - b_center);
+      float const radii(a_radius + b_radius);
+      float const distance_squared(offset.length_squared());
+      if(distance_squared > radii * radii) return false;
+
+      float const distance(std::sqrt(distance_squared));
+      manifold.normal = distance > std::numeric_limits<float>::epsilon() ? offset / distance : vector(0.0f, -1.0f);
+      manifold.count = 1;
+      manifold.a_points[0] = a_center - manifold.normal * a_radius;
+      manifold.b_points[0] = b_center + manifold.normal * b_radius;
+      return true;
+    }
+
+    // The segment of round shape a, or its point, against a face of polygon
+    // b, clipped to the sides of the face
+    bool face_contact(shape const & a, shape const & b, std::size_t const face, float const tolerance, manifold & manifold) {
+      auto const & normal(b.normals()[face]);
+      auto const & start(b.vertices()[face]);
+      auto const & end(b.vertices()[next(b, face)]);
+      auto const radius(a.radius());
+      vector points[2] = { a.vertices()[0], a.vertices().back() };
+
+      manifold.normal = normal;
+      manifold.count = 0;
+      vector const tangent((end - start).normalize());
+      if(clip(points, -tangent, -tangent.dot(start)) && clip(points, tangent, tangent.dot(end))) {
+        for(std::size_t i(0); i < a.vertices().size(); ++i) {
+          float const separation(normal.dot(points[i] - start));
+          if(separation > radius + tolerance) continue;
+          manifold.a_points[manifold.count] = points[i] - normal * radius;
+          manifold.b_points[manifold.count] = points[i] - normal * separation;
+          ++manifold.count;
+        }
+      }
+
+      // Sunk in past the ends of the face the deeper end stands in
+      if(!manifold.count) {
+        auto const & deepest(normal.dot(a.vertices()[0]) <= normal.dot(a.vertices().back()) ? a.vertices()[0] : a.vertices().back());
+        manifold.a_points[0] = deepest - normal * radius;
+        manifold.b_points[0] = deepest - normal * normal.dot(deepest - start);
+        manifold.count = 1;
+      }
+      return true;
+    }
+
+    bool collide_round_polygon(shape const & a, shape const & b, manifold & manifold, float const tolerance) {
+      auto const & start(a.vertices()[0]);
+      auto const & end(a.vertices().back());
+      auto const radius(a.radius());
+
+      // Face the segment is furthest out of
+      std::size_t deepest(0);
+      float separation(-std::numeric_limits<float>::max());
+      bool inside(true);
+      for(std::size_t i(0); i < b.normals().size(); ++i) {
+        auto const & normal(b.normals()[i]);
+        float const start_separation(normal.dot(start - b.vertices()[i]));
+        float const face_separation(std::min(start_separation, normal.dot(end - b.vertices()[i])));
+        if(face_separation > separation) {
+          separation = face_separation;
+          deepest = i;
+        }
+        inside = inside && start_separation <= 0.0f;
+      }
+      if(separation > radius) return false;
+      if(inside) return face_contact(a, b, deepest, tolerance, manifold);
+
+      // Closest points of the segment and the outline of the polygon
+      std::size_t edge(0);
+      vector a_point, b_point;
+      float distance_squared(std::numeric_limits<float>::max());
+      for(std::size_t i(0); i < b.vertices().size(); ++i) {
+        vector a_candidate, b_candidate;
+        closest(start, end, b.vertices()[i], b.vertices()[next(b, i)], a_candidate, b_candidate);
+        float const candidate_squared((a_candidate - b_candidate).length_squared());
+        if(candidate_squared < distance_squared) {
+          distance_squared = candidate_squared;
+          edge = i;
+          a_point = a_candidate;
+          b_point = b_candidate;
+        }
+      }
+
+      // Crossing the outline the segment is sunk in
+      float const epsilon(1e-6f);
+      if(distance_squared <= epsilon) return face_contact(a, b, deepest, tolerance, manifold);
+      if(distance_squared > radius * radius) return false;
+
+      // Facing an edge rather than a corner the contact spans the face
+      float const distance(std::sqrt(distance_squared));
+      vector const normal((a_point - b_point) / distance);
+      if(normal.dot(b.normals()[edge]) >= 1.0f - 1e-3f) return face_contact(a, b, edge, tolerance, manifold);
+
+      manifold.normal = normal;
+      manifold.count = 1;
+      manifold.a_points[0] = a_point - normal * radius;
+      manifold.b_points[0] = b_point;
+      return true;
+    }
+
+    // Swaps the roles of a and b
+    void flip(manifold & manifold) {
+      manifold.normal = -manifold.normal;
+      for(std::size_t i(0); i < manifold.count; ++i) {
+        std::swap(manifold.a_points[i], manifold.b_points[i]);
+      }
+    }
+
+    // Sticks with a's face unless b's is clearly better, so the reference
+    // does not flip between steps for faces resting flat on each other
+    bool prefer_b(float const a_separation, float const b_separation) {
+      return b_separation > 0.98f * a_separation + 0.001f;
+    }
+
+  }
+
+  bool collide_boxes(shape const & a, shape const & b, manifold & manifold, float const tolerance) {
+    auto const & a_normals(a.normals());
+    auto const & b_normals(b.normals());
+    auto const & a_extents(a.extents());
+    auto const & b_extents(b.extents());
+    vector const offset(b.centroid() - a.centroid());
+
+    // How much the axes of one box line up with those of the other
+    float const c00(std::abs(a_normals[0].dot(b_normals[0])));
+    float const c01(std::abs(a_normals[0].dot(b_normals[1])));
+    float const c10(std::abs(a_normals[1].dot(b_normals[0])));
+    float const c11(std::abs(a_normals[1].dot(b_normals[1])));
+
+    // Center distance along each axis less both boxes' reach along it
+    float const a0(a_normals[0].dot(offset)), a1(a_normals[1].dot(offset));
+    float const a_separation0(std::abs(a0) - a_extents.x() - b_extents.x() * c00 - b_extents.y() * c01);
+    float const a_separation1(std::abs(a1) - a_extents.y() - b_extents.x() * c10 - b_extents.y() * c11);
+    if(a_separation0 > 0.0f || a_separation1 > 0.0f) return false;
+
+    float const b0(b_normals[0].dot(offset)), b1(b_normals[1].dot(offset));
+    float const b_separation0(std::abs(b0) - b_extents.x() - a_extents.x() * c00 - a_extents.y() * c10);
+    float const b_separation1(std::abs(b1) - b_extents.y() - a_extents.x() * c01 - a_extents.y() * c11);
+    if(b_separation0 > 0.0f || b_separation1 > 0.0f) return false;
+
+    // Faces of a point towards b along the offset, those of b away from it
+    float const a_separation(std::max(a_separation0, a_separation1));
+    std::size_t const a_face(a_separation0 >= a_separation1 ? (a0 > 0.0f ? 0 : 2) : (a1 > 0.0f ? 1 : 3));
+    float const b_separation(std::max(b_separation0, b_separation1));
+    std::size_t const b_face(b_separation0 >= b_separation1 ? (b0 < 0.0f ? 0 : 2) : (b1 < 0.0f ? 1 : 3));
+
+    // The incident face is on the axis of the other box closest to the
+    // reference normal, on the side facing it
+    auto const incident([](shape const & shape, vector const & normal) -> std::size_t {
+      float const dot0(normal.dot(shape.normals()[0])), dot1(normal.dot(shape.normals()[1]));
+      if(std::abs(dot0) >= std::abs(dot1)) return dot0 < 0.0f ? 0 : 2;
+      return dot1 < 0.0f ? 1 : 3;
+    });
+
+    if(prefer_b(a_separation, b_separation)) {
+      return clip(b, b_face, a, incident(a, b_normals[b_face]), false, tolerance, manifold);
+    }
+    return clip(a, a_face, b, incident(b, a_normals[a_face]), true, tolerance, manifold);
+  }
+
+  bool collide_polygons(shape const & a, shape const & b, manifold & manifold, float const tolerance) {
+    std::size_t a_face(0), b_face(0);
+    float const a_separation(separation(a, b, a_face));
+    if(a_separation > 0.0f) return false;
+    float const b_separation(separation(b, a, b_face));
+    if(b_separation > 0.0f) return false;
+
+    if(prefer_b(a_separation, b_separation)) {
+      return clip(b, b_face, a, incident_face(a, b.normals()[b_face]), false, tolerance, manifold);
+    }
+    return clip(a, a_face, b, incident_face(b, a.normals()[a_face]), true, tolerance, manifold);
+  }
+
+  bool collide_circles(shape const & a, shape const & b, manifold & manifold) {
+    return touch(a.vertices()[0], a.radius(), b.vertices()[0], b.radius(), manifold);
+  }
+
+  bool collide_capsules(shape const & a, shape const & b, manifold & manifold) {
+    vector a_center, b_center;
+    closest(a.vertices()[0], a.vertices().back(), b.vertices()[0], b.vertices().back(), a_center, b_center);
+    return touch(a_center, a.radius(), b_center, b.radius(), manifold);
+  }
+
+  bool collide_circle_polygon(shape const & a, shape const & b, manifold & manifold, float const tolerance) {
+    return collide_round_polygon(a, b, manifold, tolerance);
+  }
+
+  bool collide_capsule_polygon(shape const & a, shape const & b, manifold & manifold, float const tolerance) {
+    return collide_round_polygon(a, b, manifold, tolerance);
+  }
+
+  bool collide(shape const & a, shape const & b, manifold & manifold, collider_t & collider) {
+    if(!a.round() && !b.round()) {
+      if(a.kind() == shape::kind_t::box && b.kind() == shape::kind_t::box) {
+        collider = collider_t::box_box;
+        return collide_boxes(a, b, manifold);
+      }
+      collider = collider_t::polygon;
+      return collide_polygons(a, b, manifold);
+    }
+
+    if(a.round() && b.round()) {
+      if(a.kind() == shape::kind_t::circle && b.kind() == shape::kind_t::circle) {
+        collider = collider_t::circle_circle;
+        return collide_circles(a, b, manifold);
+      }
+      collider = collider_t::capsule;
+      return collide_capsules(a, b, manifold);
+    }
+
+    // The round shape goes first
+    bool const swapped(!a.round());
+    auto const & round(swapped ? b : a);
+    auto const & polygon(swapped ? a : b);
+    bool touching(false);
+    if(round.kind() == shape::kind_t::circle) {
+      collider = collider_t::circle_polygon;
+      touching = collide_circle_polygon(round, polygon, manifold);
+    } else {
+      collider = collider_t::capsule_polygon;
+      touching = collide_capsule_polygon(round, polygon, manifold);
+    }
+    if(touching && swapped) flip(manifold);
+    return touching;
+  }
+
+}
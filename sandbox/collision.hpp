@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+#include "vector.hpp"
+#include "shape.hpp"
+
+namespace sandbox {
+
+  // Routine that computed a pair's contact in the narrowphase, capsule
+  // covering capsules against capsules and circles
+  enum class collider_t : unsigned char {
+    gjk,
+    box_box,
+    polygon,
+    circle_circle,
+    circle_polygon,
+    capsule_polygon,
+    capsule
+  };
+
+  // Up to two points where shapes a and b touch, the normal pointing from b
+  // to a. Points on a and on b come in pairs, the second pair only when the
+  // shapes meet face to face.
+  struct manifold {
+    vector normal;
+    std::size_t count;
+    vector a_points[2];
+    vector b_points[2];
+  };
+
+  // Separating axis tests with the incident face clipped against the
+  // reference face. Points separated by up to tolerance are kept, which lets
+  // a face resting slightly tilted on another keep both ends. Both return
+  // whether the shapes overlap.
+  bool collide_boxes(shape const & a, shape const & b, manifold & manifold, float const tolerance = 0.5f);
+  bool collide_polygons(shape const & a, shape const & b, manifold & manifold, float const tolerance = 0.5f);
+
+  // Closest points of the round shapes' points or segments, one point
+  bool collide_circles(shape const & a, shape const & b, manifold & manifold);
+  bool collide_capsules(shape const & a, shape const & b, manifold & manifold);
+
+  // Round shape a against polygon b. A capsule lying along a face gets a
+  // point at either end the way polygons do.
+  bool collide_circle_polygon(shape const & a, shape const & b, manifold & manifold, float const tolerance = 0.5f);
+  bool collide_capsule_polygon(shape const & a, shape const & b, manifold & manifold, float const tolerance = 0.5f);
+
+  // Picks the routine for the kinds of a and b
+  bool collide(shape const & a, shape const & b, manifold & manifold, collider_t & collider);
+
+}
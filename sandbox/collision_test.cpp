@@ -0,0 +1,267 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <random>
+
+#include "collision.hpp"
+#include "simulation.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(collision)
+
+sandbox::shape const box(sandbox::rectangle(20, 20).vertices());
+
+// Depth of a contact point pair along the normal, positive when overlapping
+float depth(sandbox::manifold const & manifold, std::size_t const point) {
+  return (manifold.b_points[point] - manifold.a_points[point]).dot(manifold.normal);
+}
+
+BOOST_AUTO_TEST_CASE(face) {
+  // a sits on b, sunk in by one pixel and shifted to the side
+  auto const a(box.transform(sandbox::vector(5, -19), 0.0f));
+  sandbox::manifold manifold;
+  BOOST_REQUIRE(sandbox::collide_boxes(a, box, manifold));
+
+  BOOST_REQUIRE_EQUAL(manifold.count, 2u);
+  BOOST_CHECK_SMALL(manifold.normal.x(), 1e-5f);
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+  for(std::size_t i(0); i < 2; ++i) {
+    BOOST_CHECK_CLOSE(depth(manifold, i), 1.0f, 1e-2f);
+    // Both ends of the overlap
+    BOOST_CHECK(std::abs(manifold.a_points[i].x() - 10.0f) < 1e-3f || std::abs(manifold.a_points[i].x() + 5.0f) < 1e-3f);
+  }
+
+  // Flipping the pair flips the normal
+  BOOST_REQUIRE(sandbox::collide_boxes(box, a, manifold));
+  BOOST_CHECK_CLOSE(manifold.normal.y(), 1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 1.0f, 1e-2f);
+}
+
+BOOST_AUTO_TEST_CASE(corner) {
+  // Standing on a corner there is one point, at the tip
+  auto const a(box.transform(sandbox::vector(0, -23), 0.785398f));
+  sandbox::manifold manifold;
+  BOOST_REQUIRE(sandbox::collide_boxes(a, box, manifold));
+  BOOST_REQUIRE_EQUAL(manifold.count, 1u);
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+  BOOST_CHECK_SMALL(manifold.a_points[0].x(), 1e-3f);
+  BOOST_CHECK_GT(depth(manifold, 0), 0.0f);
+
+  BOOST_CHECK(!sandbox::collide_boxes(box.transform(sandbox::vector(0, -30), 0.785398f), box, manifold));
+  BOOST_CHECK(!sandbox::collide_boxes(box.transform(sandbox::vector(25, 0), 0.3f), box, manifold));
+}
+
+BOOST_AUTO_TEST_CASE(polygon) {
+  // Boxes through the general routine agree with the box one
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> offset(-25.0f, 25.0f), angle(-3.14159f, 3.14159f);
+  for(std::size_t i(0); i < 500; ++i) {
+    auto const a(box.transform(sandbox::vector(offset(generator), offset(generator)), angle(generator)));
+    auto const b(sandbox::shape(sandbox::rectangle(30, 10).vertices()).transform(sandbox::vector(), angle(generator)));
+    BOOST_REQUIRE(a.kind() == sandbox::shape::kind_t::box);
+    BOOST_REQUIRE(b.kind() == sandbox::shape::kind_t::box);
+
+    sandbox::manifold boxes, polygons;
+    bool const touching(sandbox::collide_boxes(a, b, boxes));
+    BOOST_REQUIRE_EQUAL(touching, sandbox::collide_polygons(a, b, polygons));
+    BOOST_CHECK_EQUAL(touching, a.intersects(b));
+    if(!touching) continue;
+    BOOST_REQUIRE_EQUAL(boxes.count, polygons.count);
+    BOOST_CHECK_SMALL((boxes.normal - polygons.normal).length(), 1e-4f);
+    for(std::size_t point(0); point < boxes.count; ++point) {
+      BOOST_CHECK_SMALL((boxes.a_points[point] - polygons.a_points[point]).length(), 1e-3f);
+      BOOST_CHECK_SMALL((boxes.b_points[point] - polygons.b_points[point]).length(), 1e-3f);
+    }
+  }
+
+  sandbox::shape const triangle(std::vector<sandbox::vector> { { -10, 10 }, { 10, 10 }, { 0, -10 } });
+  BOOST_CHECK(triangle.kind() == sandbox::shape::kind_t::polygon);
+  sandbox::manifold manifold;
+  BOOST_REQUIRE(sandbox::collide_polygons(triangle.transform(sandbox::vector(0, -19), 0.0f), box, manifold));
+  BOOST_CHECK_EQUAL(manifold.count, 2u);
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(dispatch) {
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  for(auto const narrowphase : { sandbox::simulation::narrowphase_t::sat, sandbox::simulation::narrowphase_t::gjk }) {
+    sandbox::simulation simulation(400, 400);
+    simulation.narrowphase(narrowphase);
+
+    std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+    floor->position(sandbox::vector(200, 380));
+    floor->kinematic(true);
+    simulation.objects().push_back(floor);
+
+    std::shared_ptr<sandbox::object> const cube(new sandbox::object(box, material));
+    cube->position(sandbox::vector(100, 350.5f));
+    simulation.objects().push_back(cube);
+
+    std::shared_ptr<sandbox::object> const wedge(new sandbox::object(sandbox::shape(std::vector<sandbox::vector> { { -10, 10 }, { 10, 10 }, { 0, -10 } }), material));
+    wedge->position(sandbox::vector(300, 350.5f));
+    simulation.objects().push_back(wedge);
+
+    simulation.step(0.005f, 0.005f);
+
+    auto const & entries(simulation.getContactCache().entries());
+    BOOST_REQUIRE_EQUAL(entries.size(), 2u);
+    for(auto const & entry : entries) {
+      BOOST_CHECK(entry.touching);
+      if(narrowphase == sandbox::simulation::narrowphase_t::gjk) {
+        BOOST_CHECK(entry.collider == sandbox::collider_t::gjk);
+      } else if(entry.pair.first == 1) {
+        BOOST_CHECK(entry.collider == sandbox::collider_t::box_box);
+      } else {
+        BOOST_CHECK(entry.collider == sandbox::collider_t::polygon);
+      }
+    }
+  }
+}
+
+// Polygon with many sides standing in for a round shape
+sandbox::shape polygon(sandbox::vector const & start, sandbox::vector const & end, float const radius) {
+  std::vector<sandbox::vector> vertices;
+  auto const axis(end - start);
+  float const angle(axis ? std::atan2(axis.y(), axis.x()) : 0.0f);
+  std::size_t const segments(512);
+  for(std::size_t i(0); i < segments; ++i) {
+    float const turn(angle - 1.5707963f + 3.14159265f * i / segments);
+    vertices.push_back(end + sandbox::vector(std::cos(turn), std::sin(turn)) * radius);
+  }
+  for(std::size_t i(0); i < segments; ++i) {
+    float const turn(angle + 1.5707963f + 3.14159265f * i / segments);
+    vertices.push_back(start + sandbox::vector(std::cos(turn), std::sin(turn)) * radius);
+  }
+  return sandbox::shape(vertices);
+}
+
+BOOST_AUTO_TEST_CASE(round_shapes) {
+  auto const circle(sandbox::shape::circle(10.0f));
+  auto const capsule(sandbox::shape::capsule(sandbox::vector(-15, 0), sandbox::vector(15, 0), 5.0f));
+  BOOST_CHECK(circle.kind() == sandbox::shape::kind_t::circle);
+  BOOST_CHECK(capsule.kind() == sandbox::shape::kind_t::capsule);
+  BOOST_CHECK(circle.round() && capsule.round() && !box.round());
+
+  // Mass and inertia match finely cut polygons
+  for(auto const & pair : { std::make_pair(circle, polygon(sandbox::vector(), sandbox::vector(), 10.0f)), std::make_pair(capsule, polygon(sandbox::vector(-15, 0), sandbox::vector(15, 0), 5.0f)) }) {
+    BOOST_CHECK_CLOSE(pair.first.area(), pair.second.area(), 0.1f);
+    BOOST_CHECK_CLOSE(pair.first.moment_of_inertia(2.0f), pair.second.moment_of_inertia(2.0f), 0.1f);
+    auto const moved(pair.first.transform(sandbox::vector(3, 4), 0.0f));
+    auto const moved_polygon(pair.second.transform(sandbox::vector(3, 4), 0.0f));
+    BOOST_CHECK_CLOSE(moved.moment_of_inertia(2.0f), moved_polygon.moment_of_inertia(2.0f), 0.1f);
+  }
+
+  auto const turned(capsule.transform(sandbox::vector(100, 50), 1.5707963f));
+  auto const bounds(turned.bounding_box());
+  BOOST_CHECK_CLOSE(bounds.width(), 10.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(bounds.height(), 40.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(turned.centroid().x(), 100.0f, 1e-3f);
+
+  auto const support(turned.support_point(sandbox::vector(1, 1)));
+  BOOST_CHECK_CLOSE(support.x(), 100.0f + 5.0f * 0.70710678f, 1e-3f);
+  BOOST_CHECK_CLOSE(support.y(), 65.0f + 5.0f * 0.70710678f, 1e-3f);
+
+  auto const closest(capsule.closest(sandbox::vector(0, 20)));
+  BOOST_CHECK_SMALL(closest.x(), 1e-4f);
+  BOOST_CHECK_CLOSE(closest.y(), 5.0f, 1e-3f);
+  auto const box_closest(box.closest(sandbox::vector(3, 30)));
+  BOOST_CHECK_CLOSE(box_closest.x(), 3.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(box_closest.y(), 10.0f, 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(round_pairs) {
+  sandbox::manifold manifold;
+  sandbox::collider_t collider;
+
+  // Circle resting on a circle below it
+  auto const circle(sandbox::shape::circle(10.0f));
+  BOOST_REQUIRE(sandbox::collide(circle.transform(sandbox::vector(0, -19), 0.0f), circle, manifold, collider));
+  BOOST_CHECK(collider == sandbox::collider_t::circle_circle);
+  BOOST_REQUIRE_EQUAL(manifold.count, 1u);
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 1.0f, 1e-2f);
+  BOOST_CHECK(!sandbox::collide(circle.transform(sandbox::vector(15, -15), 0.0f), circle, manifold, collider));
+
+  // Circle on a box face, then off its corner
+  BOOST_REQUIRE(sandbox::collide(circle.transform(sandbox::vector(3, -19), 0.0f), box, manifold, collider));
+  BOOST_CHECK(collider == sandbox::collider_t::circle_polygon);
+  BOOST_REQUIRE_EQUAL(manifold.count, 1u);
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 1.0f, 1e-2f);
+  BOOST_CHECK_CLOSE(manifold.b_points[0].x(), 3.0f, 1e-3f);
+
+  BOOST_REQUIRE(sandbox::collide(circle.transform(sandbox::vector(16, -16), 0.0f), box, manifold, collider));
+  BOOST_CHECK_CLOSE(manifold.normal.x(), 0.70710678f, 1e-2f);
+  BOOST_CHECK_CLOSE(manifold.b_points[0].x(), 10.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 10.0f - std::sqrt(72.0f), 1e-1f);
+  BOOST_CHECK(!sandbox::collide(circle.transform(sandbox::vector(18, -18), 0.0f), box, manifold, collider));
+
+  // The polygon first flips the normal
+  BOOST_REQUIRE(sandbox::collide(box, circle.transform(sandbox::vector(3, -19), 0.0f), manifold, collider));
+  BOOST_CHECK_CLOSE(manifold.normal.y(), 1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 1.0f, 1e-2f);
+
+  // A circle sunk deep into a box still comes out through the nearest face
+  BOOST_REQUIRE(sandbox::collide(sandbox::shape::circle(3.0f).transform(sandbox::vector(0, -8), 0.0f), box, manifold, collider));
+  BOOST_CHECK_CLOSE(manifold.normal.y(), -1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 5.0f, 1e-2f);
+
+  // A capsule lying on a box gets both ends, tilted only the lower one
+  auto const capsule(sandbox::shape::capsule(sandbox::vector(-8, 0), sandbox::vector(8, 0), 4.0f));
+  BOOST_REQUIRE(sandbox::collide(capsule.transform(sandbox::vector(0, -13.5f), 0.0f), box, manifold, collider));
+  BOOST_CHECK(collider == sandbox::collider_t::capsule_polygon);
+  BOOST_REQUIRE_EQUAL(manifold.count, 2u);
+  for(std::size_t i(0); i < 2; ++i) {
+    BOOST_CHECK_CLOSE(depth(manifold, i), 0.5f, 1e-1f);
+    BOOST_CHECK_CLOSE(std::abs(manifold.a_points[i].x()), 8.0f, 1e-3f);
+  }
+  BOOST_REQUIRE(sandbox::collide(capsule.transform(sandbox::vector(0, -16), 0.3f), box, manifold, collider));
+  BOOST_CHECK_EQUAL(manifold.count, 1u);
+  BOOST_CHECK_GT(manifold.a_points[0].x(), 0.0f);
+
+  // Capsules crossing each other and a capsule end on a circle
+  BOOST_REQUIRE(sandbox::collide(capsule, capsule.transform(sandbox::vector(0, 7), 1.5707963f), manifold, collider));
+  BOOST_CHECK(collider == sandbox::collider_t::capsule);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 8.0f, 1e-2f);
+  BOOST_REQUIRE(sandbox::collide(capsule, circle.transform(sandbox::vector(21, 0), 0.0f), manifold, collider));
+  BOOST_CHECK_CLOSE(manifold.normal.x(), -1.0f, 1e-3f);
+  BOOST_CHECK_CLOSE(depth(manifold, 0), 1.0f, 1e-2f);
+}
+
+BOOST_AUTO_TEST_CASE(granular) {
+  // Disks and capsules poured on a floor come to rest on it
+  sandbox::simulation simulation(400, 400);
+  simulation.solver(sandbox::simulation::solver_t::sequential_impulse);
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  for(unsigned int y(0); y < 4; ++y) {
+    for(unsigned int x(0); x < 8; ++x) {
+      auto const shape(x % 4 ? sandbox::shape::circle(8.0f) : sandbox::shape::capsule(sandbox::vector(-6, 0), sandbox::vector(6, 0), 6.0f));
+      std::shared_ptr<sandbox::object> const object(new sandbox::object(shape, material));
+      object->position(sandbox::vector(120 + x * 20.0f + (y % 2) * 5.0f, 340 - y * 20.0f));
+      simulation.objects().push_back(object);
+    }
+  }
+
+  for(unsigned int i(0); i < 1500; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+
+  // Nothing sinks into the floor; disks keep rolling off the pile's slope,
+  // so only the bottom row is expected to be still
+  for(std::size_t i(1); i < simulation.objects().size(); ++i) {
+    auto const & object(*simulation.objects()[i]);
+    BOOST_CHECK_LT(object.position().y(), 360.0f - object.getShape().radius() + 1.0f);
+    if(i <= 6) {
+      BOOST_CHECK_SMALL(object.linear_velocity().y(), 0.5f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,22 +1,25 @@
 #pragma once
 
-#include <memory>
+#include <cstddef>
 
 #include "vector.hpp"
-#include "object.hpp"
+#include "bodies.hpp"
 
 namespace sandbox {
 
 class contact {
 public:
-	contact(std::shared_ptr<object> const & a, std::shared_ptr<object> const & b, vector const & ap, vector const & bp, vector const & normal) : a_(a), b_(b), ap_(ap), bp_(bp), normal_(normal) {
+	contact() : a_(0), b_(0), force_(0.0f), impulse_(0.0f) {
 	}
 
-	std::shared_ptr<object> a() const {
+	contact(std::size_t const a, std::size_t const b, vector const & ap, vector const & bp, vector const & normal, float const force = 0.0f, float const impulse = 0.0f) : a_(a), b_(b), ap_(ap), bp_(bp), normal_(normal), force_(force), impulse_(impulse) {
+	}
+
+	std::size_t a() const {
 		return a_;
 	}
 
-	std::shared_ptr<object> b() const {
+	std::size_t b() const {
 		return b_;
 	}
 
@@ -32,19 +35,42 @@ public:
 		return normal_;
 	}
 
-	float relative_velocity() const {
-		vector const ra(a_->position() - ap_);
-		vector const rb(b_->position() - bp_);
-		vector const vab(b_->linear_velocity() - rb.cross(b_->angular_velocity()) - a_->linear_velocity() + ra.cross(a_->angular_velocity()));
+	// Normal force from the last solve, the starting guess for the next one
+	float force() const {
+		return force_;
+	}
+
+	void force(float const value) {
+		force_ = value;
+	}
+
+	// Accumulated normal impulse from the last sequential impulse solve
+	float impulse() const {
+		return impulse_;
+	}
+
+	void impulse(float const value) {
+		impulse_ = value;
+	}
+
+	float relative_velocity(bodies const & bodies) const {
+		auto const & positions(bodies.positions());
+		auto const & linear_velocities(bodies.linear_velocities());
+		auto const & angular_velocities(bodies.angular_velocities());
+		vector const ra(positions[a_] - ap_);
+		vector const rb(positions[b_] - bp_);
+		vector const vab(linear_velocities[b_] - rb.cross(angular_velocities[b_]) - linear_velocities[a_] + ra.cross(angular_velocities[a_]));
 		return vab.dot(normal_);
 	}
 
 private:
-	std::shared_ptr<object> a_;
-	std::shared_ptr<object> b_;
+	std::size_t a_;
+	std::size_t b_;
 	vector ap_;
 	vector bp_;
 	vector normal_;
+	float force_;
+	float impulse_;
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,109 @@
+#include "contact_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kernels.hpp"
+
+namespace sandbox {
+
+  namespace {
+
+    vector rotate(vector const & vertex, float const angle, bool const deterministic) {
+      float sin, cos;
+      if(deterministic) {
+        kernels::sin_cos(angle, sin, cos);
+      } else {
+        sin = std::sin(angle);
+        cos = std::cos(angle);
+      }
+      return vector(cos * vertex.x() - sin * vertex.y(), sin * vertex.x() + cos * vertex.y());
+    }
+
+    bool pair_less(contact_cache::entry const & lhs, contact_cache::pair_t const & rhs) {
+      return lhs.pair < rhs;
+    }
+
+  }
+
+  contact_cache::entry const * contact_cache::find(pair_t const & pair) const {
+    auto const found(std::lower_bound(entries_.begin(), entries_.end(), pair, pair_less));
+    return found != entries_.end() && found->pair == pair ? &*found : nullptr;
+  }
+
+  bool contact_cache::reusable(entry const & entry, bodies const & bodies) const {
+    auto const & positions(bodies.positions());
+    auto const & orientations(bodies.orientations());
+    auto const a(entry.pair.first);
+    auto const b(entry.pair.second);
+
+    float const a_turned(orientations[a] - entry.a_orientation);
+    float const b_turned(orientations[b] - entry.b_orientation);
+    if(std::abs(a_turned) > angular_threshold_ || std::abs(b_turned) > angular_threshold_) {
+      return false;
+    }
+
+    // Where b is seen from a, turned back by a's rotation, so a turning swings
+    // b's offset as well
+    vector const offset(rotate(positions[b] - positions[a], -a_turned, deterministic_));
+    return (offset - (entry.b_position - entry.a_position)).length() <= linear_threshold_;
+  }
+
+  contact contact_cache::follow(entry const & entry, sandbox::contact const & contact, bodies const & bodies) const {
+    auto const & positions(bodies.positions());
+    auto const & orientations(bodies.orientations());
+    auto const a(entry.pair.first);
+    auto const b(entry.pair.second);
+
+    float const a_turned(orientations[a] - entry.a_orientation);
+    float const b_turned(orientations[b] - entry.b_orientation);
+
+    return sandbox::contact(a, b,
+                            positions[a] + rotate(contact.ap() - entry.a_position, a_turned, deterministic_),
+                            positions[b] + rotate(contact.bp() - entry.b_position, b_turned, deterministic_),
+                            rotate(contact.normal(), a_turned, deterministic_),
+                            contact.force(),
+                            contact.impulse());
+  }
+
+  contact_cache::entry contact_cache::create(pair_t const & pair, bodies const & bodies) {
+    entry entry;
+    entry.pair = pair;
+    entry.collider = collider_t::gjk;
+    entry.touching = false;
+    entry.face = false;
+    entry.a_position = bodies.positions()[pair.first];
+    entry.b_position = bodies.positions()[pair.second];
+    entry.a_orientation = bodies.orientations()[pair.first];
+    entry.b_orientation = bodies.orientations()[pair.second];
+    return entry;
+  }
+
+  void contact_cache::update(std::vector<entry> & entries) {
+    entries_.swap(entries);
+    std::sort(entries_.begin(), entries_.end(), [](entry const & lhs, entry const & rhs) {
+      return lhs.pair < rhs.pair;
+    });
+  }
+
+  void contact_cache::store(std::vector<contact> const & contacts) {
+    for(auto & entry : entries_) {
+      entry.contact.force(0.0f);
+      entry.contact.impulse(0.0f);
+      entry.second.force(0.0f);
+      entry.second.impulse(0.0f);
+    }
+    for(auto const & contact : contacts) {
+      auto const pair(std::make_pair(contact.a(), contact.b()));
+      auto const found(std::lower_bound(entries_.begin(), entries_.end(), pair, pair_less));
+      if(found != entries_.end() && found->pair == pair) {
+        // Either point of a face contact may have been dropped, the nearer
+        // one takes the result
+        auto& stored(found->face && (contact.ap() - found->second.ap()).length_squared() < (contact.ap() - found->contact.ap()).length_squared() ? found->second : found->contact);
+        stored.force(contact.force());
+        stored.impulse(contact.impulse());
+      }
+    }
+  }
+
+}
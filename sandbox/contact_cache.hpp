@@ -0,0 +1,108 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "vector.hpp"
+#include "bodies.hpp"
+#include "contact.hpp"
+#include "collision.hpp"
+
+namespace sandbox {
+
+  // Narrowphase results of the last step keyed by body pair. Entries remember
+  // where both bodies were when the contact was computed, so pairs that have
+  // barely moved relative to each other can reuse it, and the contact keeps
+  // the solved force as a warm start for the next solve.
+  class contact_cache {
+  public:
+    typedef std::pair<std::size_t, std::size_t> pair_t;
+
+    struct entry {
+      pair_t pair;
+      collider_t collider;
+      bool touching;
+      sandbox::contact contact;
+      // Face to face contacts have a second point at the other end of the
+      // overlap
+      bool face;
+      sandbox::contact second;
+      vector a_position;
+      vector b_position;
+      float a_orientation;
+      float b_orientation;
+    };
+
+    contact_cache(float const linear_threshold = 0.05f, float const angular_threshold = 0.005f) : linear_threshold_(linear_threshold), angular_threshold_(angular_threshold), deterministic_(false) {
+    }
+
+    float linear_threshold() const {
+      return linear_threshold_;
+    }
+
+    void linear_threshold(float const value) {
+      linear_threshold_ = value;
+    }
+
+    float angular_threshold() const {
+      return angular_threshold_;
+    }
+
+    void angular_threshold(float const value) {
+      angular_threshold_ = value;
+    }
+
+    // Followed contacts turn with kernels::sin_cos rather than the C library
+    bool deterministic() const {
+      return deterministic_;
+    }
+
+    void deterministic(bool const value) {
+      deterministic_ = value;
+    }
+
+    std::size_t size() const {
+      return entries_.size();
+    }
+
+    // Entries of the last step sorted by pair, each recording the routine
+    // that computed it
+    std::vector<entry> const & entries() const {
+      return entries_;
+    }
+
+    entry const * find(pair_t const & pair) const;
+
+    // Whether neither body turned more than the angular threshold and b moved
+    // relative to a less than the linear threshold since the entry was
+    // computed. Turning together still changes the contact geometry.
+    bool reusable(entry const & entry, bodies const & bodies) const;
+
+    // The entry's contact carried along with the current body transforms
+    contact follow(entry const & entry, bodies const & bodies) const {
+      return follow(entry, entry.contact, bodies);
+    }
+
+    contact follow(entry const & entry, contact const & contact, bodies const & bodies) const;
+
+    static entry create(pair_t const & pair, bodies const & bodies);
+
+    // Replaces the cache with the entries of this step, leaving the previous
+    // ones in entries for their storage to be reused
+    void update(std::vector<entry> & entries);
+
+    // Keeps the solved forces and impulses, contacts that were not solved get none
+    void store(std::vector<contact> const & contacts);
+
+    void clear() {
+      entries_.clear();
+    }
+
+  private:
+    float linear_threshold_;
+    float angular_threshold_;
+    bool deterministic_;
+    std::vector<entry> entries_;
+  };
+
+}
@@ -0,0 +1,68 @@
+#include <boost/test/unit_test.hpp>
+
+#include "contact_cache.hpp"
+#include "object.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(contact_cache)
+
+BOOST_AUTO_TEST_CASE(reuse) {
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+  sandbox::object o1(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material);
+  sandbox::object o2(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material);
+  o1.position(sandbox::vector(100, 100));
+  o2.position(sandbox::vector(100, 120));
+
+  sandbox::bodies bodies;
+  bodies.add(o1);
+  bodies.add(o2);
+
+  sandbox::contact_cache cache(0.1f, 0.01f);
+  std::vector<sandbox::contact_cache::entry> entries(1, sandbox::contact_cache::create(std::make_pair(0, 1), bodies));
+  entries[0].touching = true;
+  entries[0].contact = sandbox::contact(0, 1, sandbox::vector(100, 110), sandbox::vector(100, 110), sandbox::vector(0, 1), 5.0f);
+  cache.update(entries);
+
+  BOOST_CHECK(!cache.find(std::make_pair(1, 0)));
+  auto const entry(cache.find(std::make_pair(0, 1)));
+  BOOST_REQUIRE(entry);
+  BOOST_CHECK(cache.reusable(*entry, bodies));
+
+  // Moving together is not relative motion, the contact follows the bodies
+  bodies.positions()[0] += sandbox::vector(3, 0);
+  bodies.positions()[1] += sandbox::vector(3, 0);
+  BOOST_CHECK(cache.reusable(*entry, bodies));
+  auto const contact(cache.follow(*entry, bodies));
+  BOOST_CHECK_CLOSE(contact.ap().x(), 103.0f, 1e-4f);
+  BOOST_CHECK_CLOSE(contact.bp().y(), 110.0f, 1e-4f);
+  BOOST_CHECK_EQUAL(contact.force(), 5.0f);
+
+  bodies.positions()[1] += sandbox::vector(0, 1);
+  BOOST_CHECK(!cache.reusable(*entry, bodies));
+  bodies.positions()[1] -= sandbox::vector(0, 1);
+  BOOST_CHECK(cache.reusable(*entry, bodies));
+
+  // Turning by the same angle is not relative rotation, but the faces no
+  // longer meet the way they did
+  bodies.orientations()[0] += 0.5f;
+  bodies.orientations()[1] += 0.5f;
+  BOOST_CHECK(!cache.reusable(*entry, bodies));
+
+  // Within the angular threshold, a's turn still swings b around it
+  bodies.orientations()[0] -= 0.491f;
+  bodies.orientations()[1] -= 0.5f;
+  BOOST_CHECK(!cache.reusable(*entry, bodies));
+  bodies.orientations()[0] -= 0.009f;
+  BOOST_CHECK(cache.reusable(*entry, bodies));
+
+  // Only solved contacts keep a force
+  std::vector<sandbox::contact> contacts;
+  cache.store(contacts);
+  BOOST_CHECK_EQUAL(cache.find(std::make_pair(0, 1))->contact.force(), 0.0f);
+  contacts.push_back(contact);
+  contacts[0].force(2.0f);
+  cache.store(contacts);
+  BOOST_CHECK_EQUAL(cache.find(std::make_pair(0, 1))->contact.force(), 2.0f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
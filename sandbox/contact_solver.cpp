@@ -0,0 +1,201 @@
+#include "contact_solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "misc.hpp"
+
+namespace sandbox {
+
+  void contact_solver::solve(std::vector<contact> & contacts, std::vector<std::size_t> const & offsets, bodies & bodies) {
+    auto const islands(offsets.empty() ? 0 : offsets.size() - 1);
+    if(workspaces_.size() < islands) workspaces_.resize(islands);
+    island_statistics_.assign(islands, statistics());
+
+    parallel_for(0, islands, [&](std::size_t const island) {
+      auto const n(offsets[island + 1] - offsets[island]);
+      if(n) solve(contacts.data() + offsets[island], n, workspaces_[island], island_statistics_[island], bodies);
+    }, 1, 1);
+
+    statistics_ = statistics();
+    for(auto const& island : island_statistics_) {
+      statistics_.islands += island.islands;
+      statistics_.contacts += island.contacts;
+      statistics_.nonzeros += island.nonzeros;
+      statistics_.iterations += island.iterations;
+      statistics_.max_iterations = std::max(statistics_.max_iterations, island.max_iterations);
+      statistics_.max_residual = std::max(statistics_.max_residual, island.max_residual);
+      statistics_.mean_residual += island.mean_residual;
+    }
+    if(statistics_.contacts) {
+      statistics_.mean_residual /= static_cast<float>(statistics_.contacts);
+    }
+  }
+
+  void contact_solver::solve(contact * const island, std::size_t const n, workspace & workspace, statistics & statistics, bodies & bodies) {
+    auto const& masses(bodies.masses());
+    auto const& moments_of_inertia(bodies.moments_of_inertia());
+    auto const& positions(bodies.positions());
+    auto const& linear_velocities(bodies.linear_velocities());
+    auto const& angular_velocities(bodies.angular_velocities());
+    auto const& kinematic(bodies.kinematic());
+    auto& forces(bodies.forces());
+    auto& torques(bodies.torques());
+
+    auto& body_contacts_(workspace.body_contacts);
+    auto& offsets_(workspace.offsets);
+    auto& columns_(workspace.columns);
+    auto& values_(workspace.values);
+    auto& diagonal_(workspace.diagonal);
+    auto& b_(workspace.b);
+    auto& f_(workspace.f);
+
+    body_contacts_.clear();
+    for(std::size_t i(0); i < n; ++i) {
+      auto const& contact(island[i]);
+      if(!kinematic[contact.a()]) body_contacts_.emplace_back(contact.a(), static_cast<std::uint32_t>(i));
+      if(!kinematic[contact.b()]) body_contacts_.emplace_back(contact.b(), static_cast<std::uint32_t>(i));
+    }
+    std::sort(body_contacts_.begin(), body_contacts_.end());
+
+    auto const contacts_of([&](std::size_t const body) {
+      return std::equal_range(body_contacts_.begin(), body_contacts_.end(), std::make_pair(body, std::uint32_t(0)),
+                              [](std::pair<std::size_t, std::uint32_t> const& lhs, std::pair<std::size_t, std::uint32_t> const& rhs) {
+                                return lhs.first < rhs.first;
+                              });
+    });
+
+    // Row sizes first, then every row is filled in place
+    offsets_.resize(n + 1);
+    offsets_[0] = 0;
+    for(std::size_t i(0); i < n; ++i) {
+      auto const& contact(island[i]);
+      auto const a_range(contacts_of(contact.a()));
+      std::size_t size(a_range.second - a_range.first);
+      if(!kinematic[contact.b()]) {
+        auto const b_range(contacts_of(contact.b()));
+        size += b_range.second - b_range.first;
+      }
+      offsets_[i + 1] = offsets_[i] + size;
+    }
+    columns_.resize(offsets_[n]);
+    values_.resize(offsets_[n]);
+    diagonal_.resize(n);
+    b_.resize(n);
+    f_.resize(n);
+
+    parallel_for(0, n, [&](std::size_t const i) {
+      auto const& contact_i(island[i]);
+      auto const i_a(contact_i.a());
+      auto const i_b(contact_i.b());
+      auto const& i_normal(contact_i.normal());
+
+      auto const i_ar(contact_i.ap() - positions[i_a]);
+      auto const i_br(contact_i.bp() - positions[i_b]);
+
+      auto slot(offsets_[i]);
+      float diagonal(0.0f);
+
+      // Effect on contact i of a unit force at contact j through the body
+      // both of them touch
+      auto const couple([&](std::size_t const body, vector const& i_r, float const i_sign) {
+        auto const range(contacts_of(body));
+        for(auto current(range.first); current != range.second; ++current) {
+          auto const j(current->second);
+          auto const& contact_j(island[j]);
+          auto const& j_normal(contact_j.normal());
+          float const j_sign(contact_j.a() == body ? 1.0f : -1.0f);
+          auto const j_r((contact_j.a() == body ? contact_j.ap() : contact_j.bp()) - positions[body]);
+
+          float const value(i_sign * j_sign * i_normal.dot(j_normal / masses[body] + i_r.cross(j_r.cross(j_normal)) / moments_of_inertia[body]));
+          columns_[slot] = j;
+          if(j == i) {
+            diagonal += value;
+            values_[slot] = 0.0f;
+          } else {
+            values_[slot] = value;
+          }
+          ++slot;
+        }
+      });
+
+      couple(i_a, i_ar, 1.0f);
+      if(!kinematic[i_b]) couple(i_b, i_br, -1.0f);
+      diagonal_[i] = diagonal;
+
+      float b(0.0f);
+      if(!kinematic[i_b]) {
+        auto const arv(linear_velocities[i_a] + i_ar.cross(angular_velocities[i_a]));
+        auto const brv(linear_velocities[i_b] + i_br.cross(angular_velocities[i_b]));
+        b += 2.0f * i_normal.cross(angular_velocities[i_b]).dot(arv - brv);
+      }
+
+      b += i_normal.dot(forces[i_a] / masses[i_a] + i_ar.cross(torques[i_a] / moments_of_inertia[i_a]) +
+                        i_ar.cross(angular_velocities[i_a]).cross(angular_velocities[i_a]));
+      b -= i_normal.dot(forces[i_b] / masses[i_b] + i_br.cross(torques[i_b] / moments_of_inertia[i_b]) +
+                        i_br.cross(angular_velocities[i_b]).cross(angular_velocities[i_b]));
+      b_[i] = b;
+
+      f_[i] = std::max(0.0f, contact_i.force());
+    });
+
+    // http://www.coneural.org/reports/Coneural-05-01.pdf
+    std::size_t iteration(0);
+    while(iteration < iterations_) {
+      ++iteration;
+      float change(0.0f), largest(0.0f);
+      for(std::size_t i(0); i < n; ++i) {
+        auto q(b_[i]);
+        for(auto slot(offsets_[i]); slot < offsets_[i + 1]; ++slot) {
+          q += values_[slot] * f_[columns_[slot]];
+        }
+        float const force(diagonal_[i] > 0.0f ? std::max(0.0f, -q / diagonal_[i]) : 0.0f);
+        change = std::max(change, std::abs(force - f_[i]));
+        f_[i] = force;
+        largest = std::max(largest, force);
+      }
+      if(change <= tolerance_ * largest) break;
+    }
+
+    float max_residual(0.0f), sum_residual(0.0f);
+    for(std::size_t i(0); i < n; ++i) {
+      auto w(b_[i] + diagonal_[i] * f_[i]);
+      for(auto slot(offsets_[i]); slot < offsets_[i + 1]; ++slot) {
+        w += values_[slot] * f_[columns_[slot]];
+      }
+      float const residual(std::abs(std::min(f_[i], w)));
+      max_residual = std::max(max_residual, residual);
+      sum_residual += residual;
+    }
+
+    statistics.islands = 1;
+    statistics.contacts = n;
+    statistics.nonzeros = offsets_[n];
+    statistics.iterations = iteration;
+    statistics.max_iterations = iteration;
+    statistics.max_residual = max_residual;
+    statistics.mean_residual = sum_residual;
+
+    // Bodies are shared between contacts, so the forces are applied serially
+    for(std::size_t i(0); i < n; ++i) {
+      auto& contact(island[i]);
+      auto const a(contact.a());
+      auto const b(contact.b());
+      auto const& normal(contact.normal());
+      auto const force(f_[i]);
+      contact.force(force);
+
+      if(!kinematic[a]) {
+        auto const ar(contact.ap() - positions[a]);
+        forces[a] += normal * (force / masses[a]);
+        torques[a] += ar.cross(normal * force) / moments_of_inertia[a];
+      }
+      if(!kinematic[b]) {
+        auto const br(contact.bp() - positions[b]);
+        forces[b] -= normal * (force / masses[b]);
+        torques[b] -= br.cross(normal * force) / moments_of_inertia[b];
+      }
+    }
+  }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "bodies.hpp"
+#include "contact.hpp"
+
+namespace sandbox {
+
+  // Projected Gauss-Seidel solve of the contact force LCP per island, whole
+  // islands running concurrently. Two contacts are only coupled when they
+  // share a dynamic body, so each row of the coupling matrix is built from the
+  // contacts of its two bodies and stored compressed, which keeps memory and
+  // time linear in the number of couplings instead of quadratic in the number
+  // of contacts.
+  class contact_solver {
+  public:
+    struct statistics {
+      std::size_t islands;
+      std::size_t contacts;
+      std::size_t nonzeros;
+      std::size_t iterations;
+      std::size_t max_iterations;
+      // Largest and mean |min(f, w)| over all contacts after the last sweep,
+      // w being the separating acceleration the forces leave at a contact
+      float max_residual;
+      float mean_residual;
+    };
+
+    contact_solver(std::size_t const iterations = 16, float const tolerance = 1e-4f) : iterations_(iterations), tolerance_(tolerance), statistics_() {
+    }
+
+    std::size_t iterations() const {
+      return iterations_;
+    }
+
+    void iterations(std::size_t const value) {
+      iterations_ = value;
+    }
+
+    // Sweeps stop once no force changes by more than this fraction of the
+    // largest force in the island
+    float tolerance() const {
+      return tolerance_;
+    }
+
+    void tolerance(float const value) {
+      tolerance_ = value;
+    }
+
+    statistics const & getStatistics() const {
+      return statistics_;
+    }
+
+    // Solves every island, island i being [offsets[i], offsets[i + 1]) of
+    // contacts, starting from the forces already on the contacts, stores the
+    // result back on them and applies it to the bodies. Islands must not share
+    // dynamic bodies and are handed out in order, so larger ones should come
+    // first.
+    void solve(std::vector<contact> & contacts, std::vector<std::size_t> const & offsets, bodies & bodies);
+
+  private:
+    // Scratch space of one island. A thread waiting on the parallel loops of
+    // a large island may pick up another island meanwhile, so threads cannot
+    // own one each
+    struct workspace {
+      // Contacts of every dynamic body in the island, sorted by body
+      std::vector<std::pair<std::size_t, std::uint32_t>> body_contacts;
+      std::vector<std::size_t> offsets;
+      std::vector<std::uint32_t> columns;
+      std::vector<float> values;
+      std::vector<float> diagonal;
+      std::vector<float> b;
+      std::vector<float> f;
+    };
+
+    std::size_t iterations_;
+    float tolerance_;
+    statistics statistics_;
+
+    std::vector<workspace> workspaces_;
+    // Per island results, summed in island order afterwards
+    std::vector<statistics> island_statistics_;
+
+    void solve(contact * const island, std::size_t const n, workspace & workspace, statistics & statistics, bodies & bodies);
+  };
+
+}
@@ -0,0 +1,82 @@
+#include <boost/test/unit_test.hpp>
+
+#include "contact_solver.hpp"
+#include "scheduler.hpp"
+#include "test_fixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(contact_solver)
+
+BOOST_AUTO_TEST_CASE(column) {
+  test::scene scene(1, 10);
+  scene.gravity();
+
+  sandbox::contact_solver solver(1000, 1e-4f);
+  solver.solve(scene.contacts, scene.offsets, scene.bodies);
+
+  auto const statistics(solver.getStatistics());
+  BOOST_CHECK_EQUAL(statistics.islands, 1u);
+  BOOST_CHECK_EQUAL(statistics.contacts, 20u);
+  BOOST_CHECK_LT(statistics.iterations, 1000u);
+  BOOST_CHECK_LT(statistics.max_residual, 1e-3f);
+
+  for(auto const & contact : scene.contacts) {
+    BOOST_CHECK_GT(contact.force(), 0.0f);
+  }
+  // The bottom box carries the whole column
+  BOOST_CHECK_GT(scene.contacts[0].force(), scene.contacts[18].force() * 5.0f);
+
+  // Warm started from the previous solution the next solve is done at once
+  scene.gravity();
+  solver.solve(scene.contacts, scene.offsets, scene.bodies);
+  BOOST_CHECK_LE(solver.getStatistics().iterations, 2u);
+}
+
+BOOST_AUTO_TEST_CASE(sparse) {
+  // Thousands of contacts in one island, coupled only through shared boxes
+  test::scene scene(1000, 2);
+  scene.gravity();
+
+  sandbox::contact_solver solver;
+  solver.solve(scene.contacts, scene.offsets, scene.bodies);
+
+  auto const & statistics(solver.getStatistics());
+  BOOST_CHECK_EQUAL(statistics.contacts, 4000u);
+  BOOST_CHECK_LE(statistics.nonzeros, 6u * statistics.contacts);
+  BOOST_CHECK_LE(statistics.max_iterations, solver.iterations());
+  BOOST_CHECK_GE(statistics.mean_residual, 0.0f);
+  BOOST_CHECK_LE(statistics.mean_residual, statistics.max_residual);
+}
+
+BOOST_AUTO_TEST_CASE(islands) {
+  std::vector<float> forces;
+
+  for(auto const threads : { 0u, 4u }) {
+    sandbox::scheduler::instance().concurrency(threads);
+
+    // Every column is an island of its own and they are solved concurrently
+    test::scene scene(50, 4, true);
+    scene.gravity();
+    sandbox::contact_solver solver;
+    solver.solve(scene.contacts, scene.offsets, scene.bodies);
+
+    auto const & statistics(solver.getStatistics());
+    BOOST_CHECK_EQUAL(statistics.islands, 50u);
+    BOOST_CHECK_EQUAL(statistics.contacts, 400u);
+
+    // Islands share no dynamic bodies, so how they are spread over the
+    // threads does not change the result
+    if(forces.empty()) {
+      for(auto const & contact : scene.contacts) {
+        forces.push_back(contact.force());
+      }
+    } else {
+      for(std::size_t i(0); i < forces.size(); ++i) {
+        BOOST_CHECK_EQUAL(forces[i], scene.contacts[i].force());
+      }
+    }
+  }
+
+  sandbox::scheduler::instance().concurrency(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "scene.hpp"
+#include "snapshot.hpp"
+#include "recorder.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+
+// Runs a scene without a window as fast as it goes and reports where the
+// time went, built on its own without GLFW:
+//
+//   headless <scene> [--steps N] [--time-step S] [--threads T] [--state FILE]
+//            [--snapshot FILE] [--record FILE] [--trace FILE [--frames FIRST:LAST]]
+//
+// The scene may also be a snapshot, to carry on a run where another left off.
+// The stage breakdown needs SANDBOX_PROFILE, the final state of every object
+// goes to FILE, - for standard output, and the final snapshot with contact
+// caches to its FILE. Every step is recorded to the --record FILE, to be read
+// back with sandbox::trajectory. The state hash printed after the run tells
+// whether two runs ended the same. The trace, which needs SANDBOX_TRACE,
+// covers the given steps counting from 1, the last 100 by default. The
+// Profile configuration defines both, Debug and Release neither.
+namespace {
+
+  struct options {
+    char const * scene;
+    std::size_t steps;
+    float time_step;
+    std::size_t threads;
+    char const * state;
+    char const * snapshot;
+    char const * record;
+    char const * trace;
+    std::uint32_t first;
+    std::uint32_t last;
+  };
+
+  void usage() {
+    std::cerr << "usage: headless <scene> [--steps N] [--time-step S] [--threads T] [--state FILE]\n"
+                 "                [--snapshot FILE] [--record FILE] [--trace FILE [--frames FIRST:LAST]]\n"
+                 "  <scene>      scene file or snapshot, - for standard input\n"
+                 "  --steps      sub-steps to run, 1000 by default\n"
+                 "  --time-step  seconds per sub-step, 0.001 by default\n"
+                 "  --threads    threads stepping the simulation, all cores by default\n"
+                 "  --state      file the final state goes to, - for standard output\n"
+                 "  --snapshot   file the final snapshot goes to\n"
+                 "  --record     file the trajectory of every body goes to\n"
+                 "  --trace      Chrome trace file of scheduler tasks and stages\n"
+                 "  --frames     steps the trace covers, the last 100 by default\n";
+    std::exit(EXIT_FAILURE);
+  }
+
+  options parse(int const argc, char ** const argv) {
+    options options = { nullptr, 1000, 0.001f, 0, nullptr, nullptr, nullptr, nullptr, 0, 0 };
+    for(int index(1); index < argc; ++index) {
+      std::string const argument(argv[index]);
+      if(argument[0] != '-' || argument == "-") {
+        if(options.scene) usage();
+        options.scene = argv[index];
+        continue;
+      }
+      if(index + 1 == argc) usage();
+      char const * const value(argv[++index]);
+      if(argument == "--steps") {
+        options.steps = std::strtoul(value, nullptr, 10);
+      } else if(argument == "--time-step") {
+        options.time_step = std::strtof(value, nullptr);
+      } else if(argument == "--threads") {
+        options.threads = std::strtoul(value, nullptr, 10);
+      } else if(argument == "--state") {
+        options.state = value;
+      } else if(argument == "--snapshot") {
+        options.snapshot = value;
+      } else if(argument == "--record") {
+        options.record = value;
+      } else if(argument == "--trace") {
+        options.trace = value;
+      } else if(argument == "--frames") {
+        char * end;
+        options.first = std::strtoul(value, &end, 10);
+        if(*end != ':') usage();
+        options.last = std::strtoul(end + 1, nullptr, 10);
+      } else {
+        usage();
+      }
+    }
+    if(!options.scene || !(options.time_step > 0.0f)) usage();
+    if(!options.last) {
+      options.last = static_cast<std::uint32_t>(options.steps);
+      options.first = options.last > 100 ? options.last - 99 : 1;
+    }
+    return options;
+  }
+
+#ifdef SANDBOX_PROFILE
+  void report(sandbox::profiler::sample const & total, double const elapsed) {
+    std::printf("%-14s %12s %10s %6s\n", "stage", "total ms", "ms/step", "share");
+    for(std::size_t stage(0); stage < sandbox::profiler::stages; ++stage) {
+      auto const time(total.times[stage]);
+      std::printf("%-14s %12.3f %10.4f %5.1f%%\n", sandbox::profiler::name(static_cast<sandbox::profiler::stage_t>(stage)), time, time / total.steps, 100.0 * time / elapsed);
+    }
+    std::printf("%-14s %12.3f %10.4f %5.1f%%\n", "other", elapsed - total.total(), (elapsed - total.total()) / total.steps, 100.0 * (elapsed - total.total()) / elapsed);
+
+    std::printf("\n%-14s %12s %10s\n", "count", "total", "per step");
+    for(std::size_t counter(0); counter < sandbox::profiler::counters; ++counter) {
+      auto const count(total.counts[counter]);
+      std::printf("%-14s %12lu %10.1f\n", sandbox::profiler::name(static_cast<sandbox::profiler::counter_t>(counter)), static_cast<unsigned long>(count), static_cast<double>(count) / total.steps);
+    }
+  }
+#endif
+
+}
+
+int main(int argc, char ** argv) {
+  auto const options(parse(argc, argv));
+
+  std::shared_ptr<sandbox::simulation> simulation;
+  try {
+    std::ifstream file;
+    if(std::strcmp(options.scene, "-")) {
+      file.open(options.scene, std::ios::binary);
+      if(!file) throw std::runtime_error(std::string("Cannot open ") + options.scene);
+    }
+    std::istream & input(file.is_open() ? file : std::cin);
+    std::string const data((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    if(sandbox::is_snapshot(data.data(), data.size())) {
+      simulation = sandbox::load_snapshot(data.data(), data.size());
+    } else {
+      std::istringstream scene(data);
+      simulation = sandbox::load_scene(scene);
+    }
+  } catch(std::exception const & error) {
+    std::cerr << options.scene << ": " << error.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  auto & scheduler(sandbox::scheduler::instance());
+  if(options.threads) scheduler.concurrency(options.threads);
+
+  std::printf("%s: %u bodies, %u steps of %g s on %u threads\n", options.scene, static_cast<unsigned>(simulation->objects().size()), static_cast<unsigned>(options.steps), options.time_step, static_cast<unsigned>(scheduler.concurrency()));
+
+  std::ofstream record;
+  if(options.record) {
+    record.open(options.record, std::ios::binary);
+    if(!record) {
+      std::cerr << "Cannot open " << options.record << '\n';
+      return EXIT_FAILURE;
+    }
+    simulation->recorder(std::make_shared<sandbox::recorder>(record));
+  }
+
+  auto & tracer(sandbox::tracer::instance());
+  if(options.trace) {
+    tracer.clear();
+    tracer.enabled(true);
+  }
+
+#ifdef SANDBOX_PROFILE
+  // One sub-step per call, each call's sample adds to the run's total
+  sandbox::profiler::sample total = sandbox::profiler::sample();
+#endif
+  auto const start(std::chrono::steady_clock::now());
+  for(std::size_t step(0); step < options.steps; ++step) {
+    simulation->step(options.time_step, options.time_step);
+#ifdef SANDBOX_PROFILE
+    auto const & profiler(simulation->getProfiler());
+    if(profiler.empty()) continue;
+    auto const & sample(profiler.last());
+    total.steps += sample.steps;
+    for(std::size_t stage(0); stage < sandbox::profiler::stages; ++stage) {
+      total.times[stage] += sample.times[stage];
+    }
+    for(std::size_t counter(0); counter < sandbox::profiler::counters; ++counter) {
+      total.counts[counter] += sample.counts[counter];
+    }
+#endif
+  }
+  std::chrono::duration<double, std::milli> const elapsed(std::chrono::steady_clock::now() - start);
+  tracer.enabled(false);
+
+  std::printf("%.3f ms, %.4f ms/step, %d awake, state %016llx\n\n", elapsed.count(), elapsed.count() / std::max<std::size_t>(options.steps, 1), static_cast<int>(simulation->awake().size()), static_cast<unsigned long long>(simulation->state_hash()));
+#ifdef SANDBOX_PROFILE
+  if(total.steps) report(total, elapsed.count());
+#else
+  std::printf("stage times need SANDBOX_PROFILE\n");
+#endif
+
+  if(options.record) {
+    try {
+      simulation->recorder()->close();
+    } catch(std::exception const & error) {
+      std::cerr << options.record << ": " << error.what() << '\n';
+      return EXIT_FAILURE;
+    }
+    std::printf("\nrecorded %u frames, %lld bytes\n", static_cast<unsigned>(simulation->recorder()->frames()), static_cast<long long>(record.tellp()));
+  }
+
+  if(options.trace) {
+#ifndef SANDBOX_TRACE
+    std::cerr << "traces need SANDBOX_TRACE\n";
+#endif
+    std::ofstream file(options.trace);
+    if(!file) {
+      std::cerr << "Cannot open " << options.trace << '\n';
+      return EXIT_FAILURE;
+    }
+    tracer.write(file, options.first, options.last);
+  }
+
+  if(options.state) {
+    std::ofstream file;
+    if(std::strcmp(options.state, "-")) {
+      file.open(options.state);
+      if(!file) {
+        std::cerr << "Cannot open " << options.state << '\n';
+        return EXIT_FAILURE;
+      }
+    }
+    std::fflush(stdout);
+    sandbox::save_state(*simulation, file.is_open() ? file : std::cout);
+  }
+
+  if(options.snapshot) {
+    std::ofstream file(options.snapshot, std::ios::binary);
+    if(!file) {
+      std::cerr << "Cannot open " << options.snapshot << '\n';
+      return EXIT_FAILURE;
+    }
+    sandbox::save_snapshot(*simulation, file, true);
+  }
+}
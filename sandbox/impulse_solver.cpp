@@ -0,0 +1,234 @@
+#include "impulse_solver.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "misc.hpp"
+
+namespace sandbox {
+
+  namespace {
+
+    // Approach speed below which contacts do not bounce
+    float const restitution_threshold(1.0f);
+
+    float const normal_tolerance(0.01f);
+
+    float inverse(float const value) {
+      return value > 0.0f ? 1.0f / value : 0.0f;
+    }
+
+  }
+
+  std::uint32_t const impulse_solver::serial_color;
+
+  void impulse_solver::solve(std::vector<contact> & contacts, bodies & bodies, float const time_step) {
+    auto const& masses(bodies.masses());
+    auto const& moments_of_inertia(bodies.moments_of_inertia());
+    auto const& kinematic(bodies.kinematic());
+    auto& positions(bodies.positions());
+    auto& orientations(bodies.orientations());
+    auto& dirty(bodies.dirty());
+    auto& linear_velocities(bodies.linear_velocities());
+    auto& angular_velocities(bodies.angular_velocities());
+
+    statistics_ = statistics();
+
+    uncolored_.clear();
+    for(auto& contact : contacts) {
+      // Overlapping cores can leave the narrowphase without a usable normal
+      if(std::abs(contact.normal().length_squared() - 1.0f) > normal_tolerance) {
+        contact.impulse(0.0f);
+        continue;
+      }
+
+      constraint constraint;
+      constraint.source = &contact;
+      constraint.a = contact.a();
+      constraint.b = contact.b();
+      constraint.normal = contact.normal();
+      constraint.ar = contact.ap() - positions[constraint.a];
+      constraint.br = contact.bp() - positions[constraint.b];
+      constraint.a_inverse_mass = kinematic[constraint.a] ? 0.0f : inverse(masses[constraint.a]);
+      constraint.a_inverse_inertia = kinematic[constraint.a] ? 0.0f : inverse(moments_of_inertia[constraint.a]);
+      constraint.b_inverse_mass = kinematic[constraint.b] ? 0.0f : inverse(masses[constraint.b]);
+      constraint.b_inverse_inertia = kinematic[constraint.b] ? 0.0f : inverse(moments_of_inertia[constraint.b]);
+
+      float const an(constraint.ar.cross(constraint.normal));
+      float const bn(constraint.br.cross(constraint.normal));
+      constraint.mass = inverse(constraint.a_inverse_mass + constraint.b_inverse_mass +
+                                an * an * constraint.a_inverse_inertia + bn * bn * constraint.b_inverse_inertia);
+
+      // The normal points from b to a, so a separating contact has a
+      // positive normal velocity and an overlapping one a positive depth
+      float const velocity((linear_velocities[constraint.a] + constraint.ar.cross(angular_velocities[constraint.a]) -
+                            linear_velocities[constraint.b] - constraint.br.cross(angular_velocities[constraint.b])).dot(constraint.normal));
+      float const restitution(std::max(bodies.getMaterial(constraint.a).restitution(), bodies.getMaterial(constraint.b).restitution()));
+      float const depth((contact.bp() - contact.ap()).dot(constraint.normal));
+      float const correction(baumgarte_ / time_step * std::max(0.0f, depth - slop_));
+
+      constraint.bias = velocity < -restitution_threshold ? -restitution * velocity : 0.0f;
+      constraint.position_bias = 0.0f;
+      if(depth < 0.0f) {
+        // Not quite touching yet, the gap may still close within the step
+        constraint.bias = depth / time_step;
+      } else if(correction_ == correction_t::baumgarte) {
+        constraint.bias = std::max(constraint.bias, correction);
+      } else {
+        constraint.position_bias = correction;
+      }
+
+      constraint.tangent = constraint.normal.right();
+      float const at(constraint.ar.cross(constraint.tangent));
+      float const bt(constraint.br.cross(constraint.tangent));
+      constraint.tangent_mass = inverse(constraint.a_inverse_mass + constraint.b_inverse_mass +
+                                        at * at * constraint.a_inverse_inertia + bt * bt * constraint.b_inverse_inertia);
+      constraint.tangent_impulse = 0.0f;
+
+      constraint.impulse = std::max(0.0f, contact.impulse());
+      constraint.position_impulse = 0.0f;
+      uncolored_.push_back(constraint);
+    }
+    if(uncolored_.empty()) return;
+
+    // Coloring in pair order keeps the batches, and so the result, the same
+    // whatever order the contacts come in
+    std::stable_sort(uncolored_.begin(), uncolored_.end(), [](constraint const& lhs, constraint const& rhs) {
+      return lhs.a < rhs.a || (lhs.a == rhs.a && lhs.b < rhs.b);
+    });
+
+    color(bodies);
+
+    auto const apply([](constraint const& constraint, vector const& p, std::vector<vector>& linear, std::vector<float>& angular) {
+      if(constraint.a_inverse_mass > 0.0f) {
+        linear[constraint.a] += p * constraint.a_inverse_mass;
+        angular[constraint.a] += constraint.ar.cross(p) * constraint.a_inverse_inertia;
+      }
+      if(constraint.b_inverse_mass > 0.0f) {
+        linear[constraint.b] -= p * constraint.b_inverse_mass;
+        angular[constraint.b] -= constraint.br.cross(p) * constraint.b_inverse_inertia;
+      }
+    });
+
+    auto const relative_velocity([](constraint const& constraint, std::vector<vector> const& linear, std::vector<float> const& angular) {
+      return linear[constraint.a] + constraint.ar.cross(angular[constraint.a]) -
+             linear[constraint.b] - constraint.br.cross(angular[constraint.b]);
+    });
+
+    // Last step's impulses first, the iterations then only correct them
+    sweep([&](constraint const& constraint) {
+      if(constraint.impulse > 0.0f) apply(constraint, constraint.normal * constraint.impulse, linear_velocities, angular_velocities);
+    });
+
+    // Friction first, bounded by the normal impulse of the last iteration
+    for(std::size_t iteration(0); iteration < iterations_; ++iteration) {
+      sweep([&](constraint& constraint) {
+        float const limit(friction_ * constraint.impulse);
+        float const tangent_velocity(relative_velocity(constraint, linear_velocities, angular_velocities).dot(constraint.tangent));
+        float const tangent_accumulated(std::max(-limit, std::min(limit, constraint.tangent_impulse - constraint.tangent_mass * tangent_velocity)));
+        apply(constraint, constraint.tangent * (tangent_accumulated - constraint.tangent_impulse), linear_velocities, angular_velocities);
+        constraint.tangent_impulse = tangent_accumulated;
+
+        float const velocity(relative_velocity(constraint, linear_velocities, angular_velocities).dot(constraint.normal));
+        float const accumulated(std::max(0.0f, constraint.impulse + constraint.mass * (constraint.bias - velocity)));
+        apply(constraint, constraint.normal * (accumulated - constraint.impulse), linear_velocities, angular_velocities);
+        constraint.impulse = accumulated;
+      });
+    }
+
+    if(correction_ == correction_t::split_impulse) {
+      position_linear_velocities_.resize(bodies.size());
+      position_angular_velocities_.resize(bodies.size());
+
+      for(std::size_t iteration(0); iteration < iterations_; ++iteration) {
+        sweep([&](constraint& constraint) {
+          float const velocity(relative_velocity(constraint, position_linear_velocities_, position_angular_velocities_).dot(constraint.normal));
+          float const accumulated(std::max(0.0f, constraint.position_impulse + constraint.mass * (constraint.position_bias - velocity)));
+          apply(constraint, constraint.normal * (accumulated - constraint.position_impulse), position_linear_velocities_, position_angular_velocities_);
+          constraint.position_impulse = accumulated;
+        });
+      }
+
+      // The correcting velocities move the bodies once and are then dropped
+      auto const correct([&](std::size_t const body) {
+        dirty[body] = 1;
+        positions[body] += position_linear_velocities_[body] * time_step;
+        orientations[body] += position_angular_velocities_[body] * time_step;
+        position_linear_velocities_[body] = vector();
+        position_angular_velocities_[body] = 0.0f;
+      });
+      for(auto const& constraint : constraints_) {
+        if(constraint.a_inverse_mass > 0.0f) correct(constraint.a);
+        if(constraint.b_inverse_mass > 0.0f) correct(constraint.b);
+      }
+    }
+
+    for(auto const& constraint : constraints_) {
+      constraint.source->impulse(constraint.impulse);
+    }
+
+    statistics_.contacts = constraints_.size();
+    statistics_.iterations = iterations_;
+  }
+
+  void impulse_solver::color(bodies const & bodies) {
+    auto const n(uncolored_.size());
+    colors_.resize(n);
+    body_colors_.resize(bodies.size());
+
+    // Smallest color neither body has used yet, kinematic bodies are only
+    // read and may appear in every color
+    for(std::size_t i(0); i < n; ++i) {
+      auto const& constraint(uncolored_[i]);
+      std::uint64_t used(0);
+      if(constraint.a_inverse_mass > 0.0f) used |= body_colors_[constraint.a];
+      if(constraint.b_inverse_mass > 0.0f) used |= body_colors_[constraint.b];
+
+      std::uint32_t color(0);
+      while(color < serial_color && (used >> color) & 1u) ++color;
+      if(color < serial_color) {
+        auto const bit(std::uint64_t(1) << color);
+        if(constraint.a_inverse_mass > 0.0f) body_colors_[constraint.a] |= bit;
+        if(constraint.b_inverse_mass > 0.0f) body_colors_[constraint.b] |= bit;
+      }
+      colors_[i] = color;
+    }
+    for(auto const& constraint : uncolored_) {
+      body_colors_[constraint.a] = 0;
+      body_colors_[constraint.b] = 0;
+    }
+
+    // Stable counting sort by color keeps the order within every batch
+    batches_.assign(serial_color + 2, 0);
+    for(auto const color : colors_) {
+      ++batches_[color + 1];
+    }
+    for(std::size_t color(0); color <= serial_color; ++color) {
+      if(batches_[color + 1]) ++statistics_.colors;
+      batches_[color + 1] += batches_[color];
+    }
+    constraints_.resize(n);
+    for(std::size_t i(0); i < n; ++i) {
+      constraints_[batches_[colors_[i]]++] = uncolored_[i];
+    }
+    // Every offset moved to the end of its batch, shift them back
+    for(std::size_t color(serial_color + 1); color > 0; --color) {
+      batches_[color] = batches_[color - 1];
+    }
+    batches_[0] = 0;
+  }
+
+  template<typename Function>
+  void impulse_solver::sweep(Function function) {
+    for(std::uint32_t color(0); color < serial_color; ++color) {
+      if(batches_[color] == batches_[color + 1]) break;
+      parallel_for(batches_[color], batches_[color + 1], [&](std::size_t const i) {
+        function(constraints_[i]);
+      });
+    }
+    for(auto i(batches_[serial_color]); i < batches_[serial_color + 1]; ++i) {
+      function(constraints_[i]);
+    }
+  }
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vector.hpp"
+#include "bodies.hpp"
+#include "contact.hpp"
+
+namespace sandbox {
+
+  // Velocity level sequential impulse solve of all contacts. Each contact
+  // keeps the total impulse applied to it and only that total is clamped, so
+  // later iterations can take back what earlier ones overshot. Contacts are
+  // greedily colored so that no two of the same color share a dynamic body,
+  // and each color is solved in parallel without races, which makes the
+  // result independent of the number of threads.
+  class impulse_solver {
+  public:
+    // How penetration is removed: Baumgarte feeds it back into the velocities,
+    // split impulse solves it on separate velocities that only move positions
+    enum class correction_t {
+      baumgarte,
+      split_impulse
+    };
+
+    struct statistics {
+      std::size_t contacts;
+      std::size_t colors;
+      std::size_t iterations;
+    };
+
+    impulse_solver(std::size_t const iterations = 10, correction_t const correction = correction_t::split_impulse, float const baumgarte = 0.2f, float const slop = 0.5f, float const friction = 0.5f) : iterations_(iterations), correction_(correction), baumgarte_(baumgarte), slop_(slop), friction_(friction), statistics_() {
+    }
+
+    std::size_t iterations() const {
+      return iterations_;
+    }
+
+    void iterations(std::size_t const value) {
+      iterations_ = value;
+    }
+
+    correction_t correction() const {
+      return correction_;
+    }
+
+    void correction(correction_t const value) {
+      correction_ = value;
+    }
+
+    // Fraction of the penetration removed per step
+    float baumgarte() const {
+      return baumgarte_;
+    }
+
+    void baumgarte(float const value) {
+      baumgarte_ = value;
+    }
+
+    // Penetration left alone so resting contacts do not jitter
+    float slop() const {
+      return slop_;
+    }
+
+    void slop(float const value) {
+      slop_ = value;
+    }
+
+    // Coulomb friction coefficient, the tangent impulse stays within this
+    // fraction of the normal one
+    float friction() const {
+      return friction_;
+    }
+
+    void friction(float const value) {
+      friction_ = value;
+    }
+
+    statistics const & getStatistics() const {
+      return statistics_;
+    }
+
+    // Solves all contacts at once, starting from the impulses already on them,
+    // and stores the accumulated impulses back on them
+    void solve(std::vector<contact> & contacts, bodies & bodies, float const time_step);
+
+  private:
+    // Contacts that could not get one of the 64 colors are solved serially
+    static std::uint32_t const serial_color = 64;
+
+    struct constraint {
+      contact * source;
+      std::size_t a;
+      std::size_t b;
+      vector normal;
+      vector ar;
+      vector br;
+      float a_inverse_mass;
+      float a_inverse_inertia;
+      float b_inverse_mass;
+      float b_inverse_inertia;
+      float mass;
+      vector tangent;
+      float tangent_mass;
+      float tangent_impulse;
+      float bias;
+      float position_bias;
+      float impulse;
+      float position_impulse;
+    };
+
+    std::size_t iterations_;
+    correction_t correction_;
+    float baumgarte_;
+    float slop_;
+    float friction_;
+    statistics statistics_;
+
+    // Constraints ordered by color, each color one batch
+    std::vector<constraint> constraints_;
+    std::vector<constraint> uncolored_;
+    std::vector<std::uint32_t> colors_;
+    std::vector<std::size_t> batches_;
+
+    std::vector<std::uint64_t> body_colors_;
+    std::vector<vector> position_linear_velocities_;
+    std::vector<float> position_angular_velocities_;
+
+    void color(bodies const & bodies);
+
+    template<typename Function>
+    void sweep(Function function);
+  };
+
+}
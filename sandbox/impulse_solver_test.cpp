@@ -0,0 +1,72 @@
+#include <boost/test/unit_test.hpp>
+
+#include "impulse_solver.hpp"
+#include "scheduler.hpp"
+#include "test_fixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(impulse_solver)
+
+BOOST_AUTO_TEST_CASE(column) {
+  test::scene scene(1, 5);
+  sandbox::impulse_solver solver(10);
+
+  // Warm started from the previous steps the column comes to rest
+  for(unsigned int step(0); step < 50; ++step) {
+    scene.gravity(0.01f);
+    solver.solve(scene.contacts, scene.bodies, 0.01f);
+  }
+
+  auto const & statistics(solver.getStatistics());
+  BOOST_CHECK_EQUAL(statistics.contacts, 10u);
+  BOOST_CHECK_EQUAL(statistics.iterations, 10u);
+  // Every box has at most four contacts, and the floor does not count
+  BOOST_CHECK_LE(statistics.colors, 4u);
+
+  for(std::size_t body(1); body < scene.bodies.size(); ++body) {
+    BOOST_CHECK_SMALL(scene.bodies.linear_velocities()[body].y(), 1e-2f);
+    BOOST_CHECK_SMALL(scene.bodies.angular_velocities()[body], 1e-3f);
+  }
+
+  // The bottom contacts carry the weight of the whole column
+  auto const weight(scene.bodies.masses()[1] * 9.81f * 0.01f);
+  auto const & contacts(scene.contacts);
+  BOOST_CHECK_CLOSE(contacts[0].impulse() + contacts[1].impulse(), 5.0f * weight, 1.0f);
+  BOOST_CHECK_CLOSE(contacts[8].impulse() + contacts[9].impulse(), weight, 1.0f);
+  for(auto const & contact : contacts) {
+    BOOST_CHECK_GE(contact.impulse(), 0.0f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+  std::vector<sandbox::vector> linear_velocities;
+  std::vector<float> angular_velocities;
+
+  for(auto const threads : { 0u, 4u }) {
+    sandbox::scheduler::instance().concurrency(threads);
+
+    // Enough contacts for every color to be solved in parallel
+    test::scene scene(600, 3);
+    for(std::size_t body(1); body < scene.bodies.size(); ++body) {
+      scene.bodies.angular_velocities()[body] = 0.01f * static_cast<float>(body % 7);
+    }
+    scene.gravity(0.01f);
+
+    sandbox::impulse_solver solver;
+    solver.solve(scene.contacts, scene.bodies, 0.01f);
+
+    if(linear_velocities.empty()) {
+      linear_velocities = scene.bodies.linear_velocities();
+      angular_velocities = scene.bodies.angular_velocities();
+    } else {
+      for(std::size_t body(0); body < scene.bodies.size(); ++body) {
+        BOOST_CHECK_EQUAL(linear_velocities[body].x(), scene.bodies.linear_velocities()[body].x());
+        BOOST_CHECK_EQUAL(linear_velocities[body].y(), scene.bodies.linear_velocities()[body].y());
+        BOOST_CHECK_EQUAL(angular_velocities[body], scene.bodies.angular_velocities()[body]);
+      }
+    }
+  }
+
+  sandbox::scheduler::instance().concurrency(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,79 @@
+#include "islands.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace sandbox {
+
+  std::uint32_t const islands::no_island;
+
+  std::uint32_t islands::find(std::uint32_t body) {
+    while(parents_[body] != body) {
+      parents_[body] = parents_[parents_[body]];
+      body = parents_[body];
+    }
+    return body;
+  }
+
+  void islands::build(std::vector<pair_t> const & pairs, std::vector<char> const & kinematic) {
+    auto const n(pairs.size());
+
+    if(parents_.size() < kinematic.size()) {
+      auto const size(parents_.size());
+      parents_.resize(kinematic.size());
+      std::iota(parents_.begin() + size, parents_.end(), static_cast<std::uint32_t>(size));
+      labels_.resize(kinematic.size(), no_island);
+    }
+
+    // The lower index becomes the root, which keeps the labeling independent
+    // of the order pairs are joined in
+    for(auto const & pair : pairs) {
+      if(kinematic[pair.first] || kinematic[pair.second]) continue;
+      auto const a(find(static_cast<std::uint32_t>(pair.first)));
+      auto const b(find(static_cast<std::uint32_t>(pair.second)));
+      if(a < b) parents_[b] = a;
+      else if(b < a) parents_[a] = b;
+    }
+
+    counts_.clear();
+    pair_islands_.resize(n);
+    for(std::size_t i(0); i < n; ++i) {
+      auto const & pair(pairs[i]);
+      auto const root(find(static_cast<std::uint32_t>(kinematic[pair.first] ? pair.second : pair.first)));
+      if(labels_[root] == no_island) {
+        labels_[root] = static_cast<std::uint32_t>(counts_.size());
+        counts_.push_back(0);
+      }
+      pair_islands_[i] = labels_[root];
+      ++counts_[labels_[root]];
+    }
+
+    order_.resize(counts_.size());
+    std::iota(order_.begin(), order_.end(), 0u);
+    std::stable_sort(order_.begin(), order_.end(), [&](std::uint32_t const lhs, std::uint32_t const rhs) {
+      return counts_[lhs] > counts_[rhs];
+    });
+
+    offsets_.resize(counts_.size() + 1);
+    starts_.resize(counts_.size());
+    offsets_[0] = 0;
+    for(std::size_t i(0); i < order_.size(); ++i) {
+      starts_[order_[i]] = offsets_[i];
+      offsets_[i + 1] = offsets_[i] + counts_[order_[i]];
+    }
+
+    pairs_.resize(n);
+    for(std::size_t i(0); i < n; ++i) {
+      pairs_[starts_[pair_islands_[i]]++] = pairs[i];
+    }
+
+    // Only bodies that took part were touched, so resetting them keeps the
+    // cost proportional to the pairs rather than all bodies
+    for(auto const & pair : pairs) {
+      labels_[pair.first] = labels_[pair.second] = no_island;
+      parents_[pair.first] = static_cast<std::uint32_t>(pair.first);
+      parents_[pair.second] = static_cast<std::uint32_t>(pair.second);
+    }
+  }
+
+}
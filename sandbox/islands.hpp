@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sandbox {
+
+  // Groups of bodies connected through colliding pairs, found with a
+  // union-find over body indices. Kinematic bodies never join an island since
+  // nothing solved in one can move them, so a floor does not tie everything
+  // resting on it together. Pairs come out grouped by island as flat ranges,
+  // islands ordered largest first so handing them out in order balances the
+  // work across threads.
+  class islands {
+  public:
+    typedef std::pair<std::size_t, std::size_t> pair_t;
+
+    std::size_t size() const {
+      return offsets_.empty() ? 0 : offsets_.size() - 1;
+    }
+
+    // Pairs of island i are [offsets()[i], offsets()[i + 1])
+    std::vector<pair_t> const & pairs() const {
+      return pairs_;
+    }
+
+    std::vector<std::size_t> const & offsets() const {
+      return offsets_;
+    }
+
+    // Pairs must be oriented dynamic body first
+    void build(std::vector<pair_t> const & pairs, std::vector<char> const & kinematic);
+
+    void clear() {
+      pairs_.clear();
+      offsets_.clear();
+    }
+
+  private:
+    static std::uint32_t const no_island = 0xffffffff;
+
+    std::vector<std::uint32_t> parents_;
+    std::vector<std::uint32_t> labels_;
+    std::vector<std::uint32_t> pair_islands_;
+    std::vector<std::size_t> counts_;
+    std::vector<std::uint32_t> order_;
+    std::vector<std::size_t> starts_;
+
+    std::vector<pair_t> pairs_;
+    std::vector<std::size_t> offsets_;
+
+    std::uint32_t find(std::uint32_t body);
+  };
+
+}
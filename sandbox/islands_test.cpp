@@ -0,0 +1,107 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include "islands.hpp"
+
+BOOST_AUTO_TEST_SUITE(islands)
+
+typedef sandbox::islands::pair_t pair_t;
+
+// Island of every pair found by flooding the bodies instead
+std::vector<std::size_t> flood(std::vector<pair_t> const & pairs, std::vector<char> const & kinematic) {
+  std::vector<std::size_t> labels(kinematic.size(), pairs.size());
+  std::size_t next(0);
+  for(std::size_t body(0); body < kinematic.size(); ++body) {
+    if(kinematic[body] || labels[body] != pairs.size()) continue;
+    std::vector<std::size_t> stack(1, body);
+    labels[body] = next;
+    while(!stack.empty()) {
+      auto const current(stack.back());
+      stack.pop_back();
+      for(auto const & pair : pairs) {
+        if(kinematic[pair.first] || kinematic[pair.second]) continue;
+        std::size_t other(kinematic.size());
+        if(pair.first == current) other = pair.second;
+        else if(pair.second == current) other = pair.first;
+        if(other != kinematic.size() && labels[other] == pairs.size()) {
+          labels[other] = next;
+          stack.push_back(other);
+        }
+      }
+    }
+    ++next;
+  }
+  return labels;
+}
+
+BOOST_AUTO_TEST_CASE(kinematic) {
+  // Two stacks on a kinematic floor stay separate islands
+  std::vector<char> const kinematic { 1, 0, 0, 0, 0, 0 };
+  std::vector<pair_t> const pairs { { 1, 0 }, { 4, 0 }, { 2, 1 }, { 3, 2 }, { 5, 4 } };
+
+  sandbox::islands islands;
+  islands.build(pairs, kinematic);
+
+  BOOST_REQUIRE_EQUAL(islands.size(), 2u);
+  // Largest first
+  BOOST_CHECK_EQUAL(islands.offsets()[1] - islands.offsets()[0], 3u);
+  BOOST_CHECK_EQUAL(islands.offsets()[2] - islands.offsets()[1], 2u);
+
+  std::set<std::size_t> first, second;
+  for(auto i(islands.offsets()[0]); i < islands.offsets()[1]; ++i) first.insert(islands.pairs()[i].first);
+  for(auto i(islands.offsets()[1]); i < islands.offsets()[2]; ++i) second.insert(islands.pairs()[i].first);
+  BOOST_CHECK(first == std::set<std::size_t>({ 1, 2, 3 }));
+  BOOST_CHECK(second == std::set<std::size_t>({ 4, 5 }));
+
+  // Rebuilding starts over
+  islands.build(std::vector<pair_t>{ { 2, 1 } }, kinematic);
+  BOOST_CHECK_EQUAL(islands.size(), 1u);
+  islands.build(std::vector<pair_t>(), kinematic);
+  BOOST_CHECK_EQUAL(islands.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(random) {
+  std::mt19937 generator(7);
+  std::size_t const bodies(300);
+  std::uniform_int_distribution<std::size_t> body(0, bodies - 1);
+
+  std::vector<char> kinematic(bodies, 0);
+  for(std::size_t i(0); i < bodies; i += 17) kinematic[i] = 1;
+
+  sandbox::islands islands;
+  for(std::size_t round(0); round < 5; ++round) {
+    std::vector<pair_t> pairs;
+    for(std::size_t i(0); i < 200; ++i) {
+      auto a(body(generator)), b(body(generator));
+      if(a == b || (kinematic[a] && kinematic[b])) continue;
+      if(kinematic[a]) std::swap(a, b);
+      pairs.emplace_back(a, b);
+    }
+    islands.build(pairs, kinematic);
+    auto const labels(flood(pairs, kinematic));
+
+    // Every pair comes out exactly once
+    auto sorted(pairs), out(islands.pairs());
+    std::sort(sorted.begin(), sorted.end());
+    std::sort(out.begin(), out.end());
+    BOOST_CHECK(sorted == out);
+
+    // Pairs in a range share their flooded island and no two ranges do
+    std::set<std::size_t> seen;
+    for(std::size_t island(0); island < islands.size(); ++island) {
+      auto const begin(islands.offsets()[island]), end(islands.offsets()[island + 1]);
+      BOOST_REQUIRE_LT(begin, end);
+      if(island) BOOST_CHECK_GE(islands.offsets()[island] - islands.offsets()[island - 1], end - begin);
+      auto const label(labels[islands.pairs()[begin].first]);
+      BOOST_CHECK(seen.insert(label).second);
+      for(auto i(begin); i < end; ++i) {
+        BOOST_CHECK_EQUAL(labels[islands.pairs()[i].first], label);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,311 @@
+#include "kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SANDBOX_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SANDBOX_SSE2
+#endif
+
+namespace sandbox {
+
+  namespace kernels {
+
+    // Points are loaded straight from the vector arrays as x, y pairs
+    static_assert(sizeof(vector) == 2 * sizeof(float), "vector is not a pair of floats");
+
+    // Below this many points the plain support loop compiles to conditional
+    // moves and wins over setting up and folding the registers
+    std::size_t const wide_support(16);
+
+    namespace scalar {
+
+      std::size_t support(vector const * points, std::size_t const count, vector const & direction) {
+        std::size_t support(0);
+        float maximum(direction.dot(points[0]));
+        for(std::size_t i(1); i < count; ++i) {
+          float const dot(direction.dot(points[i]));
+          if(dot > maximum) {
+            support = i;
+            maximum = dot;
+          }
+        }
+        return support;
+      }
+
+      void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result) {
+        for(std::size_t i(0); i < count; ++i) {
+          auto const & point(points[i]);
+          result[i] = vector(cos * point.x() - sin * point.y(), sin * point.x() + cos * point.y()) + position;
+        }
+      }
+
+      rectangle bounds(vector const * points, std::size_t const count) {
+        auto x_min(points[0].x()), x_max(points[0].x()), y_min(points[0].y()), y_max(points[0].y());
+        for(std::size_t i(1); i < count; ++i) {
+          x_min = std::min(x_min, points[i].x());
+          x_max = std::max(x_max, points[i].x());
+          y_min = std::min(y_min, points[i].y());
+          y_max = std::max(y_max, points[i].y());
+        }
+        return rectangle(vector(x_min, y_min), vector(x_max, y_max));
+      }
+
+    }
+
+#if defined(SANDBOX_AVX2)
+
+    char const * instruction_set() {
+      return "avx2";
+    }
+
+    // Four points to a register, the dot product of each ending up in both of
+    // its lanes. Lanes track their best point, indices kept as floats so the
+    // final pick is a minimum over the lanes holding the maximum, all without
+    // branching on the data.
+    std::size_t support(vector const * points, std::size_t const count, vector const & direction) {
+      if(count < wide_support) return scalar::support(points, count, direction);
+
+      auto const data(reinterpret_cast<float const *>(points));
+      __m256 const directions(_mm256_setr_ps(direction.x(), direction.y(), direction.x(), direction.y(), direction.x(), direction.y(), direction.x(), direction.y()));
+      __m256 const step(_mm256_set1_ps(4.0f));
+
+      auto const full(count & ~std::size_t(3));
+      __m256 indices(_mm256_setr_ps(0.0f, 0.0f, 1.0f, 1.0f, 2.0f, 2.0f, 3.0f, 3.0f));
+      __m256 best(_mm256_setzero_ps()), best_indices(indices);
+      for(std::size_t i(0); i < full; i += 4) {
+        __m256 const products(_mm256_mul_ps(_mm256_loadu_ps(data + 2 * i), directions));
+        __m256 const dots(_mm256_add_ps(products, _mm256_permute_ps(products, _MM_SHUFFLE(2, 3, 0, 1))));
+        if(i) {
+          __m256 const better(_mm256_cmp_ps(dots, best, _CMP_GT_OQ));
+          best = _mm256_blendv_ps(best, dots, better);
+          best_indices = _mm256_blendv_ps(best_indices, indices, better);
+        } else {
+          best = dots;
+        }
+        indices = _mm256_add_ps(indices, step);
+      }
+
+      __m128 low(_mm256_castps256_ps128(best)), high(_mm256_extractf128_ps(best, 1));
+      __m128 low_indices(_mm256_castps256_ps128(best_indices)), high_indices(_mm256_extractf128_ps(best_indices, 1));
+      __m128 maximum(_mm_max_ps(low, high));
+      maximum = _mm_max_ps(maximum, _mm_movehl_ps(maximum, maximum));
+      maximum = _mm_shuffle_ps(maximum, maximum, 0);
+      __m128 const none(_mm_set1_ps(static_cast<float>(count)));
+      __m128 candidates(_mm_min_ps(_mm_blendv_ps(none, low_indices, _mm_cmpeq_ps(low, maximum)), _mm_blendv_ps(none, high_indices, _mm_cmpeq_ps(high, maximum))));
+      candidates = _mm_min_ps(candidates, _mm_movehl_ps(candidates, candidates));
+      auto support(static_cast<std::size_t>(_mm_cvtss_f32(candidates)));
+      if(support == count) support = 0;
+
+      // Leftovers only win by beating every full register
+      float best_dot(_mm_cvtss_f32(maximum));
+      for(std::size_t i(full); i < count; ++i) {
+        float const dot(direction.dot(points[i]));
+        if(dot > best_dot) {
+          support = i;
+          best_dot = dot;
+        }
+      }
+      return support;
+    }
+
+    void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result) {
+      auto const data(reinterpret_cast<float const *>(points));
+      auto const out(reinterpret_cast<float *>(result));
+      __m256 const coss(_mm256_set1_ps(cos));
+      __m256 const sins(_mm256_setr_ps(-sin, sin, -sin, sin, -sin, sin, -sin, sin));
+      __m256 const positions(_mm256_setr_ps(position.x(), position.y(), position.x(), position.y(), position.x(), position.y(), position.x(), position.y()));
+
+      std::size_t i(0);
+      for(; i + 4 <= count; i += 4) {
+        __m256 const xy(_mm256_loadu_ps(data + 2 * i));
+        __m256 const yx(_mm256_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm256_storeu_ps(out + 2 * i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xy, coss), _mm256_mul_ps(yx, sins)), positions));
+      }
+      scalar::transform(points + i, count - i, position, sin, cos, result + i);
+    }
+
+    rectangle bounds(vector const * points, std::size_t const count) {
+      if(count < 4) return scalar::bounds(points, count);
+
+      auto const data(reinterpret_cast<float const *>(points));
+      __m256 minimum(_mm256_loadu_ps(data)), maximum(minimum);
+      std::size_t i(4);
+      for(; i + 4 <= count; i += 4) {
+        __m256 const xy(_mm256_loadu_ps(data + 2 * i));
+        minimum = _mm256_min_ps(minimum, xy);
+        maximum = _mm256_max_ps(maximum, xy);
+      }
+
+      // Fold the four pairs down to one
+      __m128 low(_mm_min_ps(_mm256_castps256_ps128(minimum), _mm256_extractf128_ps(minimum, 1)));
+      __m128 high(_mm_max_ps(_mm256_castps256_ps128(maximum), _mm256_extractf128_ps(maximum, 1)));
+      low = _mm_min_ps(low, _mm_movehl_ps(low, low));
+      high = _mm_max_ps(high, _mm_movehl_ps(high, high));
+
+      alignas(16) float values[8];
+      _mm_store_ps(values, low);
+      _mm_store_ps(values + 4, high);
+      auto x_min(values[0]), y_min(values[1]), x_max(values[4]), y_max(values[5]);
+      for(; i < count; ++i) {
+        x_min = std::min(x_min, points[i].x());
+        x_max = std::max(x_max, points[i].x());
+        y_min = std::min(y_min, points[i].y());
+        y_max = std::max(y_max, points[i].y());
+      }
+      return rectangle(vector(x_min, y_min), vector(x_max, y_max));
+    }
+
+#elif defined(SANDBOX_SSE2)
+
+    char const * instruction_set() {
+      return "sse2";
+    }
+
+    // Two points to a register, the dot product of each ending up in both of
+    // its lanes. Lanes track their best point, indices kept as floats so the
+    // final pick is a minimum over the lanes holding the maximum, all without
+    // branching on the data.
+    std::size_t support(vector const * points, std::size_t const count, vector const & direction) {
+      if(count < wide_support) return scalar::support(points, count, direction);
+
+      auto const data(reinterpret_cast<float const *>(points));
+      __m128 const directions(_mm_setr_ps(direction.x(), direction.y(), direction.x(), direction.y()));
+      __m128 const step(_mm_set1_ps(2.0f));
+
+      auto const full(count & ~std::size_t(1));
+      __m128 indices(_mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f));
+      __m128 best(_mm_setzero_ps()), best_indices(indices);
+      for(std::size_t i(0); i < full; i += 2) {
+        __m128 const products(_mm_mul_ps(_mm_loadu_ps(data + 2 * i), directions));
+        __m128 const dots(_mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1))));
+        if(i) {
+          __m128 const better(_mm_cmpgt_ps(dots, best));
+          best = _mm_or_ps(_mm_and_ps(better, dots), _mm_andnot_ps(better, best));
+          best_indices = _mm_or_ps(_mm_and_ps(better, indices), _mm_andnot_ps(better, best_indices));
+        } else {
+          best = dots;
+        }
+        indices = _mm_add_ps(indices, step);
+      }
+
+      __m128 maximum(_mm_max_ps(best, _mm_movehl_ps(best, best)));
+      maximum = _mm_shuffle_ps(maximum, maximum, 0);
+      __m128 const winners(_mm_cmpeq_ps(best, maximum));
+      __m128 candidates(_mm_or_ps(_mm_and_ps(winners, best_indices), _mm_andnot_ps(winners, _mm_set1_ps(static_cast<float>(count)))));
+      candidates = _mm_min_ps(candidates, _mm_movehl_ps(candidates, candidates));
+      auto support(static_cast<std::size_t>(_mm_cvtss_f32(candidates)));
+      if(support == count) support = 0;
+
+      // A leftover point only wins by beating every pair
+      if(full < count && direction.dot(points[full]) > _mm_cvtss_f32(maximum)) support = full;
+      return support;
+    }
+
+    void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result) {
+      auto const data(reinterpret_cast<float const *>(points));
+      auto const out(reinterpret_cast<float *>(result));
+      __m128 const coss(_mm_set1_ps(cos));
+      __m128 const sins(_mm_setr_ps(-sin, sin, -sin, sin));
+      __m128 const positions(_mm_setr_ps(position.x(), position.y(), position.x(), position.y()));
+
+      std::size_t i(0);
+      for(; i + 2 <= count; i += 2) {
+        __m128 const xy(_mm_loadu_ps(data + 2 * i));
+        __m128 const yx(_mm_shuffle_ps(xy, xy, _MM_SHUFFLE(2, 3, 0, 1)));
+        _mm_storeu_ps(out + 2 * i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(xy, coss), _mm_mul_ps(yx, sins)), positions));
+      }
+      scalar::transform(points + i, count - i, position, sin, cos, result + i);
+    }
+
+    rectangle bounds(vector const * points, std::size_t const count) {
+      if(count < 2) return scalar::bounds(points, count);
+
+      auto const data(reinterpret_cast<float const *>(points));
+      __m128 minimum(_mm_loadu_ps(data)), maximum(minimum);
+      std::size_t i(2);
+      for(; i + 2 <= count; i += 2) {
+        __m128 const xy(_mm_loadu_ps(data + 2 * i));
+        minimum = _mm_min_ps(minimum, xy);
+        maximum = _mm_max_ps(maximum, xy);
+      }
+      minimum = _mm_min_ps(minimum, _mm_movehl_ps(minimum, minimum));
+      maximum = _mm_max_ps(maximum, _mm_movehl_ps(maximum, maximum));
+
+      alignas(16) float values[8];
+      _mm_store_ps(values, minimum);
+      _mm_store_ps(values + 4, maximum);
+      auto x_min(values[0]), y_min(values[1]), x_max(values[4]), y_max(values[5]);
+      if(i < count) {
+        x_min = std::min(x_min, points[i].x());
+        x_max = std::max(x_max, points[i].x());
+        y_min = std::min(y_min, points[i].y());
+        y_max = std::max(y_max, points[i].y());
+      }
+      return rectangle(vector(x_min, y_min), vector(x_max, y_max));
+    }
+
+#else
+
+    char const * instruction_set() {
+      return "scalar";
+    }
+
+    std::size_t support(vector const * points, std::size_t const count, vector const & direction) {
+      return scalar::support(points, count, direction);
+    }
+
+    void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result) {
+      scalar::transform(points, count, position, sin, cos, result);
+    }
+
+    rectangle bounds(vector const * points, std::size_t const count) {
+      return scalar::bounds(points, count);
+    }
+
+#endif
+
+    // Angles become 32 bit fractions of a turn, the top two bits the quadrant
+    // and the rest the angle within it, which goes through Taylor series in
+    // fixed point with 30 fractional bits. Integer arithmetic rounds the same
+    // everywhere, and every term stays positive until the last one of the
+    // cosine, so the divisions never truncate a negative value.
+    void sin_cos(float const angle, float & sin, float & cos) {
+      std::int64_t const one(std::int64_t(1) << 30);
+      std::int64_t const half_pi(1686629713);
+
+      auto const turns(static_cast<std::uint64_t>(std::llround(static_cast<double>(angle) * 683565275.5764316)));
+      auto const quadrant(static_cast<unsigned>(turns >> 30) & 3u);
+      auto const theta(static_cast<std::int64_t>(turns & (one - 1)) * half_pi / one);
+      auto const theta_squared(theta * theta / one);
+
+      std::int64_t s(one), c(one);
+      for(std::int64_t const k : { 210, 156, 110, 72, 42, 20, 6 }) {
+        s = one - theta_squared * s / (k * one);
+      }
+      s = theta * s / one;
+      for(std::int64_t const k : { 240, 182, 132, 90, 56, 30, 12, 2 }) {
+        c = one - theta_squared * c / (k * one);
+      }
+
+      float const scale(1.0f / static_cast<float>(one));
+      float const x(static_cast<float>(c) * scale), y(static_cast<float>(s) * scale);
+      switch(quadrant) {
+        case 0: sin = y; cos = x; break;
+        case 1: sin = x; cos = -y; break;
+        case 2: sin = -y; cos = -x; break;
+        default: sin = -x; cos = y; break;
+      }
+    }
+
+  }
+
+}
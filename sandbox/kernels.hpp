@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+#include "vector.hpp"
+#include "rectangle.hpp"
+
+namespace sandbox {
+
+  // Loops over arrays of points that the narrowphase and world shape updates
+  // spend most of their time in. The instruction set is picked when building:
+  // AVX2 when the compiler targets it, SSE2 on any x86-64, plain loops
+  // otherwise. Results match the plain loops, up to rounding where the
+  // compiler fuses their multiply-adds.
+  namespace kernels {
+
+    // "avx2", "sse2" or "scalar"
+    char const * instruction_set();
+
+    // Index of the point furthest along direction, the first one on ties
+    std::size_t support(vector const * points, std::size_t const count, vector const & direction);
+
+    // Rotates the points by the angle with the given sine and cosine, then
+    // translates them by position
+    void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result);
+
+    rectangle bounds(vector const * points, std::size_t const count);
+
+    // Sine and cosine in integer arithmetic, bit for bit the same on every
+    // platform and instruction set, which the C library's are not. Off by
+    // little more than the rounding to float.
+    void sin_cos(float const angle, float & sin, float & cos);
+
+    // Plain loops, always available to compare against
+    namespace scalar {
+
+      std::size_t support(vector const * points, std::size_t const count, vector const & direction);
+
+      void transform(vector const * points, std::size_t const count, vector const & position, float const sin, float const cos, vector * result);
+
+      rectangle bounds(vector const * points, std::size_t const count);
+
+    }
+
+  }
+
+}
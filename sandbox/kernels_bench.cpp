@@ -0,0 +1,99 @@
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "kernels.hpp"
+
+// Times the kernels against the plain loops shape used to run, over a batch
+// of polygons with as many vertices as the scenes use and a few more. Part of
+// the bench program, named kernels/<kernel>/<scalar or instruction set>/<vertices>
+// with one iteration covering the whole batch.
+namespace {
+
+  std::size_t const polygons(4096);
+
+  struct batch {
+    std::size_t vertices;
+    std::vector<sandbox::vector> points;
+    std::vector<sandbox::vector> result;
+    std::vector<sandbox::vector> directions;
+    std::vector<sandbox::rectangle> boxes;
+
+    explicit batch(std::size_t const vertices) : vertices(vertices), points(polygons * vertices), result(points.size()), directions(polygons), boxes(polygons) {
+      std::mt19937 generator(1);
+      std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+      std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+      for(auto & point : points) {
+        point = sandbox::vector(coordinate(generator), coordinate(generator));
+      }
+      for(auto & direction : directions) {
+        auto const a(angle(generator));
+        direction = sandbox::vector(std::cos(a), std::sin(a));
+      }
+    }
+  };
+
+  template<bool simd>
+  void support(sandbox::benchmark::state & state) {
+    batch const batch(static_cast<std::size_t>(state.argument(0)));
+    auto const vertices(batch.vertices);
+    while(state.keep_running()) {
+      std::size_t total(0);
+      for(std::size_t i(0); i < polygons; ++i) {
+        total += simd ? sandbox::kernels::support(&batch.points[i * vertices], vertices, batch.directions[i]) : sandbox::kernels::scalar::support(&batch.points[i * vertices], vertices, batch.directions[i]);
+      }
+      sandbox::benchmark::keep(total);
+    }
+    state.items(polygons);
+  }
+
+  template<bool simd>
+  void transform(sandbox::benchmark::state & state) {
+    batch batch(static_cast<std::size_t>(state.argument(0)));
+    auto const vertices(batch.vertices);
+    float const sin(std::sin(0.3f)), cos(std::cos(0.3f));
+    while(state.keep_running()) {
+      for(std::size_t i(0); i < polygons; ++i) {
+        if(simd) {
+          sandbox::kernels::transform(&batch.points[i * vertices], vertices, batch.directions[i], sin, cos, &batch.result[i * vertices]);
+        } else {
+          sandbox::kernels::scalar::transform(&batch.points[i * vertices], vertices, batch.directions[i], sin, cos, &batch.result[i * vertices]);
+        }
+      }
+    }
+    sandbox::benchmark::keep(batch.result[0].x());
+    state.items(polygons);
+  }
+
+  template<bool simd>
+  void bounds(sandbox::benchmark::state & state) {
+    batch batch(static_cast<std::size_t>(state.argument(0)));
+    auto const vertices(batch.vertices);
+    while(state.keep_running()) {
+      for(std::size_t i(0); i < polygons; ++i) {
+        batch.boxes[i] = simd ? sandbox::kernels::bounds(&batch.points[i * vertices], vertices) : sandbox::kernels::scalar::bounds(&batch.points[i * vertices], vertices);
+      }
+    }
+    sandbox::benchmark::keep(batch.boxes[0].top_left().x());
+    state.items(polygons);
+  }
+
+  // Registered before main
+  struct registrar {
+    registrar() {
+      std::vector<std::vector<long>> const vertices = { { 4 }, { 8 }, { 16 }, { 32 } };
+      std::string const simd(sandbox::kernels::instruction_set());
+      sandbox::benchmark::add("kernels/support/scalar", &support<false>, vertices);
+      sandbox::benchmark::add("kernels/transform/scalar", &transform<false>, vertices);
+      sandbox::benchmark::add("kernels/bounds/scalar", &bounds<false>, vertices);
+      // Builds without vector instructions run the scalar loops either way
+      if(simd == "scalar") return;
+      sandbox::benchmark::add("kernels/support/" + simd, &support<true>, vertices);
+      sandbox::benchmark::add("kernels/transform/" + simd, &transform<true>, vertices);
+      sandbox::benchmark::add("kernels/bounds/" + simd, &bounds<true>, vertices);
+    }
+  } const registered;
+
+}
@@ -0,0 +1,86 @@
+#include <boost/test/unit_test.hpp>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "kernels.hpp"
+
+BOOST_AUTO_TEST_SUITE(kernels)
+
+std::vector<sandbox::vector> points(std::mt19937 & generator, std::size_t const count) {
+  std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+  std::vector<sandbox::vector> points;
+  for(std::size_t i(0); i < count; ++i) {
+    points.emplace_back(coordinate(generator), coordinate(generator));
+  }
+  return points;
+}
+
+BOOST_AUTO_TEST_CASE(support) {
+  std::mt19937 generator(3);
+  std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+  // Every count covers a different mix of full registers and leftovers
+  for(std::size_t count(1); count < 40; ++count) {
+    auto const points(kernels::points(generator, count));
+    for(std::size_t round(0); round < 20; ++round) {
+      auto const a(angle(generator));
+      sandbox::vector const direction(std::cos(a), std::sin(a));
+      BOOST_CHECK_EQUAL(sandbox::kernels::support(points.data(), count, direction), sandbox::kernels::scalar::support(points.data(), count, direction));
+    }
+  }
+
+  // The first of equally good points wins, whichever lane it lands in
+  std::vector<sandbox::vector> ties(23);
+  ties[5] = ties[9] = ties[20] = ties[22] = sandbox::vector(1, 0);
+  ties[13] = ties[22] = sandbox::vector(0, 1);
+  BOOST_CHECK_EQUAL(sandbox::kernels::support(ties.data(), ties.size(), sandbox::vector(1, 0)), 5u);
+  BOOST_CHECK_EQUAL(sandbox::kernels::support(ties.data(), ties.size(), sandbox::vector(0, 1)), 13u);
+  BOOST_CHECK_EQUAL(sandbox::kernels::support(ties.data(), ties.size(), sandbox::vector(-1, -1)), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(transform) {
+  std::mt19937 generator(5);
+  for(std::size_t count(1); count < 20; ++count) {
+    auto const points(kernels::points(generator, count));
+    std::vector<sandbox::vector> expected(count), result(count);
+    sandbox::vector const position(12.5f, -40.0f);
+    sandbox::kernels::scalar::transform(points.data(), count, position, std::sin(0.7f), std::cos(0.7f), expected.data());
+    sandbox::kernels::transform(points.data(), count, position, std::sin(0.7f), std::cos(0.7f), result.data());
+    for(std::size_t i(0); i < count; ++i) {
+      BOOST_CHECK_SMALL(result[i].x() - expected[i].x(), 1e-4f);
+      BOOST_CHECK_SMALL(result[i].y() - expected[i].y(), 1e-4f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(bounds) {
+  std::mt19937 generator(7);
+  for(std::size_t count(1); count < 20; ++count) {
+    auto const points(kernels::points(generator, count));
+    auto const expected(sandbox::kernels::scalar::bounds(points.data(), count));
+    auto const box(sandbox::kernels::bounds(points.data(), count));
+    BOOST_CHECK_EQUAL(box.top_left().x(), expected.top_left().x());
+    BOOST_CHECK_EQUAL(box.top_left().y(), expected.top_left().y());
+    BOOST_CHECK_EQUAL(box.bottom_right().x(), expected.bottom_right().x());
+    BOOST_CHECK_EQUAL(box.bottom_right().y(), expected.bottom_right().y());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(sin_cos) {
+  float sin, cos;
+  sandbox::kernels::sin_cos(0.0f, sin, cos);
+  BOOST_CHECK_EQUAL(sin, 0.0f);
+  BOOST_CHECK_EQUAL(cos, 1.0f);
+
+  // Every quadrant, whole turns away and negative angles
+  for(int i(-4000); i <= 4000; ++i) {
+    float const angle(i * 0.01f);
+    sandbox::kernels::sin_cos(angle, sin, cos);
+    BOOST_CHECK_SMALL(sin - std::sin(static_cast<double>(angle)), 1e-7);
+    BOOST_CHECK_SMALL(cos - std::cos(static_cast<double>(angle)), 1e-7);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
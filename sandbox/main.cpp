@@ -39,27 +39,27 @@ static void error_callback(int error, const char* description) {
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
   switch(key) {
     case GLFW_KEY_UP:
-      object1->linear_velocity() += sandbox::vector(0.0f, -5.0f);
+      object1->linear_velocity(object1->linear_velocity() + sandbox::vector(0.0f, -5.0f));
       break;
 
     case GLFW_KEY_DOWN:
-      object1->linear_velocity() += sandbox::vector(0.0f, 5.0f);
+      object1->linear_velocity(object1->linear_velocity() + sandbox::vector(0.0f, 5.0f));
       break;
 
     case GLFW_KEY_LEFT:
-      object1->linear_velocity() += sandbox::vector(-5.0f, 0.0f);
+      object1->linear_velocity(object1->linear_velocity() + sandbox::vector(-5.0f, 0.0f));
       break;
 
     case GLFW_KEY_RIGHT:
-      object1->linear_velocity() += sandbox::vector(5.0f, 0.0f);
+      object1->linear_velocity(object1->linear_velocity() + sandbox::vector(5.0f, 0.0f));
       break;
 
     case GLFW_KEY_KP_ADD:
-      object1->angular_velocity() += 5.0f * 0.01745329251994329576923690768489f;
+      object1->angular_velocity(object1->angular_velocity() + 5.0f * 0.01745329251994329576923690768489f);
       break;
 
     case GLFW_KEY_KP_SUBTRACT:
-      object1->angular_velocity() -= 5.0f * 0.01745329251994329576923690768489f;
+      object1->angular_velocity(object1->angular_velocity() - 5.0f * 0.01745329251994329576923690768489f);
       break;
 
     case GLFW_KEY_ENTER:
@@ -102,37 +102,37 @@ int main() {
 
   std::shared_ptr<sandbox::object> const wall_top(
       new sandbox::object(sandbox::shape(sandbox::rectangle(width * 2.0f, height).vertices()), wall_material));
-  wall_top->position() = sandbox::vector(half_width, 0.0f - half_height) + offset;
+  wall_top->position(sandbox::vector(half_width, 0.0f - half_height) + offset);
   wall_top->kinematic(true);
   simulation->objects().push_back(wall_top);
 
   std::shared_ptr<sandbox::object> const wall_right(
       new sandbox::object(sandbox::shape(sandbox::rectangle(width, height * 2.0f).vertices()), wall_material));
-  wall_right->position() = sandbox::vector(width + half_width, half_height) + offset;
+  wall_right->position(sandbox::vector(width + half_width, half_height) + offset);
   wall_right->kinematic(true);
   simulation->objects().push_back(wall_right);
 
   std::shared_ptr<sandbox::object> const wall_bottom(
       new sandbox::object(sandbox::shape(sandbox::rectangle(width * 2.0f, height).vertices()), wall_material));
-  wall_bottom->position() = sandbox::vector(half_width, height + half_height) + offset;
+  wall_bottom->position(sandbox::vector(half_width, height + half_height) + offset);
   wall_bottom->kinematic(true);
   simulation->objects().push_back(wall_bottom);
 
   std::shared_ptr<sandbox::object> const wall_left(
       new sandbox::object(sandbox::shape(sandbox::rectangle(width, height * 2.0f).vertices()), wall_material));
-  wall_left->position() = sandbox::vector(0.0f - half_width, half_height) + offset;
+  wall_left->position(sandbox::vector(0.0f - half_width, half_height) + offset);
   wall_left->kinematic(true);
   simulation->objects().push_back(wall_left);
 
   object1.reset(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()),
                                     sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
-  object1->position() = sandbox::vector(half_width, half_height + 160) + offset;
+  object1->position(sandbox::vector(half_width, half_height + 160) + offset);
   simulation->objects().push_back(object1);
 
   std::shared_ptr<sandbox::object> const object2(
       new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()),
                           sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
-  object2->position() = sandbox::vector(half_width + 40, half_height + 200) + offset;
+  object2->position(sandbox::vector(half_width + 40, half_height + 200) + offset);
   simulation->objects().push_back(object2);
 
   for(unsigned y(0); y < 10; ++y) {
@@ -140,7 +140,7 @@ int main() {
       std::shared_ptr<sandbox::object> const object(
           new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()),
                               sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
-      object->position() = sandbox::vector(half_width - (4 / 2 * 25) + ((x + 1) * 25), (y + 1) * 25) + offset;
+      object->position(sandbox::vector(half_width - (4 / 2 * 25) + ((x + 1) * 25), (y + 1) * 25) + offset);
       simulation->objects().push_back(object);
     }
   }
@@ -175,8 +175,9 @@ int main() {
 
     renderer->clear();
 
-    for(auto object : simulation->objects()) {
-      if(object->frozen()) {
+    for(std::size_t index(0); index < simulation->objects().size(); ++index) {
+      auto const& object(simulation->objects()[index]);
+      if(object->sleeping()) {
         glColor4f(0.0f, 0.0f, 1.0f, 1.0f);
       } else {
         auto const& color(object->getMaterial().getColor());
@@ -186,14 +187,14 @@ int main() {
 
 #ifdef SANDBOX_DRAW_CORES
       glColor4f(0.5, 0.5, 0.5, 1.0f);
-      renderer->render(object->getShape().core().vertices(), object->position(), object->orientation());
+      renderer->render(object->getCore(), object->position(), object->orientation());
 #endif
 
 #ifdef SANDBOX_DRAW_BOUNDING_BOXES
-      if(!simulation->bounding_boxes().empty()) {
+      if(index < simulation->bounding_boxes().size()) {
         glColor4f(1.0f, 0.0f, 1.0f, 1.0f);
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        renderer->render(simulation->bounding_boxes().at(object).vertices());
+        renderer->render(simulation->bounding_boxes()[index].vertices());
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
       }
@@ -214,18 +215,17 @@ int main() {
 #if defined(SANDBOX_DRAW_ISLANDS) || defined(SANDBOX_DRAW_CONTACTS)
     glColor4f(0.0f, 0.75, 0.0f, 1.0f);
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    for(auto const& island : simulation->contacts()) {
-      for(auto const& contact : island) {
+    for(auto const& contact : simulation->contacts()) {
 #ifdef SANDBOX_DRAW_ISLANDS
-        renderer->render(contact.b()->position() - contact.a()->position(), contact.a()->position());
-        renderer->render(contact.a()->position());
-        renderer->render(contact.b()->position());
+      auto const& positions(simulation->getBodies().positions());
+      renderer->render(positions[contact.b()] - positions[contact.a()], positions[contact.a()]);
+      renderer->render(positions[contact.a()]);
+      renderer->render(positions[contact.b()]);
 #endif
 #ifdef SANDBOX_DRAW_CONTACTS
-        renderer->render(contact.ap());
-        renderer->render(contact.bp());
+      renderer->render(contact.ap());
+      renderer->render(contact.bp());
 #endif
-      }
     }
 #endif
 
@@ -259,6 +259,25 @@ int main() {
     force << "Force: " << object1->force().x() << ", " << object1->force().y() << ")";
     renderer->render(force.str(), sandbox::vector(10.0f, 140.0f));
 
+    // Mean stage times over the profiler's history
+    auto const& profiler(simulation->getProfiler());
+    if(!profiler.empty()) {
+      auto const average(profiler.average());
+      std::stringstream stages;
+      stages << "Step: " << average.total() << " ms";
+      for(std::size_t stage(0); stage < sandbox::profiler::stages; ++stage) {
+        stages << (stage ? ", " : " (") << sandbox::profiler::name(static_cast<sandbox::profiler::stage_t>(stage)) << " " << average.times[stage];
+      }
+      stages << ")";
+      renderer->render(stages.str(), sandbox::vector(10.0f, 160.0f));
+
+      std::stringstream counts;
+      for(std::size_t counter(0); counter < sandbox::profiler::counters; ++counter) {
+        counts << (counter ? ", " : "") << sandbox::profiler::name(static_cast<sandbox::profiler::counter_t>(counter)) << ": " << average.counts[counter];
+      }
+      renderer->render(counts.str(), sandbox::vector(10.0f, 180.0f));
+    }
+
     renderer->swap_buffers();
 
     glfwPollEvents();
@@ -1,53 +1,189 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <thread>
-#include <future>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 #include "vector.hpp"
 #include "scheduler.hpp"
 
 namespace sandbox {
 
-  template<typename Iterator, typename Function>
-  void parallel_for_range(Iterator begin, Iterator end, Function function) {
-    static auto const threads(std::thread::hardware_concurrency());
-    auto const size(std::distance(begin, end));
-    std::vector<std::function<void()>> tasks;
-    auto const max_tasks(size <= threads ? size : threads);
-    auto const range(size <= threads ? 1 : size / threads);
-    for(unsigned int i(0), last(i + 1 == max_tasks); i < max_tasks; ++i, last = i + 1 == max_tasks) {
-      tasks.emplace_back(std::function<void()>([&, i, last]() {
-        auto start(begin + (range * i));
-        auto const finish(last ? end : start + range);
-        for(auto & j(start); j != finish; ++j) {
-          function(*j);
+  // Ranges at or below this many elements run inline on the calling thread
+  std::size_t const parallel_cutoff(32);
+
+  namespace detail {
+
+    inline std::size_t parallel_grain(std::size_t const size, std::size_t const threads, std::size_t const grain) {
+      // Four chunks per thread leaves room for balancing uneven work
+      return grain ? grain : std::max<std::size_t>(1, size / (threads * 4));
+    }
+
+    template<typename Function>
+    struct for_context {
+      std::size_t end;
+      std::size_t grain;
+      Function & function;
+      std::atomic<std::size_t> next;
+
+      for_context(std::size_t const begin, std::size_t const end, std::size_t const grain, Function & function) : end(end), grain(grain), function(function), next(begin) {
+      }
+
+      static void run(void * const context) {
+        auto & self(*static_cast<for_context *>(context));
+        for(auto start(self.next.fetch_add(self.grain)); start < self.end; start = self.next.fetch_add(self.grain)) {
+          auto const finish(std::min(start + self.grain, self.end));
+          for(auto index(start); index < finish; ++index) {
+            self.function(index);
+          }
         }
-      }));
+      }
+    };
+
+    template<typename T, typename Function, typename Combine>
+    struct reduce_context {
+      std::size_t end;
+      std::size_t grain;
+      T const & identity;
+      Function & function;
+      Combine & combine;
+      T & result;
+      std::mutex mutex;
+      std::atomic<std::size_t> next;
+
+      reduce_context(std::size_t const begin, std::size_t const end, std::size_t const grain, T const & identity, Function & function, Combine & combine, T & result) : end(end), grain(grain), identity(identity), function(function), combine(combine), result(result), next(begin) {
+      }
+
+      static void run(void * const context) {
+        auto & self(*static_cast<reduce_context *>(context));
+        T local(self.identity);
+        bool touched(false);
+        for(auto start(self.next.fetch_add(self.grain)); start < self.end; start = self.next.fetch_add(self.grain)) {
+          auto const finish(std::min(start + self.grain, self.end));
+          for(auto index(start); index < finish; ++index) {
+            self.function(local, index);
+          }
+          touched = true;
+        }
+        if(touched) {
+          std::lock_guard<std::mutex> const lock(self.mutex);
+          self.combine(self.result, std::move(local));
+        }
+      }
+    };
+
+  }
+
+  // Calls function(index) for every index in [begin, end). Chunks of grain
+  // indices are claimed dynamically by the caller and up to concurrency() - 1
+  // helper tasks, a grain of zero picks one from the range size. Nothing is
+  // allocated per call.
+  template<typename Function>
+  void parallel_for(std::size_t const begin, std::size_t const end, Function function, std::size_t const grain = 0, std::size_t const cutoff = parallel_cutoff) {
+    if(end <= begin) return;
+
+    auto & scheduler(scheduler::instance());
+    auto const size(end - begin);
+    auto const threads(scheduler.concurrency());
+    auto const chunk(detail::parallel_grain(size, threads, grain));
+    auto const chunks((size + chunk - 1) / chunk);
+
+    if(size <= cutoff || chunks == 1 || threads == 1) {
+      for(auto index(begin); index < end; ++index) {
+        function(index);
+      }
+      return;
+    }
+
+    typedef detail::for_context<Function> context_t;
+    context_t context(begin, end, chunk, function);
+
+    std::atomic<std::size_t> pending(std::min(chunks, threads) - 1);
+    for(std::size_t i(pending); i > 0; --i) {
+      scheduler.schedule({ &context_t::run, &context, &pending });
     }
-    for(auto const & task : scheduler::instance()->schedule(tasks)) task.wait();
+    context_t::run(&context);
+    scheduler.wait(pending);
   }
 
-  template<typename Iterator, typename Function>
-  void parallel_for_range_index(Iterator begin, Iterator end, Function function) {
-    static auto const threads(std::thread::hardware_concurrency());
-    auto const size(std::distance(begin, end));
-    std::vector<std::function<void()>> tasks;
-    auto const max_tasks(size <= threads ? size : threads);
-    auto const range(size <= threads ? 1 : size / threads);
-    for(unsigned int i(0), last(i + 1 == max_tasks); i < max_tasks; ++i, last = i + 1 == max_tasks) {
-      tasks.emplace_back(std::function<void()>([&, i, last]() {
-        auto const index_start(range * i);
-        auto start(begin + index_start);
-        auto const finish(last ? end : start + range);
-        auto index(index_start);
-        for (auto & j(start); j != finish; ++j) {
-          function(*j, index++);
-        }
-      }));
+  // Folds every index in [begin, end) into a copy of identity per participating
+  // thread with function(accumulator, index), then merges the partial results
+  // with combine(result, std::move(partial)). Partials are merged in completion
+  // order, so combine should be associative and commutative.
+  template<typename T, typename Function, typename Combine>
+  T parallel_reduce(std::size_t const begin, std::size_t const end, T const & identity, Function function, Combine combine, std::size_t const grain = 0, std::size_t const cutoff = parallel_cutoff) {
+    T result(identity);
+    if(end <= begin) return result;
+
+    auto & scheduler(scheduler::instance());
+    auto const size(end - begin);
+    auto const threads(scheduler.concurrency());
+    auto const chunk(detail::parallel_grain(size, threads, grain));
+    auto const chunks((size + chunk - 1) / chunk);
+
+    if(size <= cutoff || chunks == 1 || threads == 1) {
+      for(auto index(begin); index < end; ++index) {
+        function(result, index);
+      }
+      return result;
     }
-    for(auto const & task : scheduler::instance()->schedule(tasks)) task.wait();
+
+    typedef detail::reduce_context<T, Function, Combine> context_t;
+    context_t context(begin, end, chunk, identity, function, combine, result);
+
+    std::atomic<std::size_t> pending(std::min(chunks, threads) - 1);
+    for(std::size_t i(pending); i > 0; --i) {
+      scheduler.schedule({ &context_t::run, &context, &pending });
+    }
+    context_t::run(&context);
+    scheduler.wait(pending);
+    return result;
   }
 
+  // Result buffers for parallel stages, one per scheduler thread, so tasks can
+  // append without locking. Buffers keep their capacity between uses. Only one
+  // thread outside of the pool may drive a stage using them at a time.
+  template<typename T>
+  class thread_buffers {
+  public:
+    void clear() {
+      buffers_.resize(scheduler::instance().concurrency());
+      for(auto & buffer : buffers_) buffer.clear();
+    }
+
+    std::vector<T> & local() {
+      return buffers_[scheduler::current()];
+    }
+
+    std::size_t size() const {
+      std::size_t size(0);
+      for(auto const & buffer : buffers_) size += buffer.size();
+      return size;
+    }
+
+    // Concatenates all buffers into result and sorts it, which makes the
+    // output independent of how the work was spread across threads. Equal
+    // elements appended by the same task keep their order.
+    template<typename Compare>
+    void merge(std::vector<T> & result, Compare compare) const {
+      result.clear();
+      result.reserve(size());
+      for(auto const & buffer : buffers_) {
+        result.insert(result.end(), buffer.begin(), buffer.end());
+      }
+      std::stable_sort(result.begin(), result.end(), compare);
+    }
+
+    void merge(std::vector<T> & result) const {
+      merge(result, std::less<T>());
+    }
+
+  private:
+    std::vector<std::vector<T>> buffers_;
+  };
+
 }
@@ -4,22 +4,27 @@
 
 namespace sandbox {
 
-  object::object(sandbox::shape const & shape, sandbox::material const & material) : shape_(shape), material_(material), orientation_(), angular_velocity_(), torque_(), kinematic_(false), frozen_(false) {
+  object::object(sandbox::shape const & shape, sandbox::material const & material) : shape_(shape), core_(shape.core()), material_(material), orientation_(), angular_velocity_(), torque_(), kinematic_(false), sleeping_(false), bodies_(nullptr), handle_() {
     mass_ = material.density() * shape.area();
+    moment_of_inertia_ = shape.moment_of_inertia(mass_);
+  }
 
-    float numerator(0.0f);
-    float denominator(0.0f);
+  object::~object() {
+    if(bodies_) bodies_->release(handle_);
+  }
 
-    std::vector<vector> const & vertices(shape.vertices());
-    for (int unsigned i(vertices.size() - 1), j(0); j < vertices.size(); i = j, ++j) {
-      vector const & vertex1(vertices[i]);
-      vector const & vertex2(vertices[j]);
-      float const cross(vertex2.cross(vertex1));
-      numerator += cross * (vertex2.dot(vertex2) + vertex2.dot(vertex1) + vertex1.dot(vertex1));
-      denominator += cross;
-    }
+  void object::detach() {
+    position_ = bodies_->positions_[handle_];
+    linear_velocity_ = bodies_->linear_velocities_[handle_];
+    orientation_ = bodies_->orientations_[handle_];
+    angular_velocity_ = bodies_->angular_velocities_[handle_];
+    force_ = bodies_->forces_[handle_];
+    torque_ = bodies_->torques_[handle_];
+    kinematic_ = bodies_->kinematic_[handle_] != 0;
+    sleeping_ = bodies_->sleeping_[handle_] != 0;
 
-    moment_of_inertia_ = mass_ / 6.0f * (numerator / denominator);
+    bodies_->release(handle_);
+    bodies_ = nullptr;
   }
 
 }
\ No newline at end of file
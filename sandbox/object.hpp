@@ -5,17 +5,26 @@
 #include "vector.hpp"
 #include "shape.hpp"
 #include "material.hpp"
+#include "bodies.hpp"
 
 namespace sandbox {
 
 class object {
 public:
 	object(shape const & shape, material const & material);
+	~object();
+
+	object(object const &) = delete;
+	object & operator =(object const &) = delete;
 
 	shape const & getShape() const {
 		return shape_;
 	}
 
+	shape const & getCore() const {
+		return core_;
+	}
+
 	material const & getMaterial() const {
 		return material_;
 	}
@@ -29,71 +38,92 @@ public:
 	}
 
 	vector const & position() const {
-		return position_;
+		return bodies_ ? bodies_->positions_[handle_] : position_;
 	}
 
-	vector & position() {
-		return position_;
+	// Moves the body, its world shape is recomputed on the next step
+	void position(vector const & value) {
+		if(!bodies_) {
+			position_ = value;
+			return;
+		}
+		bodies_->positions_[handle_] = value;
+		moved();
 	}
 
 	vector const & linear_velocity() const {
-		return linear_velocity_;
+		return bodies_ ? bodies_->linear_velocities_[handle_] : linear_velocity_;
 	}
 
-	vector & linear_velocity() {
-		return linear_velocity_;
+	void linear_velocity(vector const & value) {
+		if(!bodies_) {
+			linear_velocity_ = value;
+			return;
+		}
+		bodies_->linear_velocities_[handle_] = value;
+		changed();
 	}
 	
 	float const & orientation() const {
-		return orientation_;
+		return bodies_ ? bodies_->orientations_[handle_] : orientation_;
 	}
 
-	float & orientation() {
-		return orientation_;
+	void orientation(float const value) {
+		if(!bodies_) {
+			orientation_ = value;
+			return;
+		}
+		bodies_->orientations_[handle_] = value;
+		moved();
 	}
 
 	float const & angular_velocity() const {
-		return angular_velocity_;
+		return bodies_ ? bodies_->angular_velocities_[handle_] : angular_velocity_;
 	}
 
-	float & angular_velocity() {
-		return angular_velocity_;
+	void angular_velocity(float const value) {
+		if(!bodies_) {
+			angular_velocity_ = value;
+			return;
+		}
+		bodies_->angular_velocities_[handle_] = value;
+		changed();
 	}
 
 	vector const & force() const {
-		return force_;
-	}
-
-	vector & force() {
-		return force_;
+		return bodies_ ? bodies_->forces_[handle_] : force_;
 	}
 
 	float const & torque() const {
-		return torque_;
-	}
-
-	float & torque() {
-		return torque_;
+		return bodies_ ? bodies_->torques_[handle_] : torque_;
 	}
 
 	bool kinematic() const {
-		return kinematic_;
+		return bodies_ ? bodies_->kinematic_[handle_] != 0 : kinematic_;
 	}
 
 	void kinematic(bool const value) {
-		kinematic_ = value;
+		if(bodies_) bodies_->kinematic_[handle_] = value;
+		else kinematic_ = value;
 	}
 
-  bool frozen() const {
-    return frozen_;
-  }
+	bool sleeping() const {
+		return bodies_ ? bodies_->sleeping_[handle_] != 0 : sleeping_;
+	}
 
-  void frozen(bool const value) {
-      frozen_ = value;
-  }
+	// The whole island the body sleeps with wakes up on the next step.
+	// Changing its transform or velocity does the same.
+	void wake() {
+		if(bodies_) bodies_->wake(handle_);
+		else sleeping_ = false;
+	}
 
 private:
+	friend class bodies;
+
 	sandbox::shape const shape_;
+	// Computed once, the narrowphase only ever transforms it
+	sandbox::shape const core_;
 	sandbox::material const material_;
 
 	float mass_;
@@ -108,7 +138,25 @@ private:
 	float torque_;
 
 	bool kinematic_;
-  bool frozen_;
+	bool sleeping_;
+
+	// Set while the object is attached to a body store; the fields above then
+	// only hold the state from before it was attached.
+	sandbox::bodies * bodies_;
+	bodies::handle_t handle_;
+
+	void detach();
+
+	// Sleeping and kinematic bodies are left alone by the step, so changes
+	// from outside queue them to be woken or to have their shape recomputed
+	void changed() {
+		if(bodies_->sleeping_[handle_] || bodies_->kinematic_[handle_]) bodies_->wake(handle_);
+	}
+
+	void moved() {
+		bodies_->dirty_[handle_] = 1;
+		changed();
+	}
 };
 
 }
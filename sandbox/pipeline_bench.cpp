@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "collision.hpp"
+#include "color.hpp"
+#include "matrix.hpp"
+#include "quadtree.hpp"
+#include "scheduler.hpp"
+#include "simulation.hpp"
+
+// Times the pieces of the pipeline on their own and whole scenes stepping,
+// registered with the bench program. Scene benchmarks are named
+// scene/<scene>/<bodies>/<threads> and time one sub-step per iteration after
+// a short warm-up, reporting sub-steps and body steps per second.
+// --filter='^(?!scene/.*/100000/)' leaves out the largest.
+namespace {
+
+  float const time_step(0.005f);
+  std::size_t const warm_up(10);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  sandbox::shape polygon(std::size_t const vertices, float const radius) {
+    std::vector<sandbox::vector> points;
+    for(std::size_t vertex(0); vertex < vertices; ++vertex) {
+      auto const angle(6.2831853f * vertex / vertices);
+      points.push_back(sandbox::vector(radius * std::cos(angle), radius * std::sin(angle)));
+    }
+    return sandbox::shape(points);
+  }
+
+  sandbox::shape box(float const width, float const height) {
+    return sandbox::shape(sandbox::rectangle(width, height).vertices());
+  }
+
+  // Shapes
+
+  void intersects(sandbox::benchmark::state & state) {
+    auto const a(polygon(8, 10.0f).transform(sandbox::vector(0.0f, 0.0f), 0.3f));
+    auto const b(polygon(8, 10.0f).transform(sandbox::vector(state.argument(0) ? 15.0f : 25.0f, 2.0f), 0.7f));
+    while(state.keep_running()) {
+      sandbox::benchmark::keep(a.intersects(b));
+    }
+  }
+
+  void distance(sandbox::benchmark::state & state) {
+    auto const a(polygon(8, 10.0f).transform(sandbox::vector(0.0f, 0.0f), 0.3f));
+    auto const b(polygon(8, 10.0f).transform(sandbox::vector(30.0f, 5.0f), 0.7f));
+    while(state.keep_running()) {
+      sandbox::benchmark::keep(std::get<2>(a.distance(b)));
+    }
+  }
+
+  void transform(sandbox::benchmark::state & state) {
+    auto const shape(polygon(static_cast<std::size_t>(state.argument(0)), 10.0f));
+    sandbox::shape result;
+    float angle(0.0f);
+    while(state.keep_running()) {
+      shape.transform(sandbox::vector(5.0f, 5.0f), angle += 0.01f, result);
+    }
+    sandbox::benchmark::keep(result.vertices()[0].x());
+  }
+
+  void collide(sandbox::benchmark::state & state) {
+    auto const round(state.argument(0) != 0);
+    auto const a((round ? sandbox::shape::circle(8.0f) : box(20.0f, 20.0f)).transform(sandbox::vector(0.0f, 0.0f), 0.1f));
+    auto const b(box(20.0f, 20.0f).transform(sandbox::vector(3.0f, 17.0f), -0.05f));
+    sandbox::manifold manifold;
+    sandbox::collider_t collider;
+    while(state.keep_running()) {
+      sandbox::benchmark::keep(sandbox::collide(a, b, manifold, collider));
+    }
+  }
+
+  // Quadtree, over boxes scattered across a 4096 square
+
+  std::vector<sandbox::rectangle> scatter(std::size_t const count) {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> coordinate(0.0f, 4064.0f);
+    std::uniform_real_distribution<float> size(4.0f, 32.0f);
+    std::vector<sandbox::rectangle> boxes;
+    for(std::size_t index(0); index < count; ++index) {
+      sandbox::vector const top_left(coordinate(generator), coordinate(generator));
+      boxes.push_back(sandbox::rectangle(top_left, top_left + sandbox::vector(size(generator), size(generator))));
+    }
+    return boxes;
+  }
+
+  sandbox::rectangle const area(sandbox::vector(0.0f, 0.0f), sandbox::vector(4096.0f, 4096.0f));
+
+  void quadtree_insert(sandbox::benchmark::state & state) {
+    auto const boxes(scatter(static_cast<std::size_t>(state.argument(0))));
+    sandbox::quadtree quadtree(area);
+    while(state.keep_running()) {
+      quadtree.clear();
+      for(std::size_t index(0); index < boxes.size(); ++index) {
+        quadtree.insert(std::make_pair(index, boxes[index]));
+      }
+    }
+    state.items(boxes.size());
+  }
+
+  void quadtree_build(sandbox::benchmark::state & state) {
+    auto const boxes(scatter(static_cast<std::size_t>(state.argument(0))));
+    sandbox::quadtree quadtree(area);
+    while(state.keep_running()) {
+      quadtree.build(boxes);
+    }
+    state.items(boxes.size());
+  }
+
+  void quadtree_find(sandbox::benchmark::state & state) {
+    auto const boxes(scatter(static_cast<std::size_t>(state.argument(0))));
+    sandbox::quadtree quadtree(area);
+    quadtree.build(boxes);
+    std::vector<std::size_t> found;
+    std::size_t index(0);
+    while(state.keep_running()) {
+      found.clear();
+      quadtree.find(boxes[index], found);
+      if(++index == boxes.size()) index = 0;
+    }
+    sandbox::benchmark::keep(found.size());
+  }
+
+  void quadtree_pairs(sandbox::benchmark::state & state) {
+    auto const boxes(scatter(static_cast<std::size_t>(state.argument(0))));
+    sandbox::quadtree quadtree(area);
+    quadtree.build(boxes);
+    std::vector<sandbox::quadtree::pair_t> pairs;
+    while(state.keep_running()) {
+      pairs.clear();
+      quadtree.find_all_pairs(pairs);
+    }
+    state.items(boxes.size());
+    state.counter("pairs", static_cast<double>(pairs.size()));
+  }
+
+  // Matrices
+
+  sandbox::matrix<float> filled(unsigned const rows, unsigned const columns) {
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    sandbox::matrix<float> matrix(rows, columns);
+    for(unsigned row(0); row < rows; ++row) {
+      for(unsigned column(0); column < columns; ++column) {
+        matrix(row, column) = value(generator) + (row == column ? static_cast<float>(rows) : 0.0f);
+      }
+    }
+    return matrix;
+  }
+
+  void matrix_multiply(sandbox::benchmark::state & state) {
+    auto const size(static_cast<unsigned>(state.argument(0)));
+    auto const a(filled(size, size)), b(filled(size, size));
+    while(state.keep_running()) {
+      sandbox::benchmark::keep((a * b)(0, 0));
+    }
+  }
+
+  void matrix_transpose(sandbox::benchmark::state & state) {
+    auto const size(static_cast<unsigned>(state.argument(0)));
+    auto const a(filled(size, size));
+    while(state.keep_running()) {
+      sandbox::benchmark::keep(a.transpose()(0, 0));
+    }
+  }
+
+  // Augmented with the right hand side, diagonally dominant so it solves
+  void matrix_solve(sandbox::benchmark::state & state) {
+    auto const size(static_cast<unsigned>(state.argument(0)));
+    auto const system(filled(size, size + 1));
+    while(state.keep_running()) {
+      auto copy(system);
+      sandbox::benchmark::keep(copy.solve()(0));
+    }
+  }
+
+  // Scenes
+
+  std::shared_ptr<sandbox::object> add(sandbox::simulation & simulation, sandbox::shape const & shape, sandbox::vector const & position, bool const kinematic = false) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(shape, material));
+    object->position(position);
+    object->kinematic(kinematic);
+    simulation.objects().push_back(object);
+    return object;
+  }
+
+  // Piles of a thousand 10 unit boxes, 20 wide and 50 high, side by side on
+  // shelves stacked so the world stays about square
+  std::shared_ptr<sandbox::simulation> pile(std::size_t const bodies) {
+    std::size_t const columns(20), rows(50), gap(60), shelf(rows * 10 + 100);
+    auto const piles((bodies + columns * rows - 1) / (columns * rows));
+    auto const across(std::min(piles, static_cast<std::size_t>(std::ceil(std::sqrt(piles * 2.3)))));
+    auto const shelves((piles + across - 1) / across);
+    auto const width(static_cast<float>(across * (columns * 10 + gap) + gap));
+    std::shared_ptr<sandbox::simulation> simulation(new sandbox::simulation(width, static_cast<float>(shelves * shelf)));
+    for(std::size_t index(0); index < shelves; ++index) {
+      add(*simulation, box(width, 20.0f), sandbox::vector(width / 2, (index + 1) * shelf - 10.0f), true);
+    }
+
+    auto const shape(box(10.0f, 10.0f));
+    for(std::size_t body(0); body < bodies; ++body) {
+      auto const pile(body / (columns * rows)), column(body % columns), row(body % (columns * rows) / columns);
+      auto const floor(static_cast<float>((pile / across + 1) * shelf - 20));
+      add(*simulation, shape, sandbox::vector(static_cast<float>(gap + pile % across * (columns * 10 + gap) + column * 10 + 5), floor - row * 10 - 5));
+    }
+    return simulation;
+  }
+
+  // Circles packed loosely in a walled bin, thrown down with some spread
+  std::shared_ptr<sandbox::simulation> pour(std::size_t const bodies) {
+    auto const columns(static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(bodies)))));
+    auto const width(static_cast<float>(columns * 10 + 40));
+    auto const height(static_cast<float>((bodies + columns - 1) / columns * 10 + 80));
+    std::shared_ptr<sandbox::simulation> simulation(new sandbox::simulation(width, height));
+    add(*simulation, box(width, 20.0f), sandbox::vector(width / 2, height - 10.0f), true);
+    add(*simulation, box(20.0f, height), sandbox::vector(10.0f, height / 2), true);
+    add(*simulation, box(20.0f, height), sandbox::vector(width - 10.0f, height / 2), true);
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f), spread(-20.0f, 20.0f), fall(20.0f, 60.0f);
+    auto const shape(sandbox::shape::circle(4.0f));
+    for(std::size_t body(0); body < bodies; ++body) {
+      auto const object(add(*simulation, shape, sandbox::vector(25.0f + body % columns * 10 + jitter(generator), 25.0f + body / columns * 10 + jitter(generator))));
+      object->linear_velocity(sandbox::vector(spread(generator), fall(generator)));
+    }
+    return simulation;
+  }
+
+  // Boxes, circles and capsules 40 units apart drifting slowly, so the
+  // broadphase finds few pairs
+  std::shared_ptr<sandbox::simulation> field(std::size_t const bodies) {
+    auto const columns(static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(bodies)))));
+    auto const size(static_cast<float>(columns * 40 + 40));
+    std::shared_ptr<sandbox::simulation> simulation(new sandbox::simulation(size, size));
+
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> velocity(-20.0f, 20.0f), spin(-1.0f, 1.0f);
+    sandbox::shape const shapes[] = { box(10.0f, 10.0f), sandbox::shape::circle(5.0f), sandbox::shape::capsule(sandbox::vector(-5.0f, 0.0f), sandbox::vector(5.0f, 0.0f), 3.0f) };
+    for(std::size_t body(0); body < bodies; ++body) {
+      auto const object(add(*simulation, shapes[body % 3], sandbox::vector(40.0f + body % columns * 40, 40.0f + body / columns * 40)));
+      object->linear_velocity(sandbox::vector(velocity(generator), velocity(generator)));
+      object->angular_velocity(spin(generator));
+    }
+    return simulation;
+  }
+
+  template<std::shared_ptr<sandbox::simulation> (*Scene)(std::size_t const)>
+  void scene(sandbox::benchmark::state & state) {
+    auto const bodies(static_cast<std::size_t>(state.argument(0)));
+    sandbox::scheduler::instance().concurrency(static_cast<std::size_t>(state.argument(1)));
+    auto const simulation(Scene(bodies));
+    simulation->solver(sandbox::simulation::solver_t::sequential_impulse);
+    // Sleeping piles would leave nothing to time
+    simulation->allow_sleeping(false);
+    for(std::size_t step(0); step < warm_up; ++step) {
+      simulation->step(time_step, time_step);
+    }
+
+    while(state.keep_running()) {
+      simulation->step(time_step, time_step);
+    }
+    state.items(bodies);
+    state.counter("substeps_per_second", state.iterations() / state.seconds());
+    state.counter("threads", static_cast<double>(sandbox::scheduler::instance().concurrency()));
+  }
+
+  // Fewer steps for larger scenes keep every run around a second
+  void add_scene(std::string const & name, sandbox::benchmark::function_t const function, std::vector<long> const & threads) {
+    for(auto const & size : { std::make_pair(1000l, 200u), std::make_pair(10000l, 40u), std::make_pair(100000l, 5u) }) {
+      std::vector<std::vector<long>> arguments;
+      for(auto const count : threads) arguments.push_back({ size.first, count });
+      sandbox::benchmark::add(name, function, arguments, size.second);
+    }
+  }
+
+  // Registered before main
+  struct registrar {
+    registrar() {
+      sandbox::benchmark::add("shape/intersects", &intersects, { { 1 }, { 0 } });
+      sandbox::benchmark::add("shape/distance", &distance);
+      sandbox::benchmark::add("shape/transform", &transform, { { 4 }, { 16 } });
+      sandbox::benchmark::add("collision/collide", &collide, { { 0 }, { 1 } });
+      sandbox::benchmark::add("quadtree/insert", &quadtree_insert, { { 1024 }, { 16384 } });
+      sandbox::benchmark::add("quadtree/build", &quadtree_build, { { 1024 }, { 16384 } });
+      sandbox::benchmark::add("quadtree/find", &quadtree_find, { { 1024 }, { 16384 } });
+      sandbox::benchmark::add("quadtree/pairs", &quadtree_pairs, { { 1024 }, { 16384 } });
+      sandbox::benchmark::add("matrix/multiply", &matrix_multiply, { { 16 }, { 64 } });
+      sandbox::benchmark::add("matrix/transpose", &matrix_transpose, { { 64 } });
+      sandbox::benchmark::add("matrix/solve", &matrix_solve, { { 16 }, { 64 } });
+
+      // Powers of two up to the cores there are, and all of them
+      std::vector<long> threads;
+      long const cores(std::max(1u, std::thread::hardware_concurrency()));
+      for(long count(1); count < cores; count *= 2) threads.push_back(count);
+      threads.push_back(cores);
+      add_scene("scene/pile", &scene<pile>, threads);
+      add_scene("scene/pour", &scene<pour>, threads);
+      add_scene("scene/field", &scene<field>, threads);
+    }
+  } const registered;
+
+}
@@ -0,0 +1,98 @@
+#include "profiler.hpp"
+
+#include <numeric>
+
+namespace sandbox {
+
+  std::size_t const profiler::stages;
+  std::size_t const profiler::counters;
+
+  double profiler::sample::total() const {
+    return std::accumulate(times, times + stages, 0.0);
+  }
+
+  char const * profiler::name(stage_t const stage) {
+    switch(stage) {
+      case stage_t::forces:
+        return "forces";
+      case stage_t::world_shapes:
+        return "world_shapes";
+      case stage_t::broadphase:
+        return "broadphase";
+      case stage_t::collisions:
+        return "collisions";
+      case stage_t::islands:
+        return "islands";
+      case stage_t::contacts:
+        return "contacts";
+      case stage_t::solve:
+        return "solve";
+      case stage_t::integrate:
+        return "integrate";
+      case stage_t::sleeping:
+        return "sleeping";
+    }
+    return "";
+  }
+
+  char const * profiler::name(counter_t const counter) {
+    switch(counter) {
+      case counter_t::bodies:
+        return "bodies";
+      case counter_t::pairs:
+        return "pairs";
+      case counter_t::hits:
+        return "hits";
+      case counter_t::islands:
+        return "islands";
+      case counter_t::contacts:
+        return "contacts";
+      case counter_t::iterations:
+        return "iterations";
+    }
+    return "";
+  }
+
+  void profiler::capacity(std::size_t const value) {
+    samples_.assign(value, sample());
+    clear();
+  }
+
+  profiler::sample profiler::average() const {
+    sample result = sample();
+    for(std::size_t index(0); index < size_; ++index) {
+      auto const & sample((*this)[index]);
+      result.steps += sample.steps;
+      for(std::size_t stage(0); stage < stages; ++stage) {
+        result.times[stage] += sample.times[stage];
+      }
+      for(std::size_t counter(0); counter < counters; ++counter) {
+        result.counts[counter] += sample.counts[counter];
+      }
+    }
+    if(!result.steps) return result;
+
+    for(std::size_t stage(0); stage < stages; ++stage) {
+      result.times[stage] /= static_cast<double>(result.steps);
+    }
+    for(std::size_t counter(0); counter < counters; ++counter) {
+      result.counts[counter] /= result.steps;
+    }
+    result.steps = 1;
+    return result;
+  }
+
+  void profiler::begin() {
+    current_ = sample();
+  }
+
+  void profiler::end() {
+    // Calls too short for a sub-step did no work worth keeping
+    if(samples_.empty() || !current_.steps) return;
+
+    samples_[next_] = current_;
+    next_ = (next_ + 1) % samples_.size();
+    if(size_ < samples_.size()) ++size_;
+  }
+
+}
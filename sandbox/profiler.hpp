@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "trace.hpp"
+
+// simulation::step times its stages and counts its work only when built with
+// SANDBOX_PROFILE defined, otherwise the hooks expand to nothing and the
+// profiler's history stays empty. Built with SANDBOX_TRACE the stages are
+// traced as well, with or without SANDBOX_PROFILE.
+#ifdef SANDBOX_PROFILE
+#define SANDBOX_PROFILE_BEGIN(instance) (instance).begin()
+#define SANDBOX_PROFILE_STEP(instance) (instance).step()
+#define SANDBOX_PROFILE_END(instance) (instance).end()
+#define SANDBOX_PROFILE_STAGE(instance, stage, statement) \
+  { \
+    SANDBOX_TRACE_SCOPE(#stage); \
+    sandbox::profiler::timer const profile_timer_((instance), sandbox::profiler::stage_t::stage); \
+    statement; \
+  }
+#define SANDBOX_PROFILE_COUNT(instance, counter, value) (instance).count(sandbox::profiler::counter_t::counter, (value))
+#else
+#define SANDBOX_PROFILE_BEGIN(instance)
+#define SANDBOX_PROFILE_STEP(instance)
+#define SANDBOX_PROFILE_END(instance)
+#define SANDBOX_PROFILE_STAGE(instance, stage, statement) \
+  { \
+    SANDBOX_TRACE_SCOPE(#stage); \
+    statement; \
+  }
+#define SANDBOX_PROFILE_COUNT(instance, counter, value)
+#endif
+
+namespace sandbox {
+
+  // Rolling history of where the calls to simulation::step spent their time,
+  // one sample per call, the oldest dropped once capacity() are kept
+  class profiler {
+  public:
+    enum class stage_t : unsigned char {
+      forces,
+      world_shapes,
+      broadphase,
+      collisions,
+      islands,
+      contacts,
+      solve,
+      integrate,
+      sleeping
+    };
+
+    static std::size_t const stages = 9;
+
+    enum class counter_t : unsigned char {
+      bodies,
+      pairs,
+      hits,
+      islands,
+      contacts,
+      iterations
+    };
+
+    static std::size_t const counters = 6;
+
+    // Times in milliseconds and counts both add up over the sub-steps of the
+    // call, steps being their number
+    struct sample {
+      std::size_t steps;
+      double times[stages];
+      std::size_t counts[counters];
+
+      double time(stage_t const stage) const {
+        return times[static_cast<std::size_t>(stage)];
+      }
+
+      std::size_t count(counter_t const counter) const {
+        return counts[static_cast<std::size_t>(counter)];
+      }
+
+      double total() const;
+    };
+
+    // Times a stage for as long as it lives
+    class timer {
+    public:
+      timer(profiler & profiler, stage_t const stage) : profiler_(profiler), stage_(stage), start_(std::chrono::steady_clock::now()) {
+      }
+
+      ~timer() {
+        std::chrono::duration<double, std::milli> const elapsed(std::chrono::steady_clock::now() - start_);
+        profiler_.time(stage_, elapsed.count());
+      }
+
+      timer(timer const &) = delete;
+      timer & operator=(timer const &) = delete;
+
+    private:
+      profiler & profiler_;
+      stage_t const stage_;
+      std::chrono::steady_clock::time_point const start_;
+    };
+
+    profiler(std::size_t const capacity = 120) : samples_(capacity), next_(0), size_(0), current_() {
+    }
+
+    static char const * name(stage_t const stage);
+    static char const * name(counter_t const counter);
+
+    std::size_t capacity() const {
+      return samples_.size();
+    }
+
+    // Changing the capacity drops the history
+    void capacity(std::size_t const value);
+
+    std::size_t size() const {
+      return size_;
+    }
+
+    bool empty() const {
+      return size_ == 0;
+    }
+
+    // Sample i counting from the oldest kept
+    sample const & operator[](std::size_t const index) const {
+      return samples_[(next_ + samples_.size() - size_ + index) % samples_.size()];
+    }
+
+    sample const & last() const {
+      return (*this)[size_ - 1];
+    }
+
+    // Per sub-step means over the history
+    sample average() const;
+
+    void clear() {
+      next_ = 0;
+      size_ = 0;
+    }
+
+    // A call to step opens a sample, each of its sub-steps adds one and the
+    // stages and counts recorded until end() go into it
+    void begin();
+    void step() {
+      ++current_.steps;
+    }
+    void end();
+
+    void time(stage_t const stage, double const milliseconds) {
+      current_.times[static_cast<std::size_t>(stage)] += milliseconds;
+    }
+
+    void count(counter_t const counter, std::size_t const value) {
+      current_.counts[static_cast<std::size_t>(counter)] += value;
+    }
+
+  private:
+    std::vector<sample> samples_;
+    std::size_t next_;
+    std::size_t size_;
+    sample current_;
+  };
+
+}
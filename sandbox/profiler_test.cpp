@@ -0,0 +1,92 @@
+#include <boost/test/unit_test.hpp>
+
+#include "profiler.hpp"
+#include "simulation.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(profiler)
+
+void record(sandbox::profiler & profiler, std::size_t const steps, double const milliseconds, std::size_t const contacts) {
+  profiler.begin();
+  for(std::size_t step(0); step < steps; ++step) {
+    profiler.step();
+    profiler.time(sandbox::profiler::stage_t::solve, milliseconds);
+    profiler.time(sandbox::profiler::stage_t::broadphase, 1.0);
+    profiler.count(sandbox::profiler::counter_t::contacts, contacts);
+  }
+  profiler.end();
+}
+
+BOOST_AUTO_TEST_CASE(history) {
+  sandbox::profiler profiler(3);
+  BOOST_CHECK(profiler.empty());
+
+  // Calls without a sub-step leave nothing behind
+  record(profiler, 0, 1.0, 1);
+  BOOST_CHECK(profiler.empty());
+
+  for(std::size_t call(1); call <= 5; ++call) {
+    record(profiler, 1, static_cast<double>(call), call * 10);
+  }
+  BOOST_REQUIRE_EQUAL(profiler.size(), 3u);
+  BOOST_CHECK_EQUAL(profiler[0].time(sandbox::profiler::stage_t::solve), 3.0);
+  BOOST_CHECK_EQUAL(profiler[2].time(sandbox::profiler::stage_t::solve), 5.0);
+  BOOST_CHECK_EQUAL(profiler.last().count(sandbox::profiler::counter_t::contacts), 50u);
+  BOOST_CHECK_EQUAL(profiler.last().total(), 6.0);
+
+  auto const average(profiler.average());
+  BOOST_CHECK_EQUAL(average.steps, 1u);
+  BOOST_CHECK_EQUAL(average.time(sandbox::profiler::stage_t::solve), 4.0);
+  BOOST_CHECK_EQUAL(average.count(sandbox::profiler::counter_t::contacts), 40u);
+
+  // Sub-steps add up within a call, the average is per sub-step
+  record(profiler, 4, 2.0, 10);
+  BOOST_CHECK_EQUAL(profiler.last().steps, 4u);
+  BOOST_CHECK_EQUAL(profiler.last().time(sandbox::profiler::stage_t::solve), 8.0);
+  BOOST_CHECK_EQUAL(profiler.average().time(sandbox::profiler::stage_t::solve), 17.0 / 6.0);
+
+  profiler.capacity(8);
+  BOOST_CHECK(profiler.empty());
+  BOOST_CHECK_EQUAL(profiler.capacity(), 8u);
+}
+
+BOOST_AUTO_TEST_CASE(names) {
+  BOOST_CHECK_EQUAL(sandbox::profiler::name(sandbox::profiler::stage_t::forces), "forces");
+  BOOST_CHECK_EQUAL(sandbox::profiler::name(sandbox::profiler::stage_t::world_shapes), "world_shapes");
+  BOOST_CHECK_EQUAL(sandbox::profiler::name(sandbox::profiler::stage_t::sleeping), "sleeping");
+  BOOST_CHECK_EQUAL(sandbox::profiler::name(sandbox::profiler::counter_t::iterations), "iterations");
+}
+
+BOOST_AUTO_TEST_CASE(step) {
+  sandbox::simulation simulation(400, 400);
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  for(unsigned int x(0); x < 4; ++x) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+    object->position(sandbox::vector(100 + x * 30.0f, 350.5f));
+    simulation.objects().push_back(object);
+  }
+
+  simulation.step(0.03f, 0.01f);
+  auto const & profiler(simulation.getProfiler());
+#ifdef SANDBOX_PROFILE
+  BOOST_REQUIRE_EQUAL(profiler.size(), 1u);
+  auto const & sample(profiler.last());
+  BOOST_CHECK_EQUAL(sample.steps, 3u);
+  BOOST_CHECK_EQUAL(sample.count(sandbox::profiler::counter_t::bodies), 12u);
+  BOOST_CHECK_EQUAL(sample.count(sandbox::profiler::counter_t::pairs), 12u);
+  BOOST_CHECK_EQUAL(sample.count(sandbox::profiler::counter_t::hits), 12u);
+  BOOST_CHECK_EQUAL(sample.count(sandbox::profiler::counter_t::islands), 12u);
+  BOOST_CHECK_GE(sample.count(sandbox::profiler::counter_t::contacts), 12u);
+  BOOST_CHECK_GT(sample.total(), 0.0);
+#else
+  BOOST_CHECK(profiler.empty());
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
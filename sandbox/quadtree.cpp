@@ -1,73 +1,205 @@
-#include <iostream>
+#include <algorithm>
 
 #include "quadtree.hpp"
 
 namespace sandbox {
 
-  bool quadtree::node::insert(std::pair<std::shared_ptr<object>, sandbox::rectangle const> const & object_with_bounding_box) {
-    auto const & bounding_box(object_with_bounding_box.second);
-    if(bounding_box.overlaps(rectangle_)) {
-      if(objects_.size() == 2) {
-        subdivide();
-        nw_->insert(object_with_bounding_box);
-        ne_->insert(object_with_bounding_box);
-        se_->insert(object_with_bounding_box);
-        sw_->insert(object_with_bounding_box);
-      } else {
-        objects_.push_back(object_with_bounding_box);
+  std::uint32_t const quadtree::no_index;
+
+  bool quadtree::insert(std::pair<std::size_t, rectangle const> const & object_with_bounding_box) {
+    if(!object_with_bounding_box.second.overlaps(rectangle_)) return false;
+    insert(pool_, 0, 0, object_with_bounding_box);
+    return true;
+  }
+
+  void quadtree::build(std::vector<rectangle> const & bounding_boxes) {
+    clear();
+    if(bounding_boxes.size() <= parallel_cutoff) {
+      for(std::size_t object(0); object < bounding_boxes.size(); ++object) {
+        insert(std::make_pair(object, bounding_boxes[object]));
       }
+      return;
+    }
 
-      return true;
+    // The root keeps no entries, every quadrant is built in a pool of its own
+    subdivide(pool_, 0);
+    parallel_for(0, 4, [&](std::size_t const quadrant) {
+      auto & pool(quadrants_[quadrant]);
+      pool.clear(pool_.nodes[1 + quadrant].rectangle_);
+      for(std::size_t object(0); object < bounding_boxes.size(); ++object) {
+        insert(pool, 0, 1, std::make_pair(object, bounding_boxes[object]));
+      }
+    }, 1, 0);
+
+    std::array<std::size_t, 4> node_bases, entry_bases;
+    auto nodes(pool_.nodes.size());
+    auto entries(pool_.entries.size());
+    for(std::size_t quadrant(0); quadrant < 4; ++quadrant) {
+      node_bases[quadrant] = nodes;
+      entry_bases[quadrant] = entries;
+      // The quadrant's root takes the place of the child already in the tree
+      nodes += quadrants_[quadrant].nodes.size() - 1;
+      entries += quadrants_[quadrant].entries.size();
     }
-    return false;
+    pool_.nodes.resize(nodes, node(rectangle_, no_index));
+    pool_.entries.resize(entries);
+
+    parallel_for(0, 4, [&](std::size_t const quadrant) {
+      splice(quadrant, node_bases[quadrant], entry_bases[quadrant]);
+    }, 1, 0);
   }
 
-  void quadtree::node::find(sandbox::rectangle const & rectangle, set_t & objects) const {
-    if(rectangle.overlaps(rectangle_)) {
-      for(auto object_with_bounding_box : objects_) {
-        auto const & object(object_with_bounding_box.first);
-        auto const & bounding_box(object_with_bounding_box.second);
-        if(rectangle.overlaps(bounding_box)) {
-          objects.emplace(object);
+  void quadtree::find(rectangle const & rectangle, std::vector<std::size_t> & objects) const {
+    // Objects spanning several nodes are found once per node
+    auto const begin(objects.size());
+    find(0, rectangle, objects);
+    std::sort(objects.begin() + begin, objects.end());
+    objects.erase(std::unique(objects.begin() + begin, objects.end()), objects.end());
+  }
+
+  void quadtree::find_all_pairs(std::vector<pair_t> & pairs) const {
+    auto const & nodes(pool_.nodes);
+    auto const & entries(pool_.entries);
+
+    // An entry can only overlap entries of its own node and of its ancestors,
+    // every other node it shares with an object holds both of them
+    pair_buffers_.clear();
+    parallel_for(0, nodes.size(), [&](std::size_t const index) {
+      auto const & node(nodes[index]);
+      auto & buffer(pair_buffers_.local());
+      for(auto current(node.entries_); current != no_index; current = entries[current].next) {
+        auto const & a(entries[current]);
+        for(auto other(a.next); other != no_index; other = entries[other].next) {
+          report(static_cast<std::uint32_t>(index), a, entries[other], buffer);
         }
+        for(auto ancestor(node.parent_); ancestor != no_index; ancestor = nodes[ancestor].parent_) {
+          for(auto other(nodes[ancestor].entries_); other != no_index; other = entries[other].next) {
+            report(static_cast<std::uint32_t>(index), a, entries[other], buffer);
+          }
+        }
+      }
+    });
+    pair_buffers_.merge(pairs);
+  }
+
+  void quadtree::visit(std::function<void (node const * const)> const & callback) const {
+    visit(0, callback);
+  }
+
+  void quadtree::insert(pool & pool, std::uint32_t const index, std::size_t const depth, std::pair<std::size_t, rectangle const> const & object_with_bounding_box) {
+    auto const & bounding_box(object_with_bounding_box.second);
+    if(!bounding_box.overlaps(pool.nodes[index].rectangle_)) return;
+
+    std::size_t count(0);
+    for(auto current(pool.nodes[index].entries_); current != no_index; current = pool.entries[current].next) {
+      ++count;
+    }
+
+    if(count == node_capacity && depth < max_depth) {
+      subdivide(pool, index);
+      auto const children(pool.nodes[index].children_);
+      for(std::uint32_t child(0); child < 4; ++child) {
+        insert(pool, children + child, depth + 1, object_with_bounding_box);
       }
-      if(nw_) nw_->find(rectangle, objects);
-      if (ne_) ne_->find(rectangle, objects);
-      if (se_) se_->find(rectangle, objects);
-      if (sw_) sw_->find(rectangle, objects);
+    } else {
+      pool.entries.push_back({ object_with_bounding_box.first, bounding_box, pool.nodes[index].entries_ });
+      pool.nodes[index].entries_ = static_cast<std::uint32_t>(pool.entries.size() - 1);
     }
   }
-  
-  void quadtree::node::visit(std::function<void (node const * const)> const & callback) const {
-    callback(this);
-    if(nw_) nw_->visit(callback);
-    if(ne_) ne_->visit(callback);
-    if(se_) se_->visit(callback);
-    if(sw_) sw_->visit(callback);
+
+  void quadtree::find(std::uint32_t const index, rectangle const & rectangle, std::vector<std::size_t> & objects) const {
+    auto const & node(pool_.nodes[index]);
+    if(rectangle.overlaps(node.rectangle_)) {
+      for(auto current(node.entries_); current != no_index; current = pool_.entries[current].next) {
+        auto const & entry(pool_.entries[current]);
+        if(rectangle.overlaps(entry.bounding_box)) {
+          objects.push_back(entry.object);
+        }
+      }
+      if(node.children_) {
+        for(std::uint32_t child(0); child < 4; ++child) {
+          find(node.children_ + child, rectangle, objects);
+        }
+      }
+    }
   }
 
-  void quadtree::node::subdivide() {
-    float const half_width((rectangle_.bottom_right().x() - rectangle_.top_left().x()) / 2);
-    float const half_height((rectangle_.bottom_right().y() - rectangle_.top_left().y()) / 2);
-    if(!nw_) nw_ = new node(sandbox::rectangle(rectangle_.top_left(), vector(rectangle_.top_left().x() + half_width, rectangle_.top_left().y() + half_height)));
-    if(!ne_) ne_ = new node(sandbox::rectangle(vector(rectangle_.top_left().x() + half_width, rectangle_.top_left().y()), vector(rectangle_.bottom_right().x(), rectangle_.top_left().y() + half_height))); 
-    if(!se_) se_ = new node(sandbox::rectangle(vector(rectangle_.top_left().x() + half_width, rectangle_.top_left().y() + half_height), rectangle_.bottom_right()));
-    if(!sw_) sw_ = new node(sandbox::rectangle(vector(rectangle_.top_left().x(), rectangle_.top_left().y() + half_height), vector(rectangle_.top_left().x() + half_width, rectangle_.bottom_right().y())));
+  void quadtree::visit(std::uint32_t const index, std::function<void (node const * const)> const & callback) const {
+    auto const & node(pool_.nodes[index]);
+    callback(&node);
+    if(node.children_) {
+      for(std::uint32_t child(0); child < 4; ++child) {
+        visit(node.children_ + child, callback);
+      }
+    }
   }
 
-  bool quadtree::insert(std::pair<std::shared_ptr<object>, rectangle const> const & object_with_bounding_box) {
-    if(!root_) root_ = new node(rectangle_);
-    return root_->insert(object_with_bounding_box);
+  void quadtree::subdivide(pool & pool, std::uint32_t const index) {
+    if(pool.nodes[index].children_) return;
+
+    auto const rectangle(pool.nodes[index].rectangle_);
+    float const half_width((rectangle.bottom_right().x() - rectangle.top_left().x()) / 2);
+    float const half_height((rectangle.bottom_right().y() - rectangle.top_left().y()) / 2);
+
+    // Growing the pool may move the nodes, only indices are held across it
+    auto const children(static_cast<std::uint32_t>(pool.nodes.size()));
+    pool.nodes.emplace_back(sandbox::rectangle(rectangle.top_left(), vector(rectangle.top_left().x() + half_width, rectangle.top_left().y() + half_height)), index);
+    pool.nodes.emplace_back(sandbox::rectangle(vector(rectangle.top_left().x() + half_width, rectangle.top_left().y()), vector(rectangle.bottom_right().x(), rectangle.top_left().y() + half_height)), index);
+    pool.nodes.emplace_back(sandbox::rectangle(vector(rectangle.top_left().x() + half_width, rectangle.top_left().y() + half_height), rectangle.bottom_right()), index);
+    pool.nodes.emplace_back(sandbox::rectangle(vector(rectangle.top_left().x(), rectangle.top_left().y() + half_height), vector(rectangle.top_left().x() + half_width, rectangle.bottom_right().y())), index);
+    pool.nodes[index].children_ = children;
   }
 
-  quadtree::set_t quadtree::find(rectangle const & rectangle) const {
-    quadtree::set_t objects;
-    root_->find(rectangle, objects);
-    return objects;
+  void quadtree::splice(std::size_t const quadrant, std::size_t const node_base, std::size_t const entry_base) {
+    auto const & pool(quadrants_[quadrant]);
+
+    // Children stay consecutive since only the quadrant's root moves elsewhere
+    auto const map_node([&](std::uint32_t const local) {
+      return static_cast<std::uint32_t>(local ? node_base + local - 1 : 1 + quadrant);
+    });
+    auto const map_entry([&](std::uint32_t const local) {
+      return local == no_index ? no_index : static_cast<std::uint32_t>(entry_base + local);
+    });
+
+    for(std::uint32_t local(0); local < pool.nodes.size(); ++local) {
+      auto node(pool.nodes[local]);
+      node.parent_ = local ? map_node(node.parent_) : 0;
+      if(node.children_) node.children_ = map_node(node.children_);
+      node.entries_ = map_entry(node.entries_);
+      pool_.nodes[map_node(local)] = node;
+    }
+
+    for(std::uint32_t local(0); local < pool.entries.size(); ++local) {
+      auto entry(pool.entries[local]);
+      entry.next = map_entry(entry.next);
+      pool_.entries[entry_base + local] = entry;
+    }
   }
 
-  void quadtree::visit(std::function<void (node const * const)> const & callback) const {
-    root_->visit(callback);
+  bool quadtree::owns(rectangle const & rectangle, vector const & point) const {
+    // Half open, except along the far edges of the whole tree
+    return
+      rectangle.top_left().x() <= point.x() &&
+      rectangle.top_left().y() <= point.y() &&
+      (point.x() < rectangle.bottom_right().x() || rectangle.bottom_right().x() == rectangle_.bottom_right().x()) &&
+      (point.y() < rectangle.bottom_right().y() || rectangle.bottom_right().y() == rectangle_.bottom_right().y());
+  }
+
+  void quadtree::report(std::uint32_t const index, entry const & a, entry const & b, std::vector<pair_t> & pairs) const {
+    if(!a.bounding_box.overlaps(b.bounding_box)) return;
+
+    // The node owning the top left corner of the overlap inside the tree lies
+    // on a single root to leaf path, both objects are stored once along it and
+    // the deeper of the two reports the pair
+    vector const corner(
+      std::max(std::max(a.bounding_box.top_left().x(), b.bounding_box.top_left().x()), rectangle_.top_left().x()),
+      std::max(std::max(a.bounding_box.top_left().y(), b.bounding_box.top_left().y()), rectangle_.top_left().y()));
+    if(corner.x() > std::min(std::min(a.bounding_box.bottom_right().x(), b.bounding_box.bottom_right().x()), rectangle_.bottom_right().x())) return;
+    if(corner.y() > std::min(std::min(a.bounding_box.bottom_right().y(), b.bounding_box.bottom_right().y()), rectangle_.bottom_right().y())) return;
+
+    if(owns(pool_.nodes[index].rectangle_, corner)) {
+      pairs.emplace_back(std::min(a.object, b.object), std::max(a.object, b.object));
+    }
   }
 
 }
@@ -1,60 +1,103 @@
 #pragma once
 
-#include <unordered_set>
-#include <memory>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <functional>
 
 #include "rectangle.hpp"
-#include "object.hpp"
+#include "misc.hpp"
 
 namespace sandbox {
 
+  // Nodes and entries live in flat arrays that keep their capacity across
+  // clear(), so rebuilding the tree every step does not allocate once the
+  // arrays have grown to fit the scene.
   class quadtree {
   public:
-    typedef std::unordered_set<std::shared_ptr<object>> set_t;
+    typedef std::pair<std::size_t, std::size_t> pair_t;
 
     class node {
     public:
-      node(sandbox::rectangle const rectangle) : rectangle_(rectangle), nw_(nullptr), ne_(nullptr), se_(nullptr), sw_(nullptr) {}
-      ~node() { 
-        delete nw_;
-        delete ne_;
-        delete se_;
-        delete sw_; 
-      };
+      node(sandbox::rectangle const & rectangle, std::uint32_t const parent) : rectangle_(rectangle), parent_(parent), children_(0), entries_(no_index) {}
 
       rectangle const & getRectangle() const {
         return rectangle_;
       }
 
-      bool insert(std::pair<std::shared_ptr<object>, sandbox::rectangle const> const & object_with_bounding_box);
-      void find(sandbox::rectangle const & rectangle, set_t & objects) const;
-
-      void visit(std::function<void (node const * const)> const & callback) const;
-
     private:
-      sandbox::rectangle const rectangle_;
-      std::vector<std::pair<std::shared_ptr<object>, sandbox::rectangle const>> objects_;
-      node * nw_, * ne_, * se_, * sw_;
+      friend class quadtree;
 
-      void subdivide();
+      sandbox::rectangle rectangle_;
+      std::uint32_t parent_;
+      // Index of the first of four consecutive children, nw, ne, se and sw,
+      // zero when the node has not been subdivided
+      std::uint32_t children_;
+      // Head of the node's entry list
+      std::uint32_t entries_;
     };
 
-    quadtree(rectangle const & rectangle) : rectangle_(rectangle), root_(new node(rectangle)) {}
-    ~quadtree() { delete root_; }
+    quadtree(rectangle const & rectangle) : rectangle_(rectangle) {
+      clear();
+    }
+
+    bool insert(std::pair<std::size_t, rectangle const> const & object_with_bounding_box);
+
+    // Rebuilds the tree from one box per object. Large inputs fill the four
+    // root quadrants in parallel and splice them into the tree afterwards.
+    void build(std::vector<rectangle> const & bounding_boxes);
 
-    bool insert(std::pair<std::shared_ptr<object>, rectangle const> const & object_with_bounding_box);
+    // Appends every object overlapping the rectangle to objects, each once
+    void find(rectangle const & rectangle, std::vector<std::size_t> & objects) const;
+
+    // Every pair of objects whose boxes overlap inside the tree's rectangle,
+    // sorted, each once as (a, b) with a < b
+    void find_all_pairs(std::vector<pair_t> & pairs) const;
 
-    set_t find(rectangle const & rectangle) const;
     void visit(std::function<void (node const * const)> const & callback) const;
 
     void clear() {
-      delete root_;
-      root_ = nullptr;
+      pool_.clear(rectangle_);
     }
-  
+
   private:
+    static std::uint32_t const no_index = 0xffffffff;
+    static std::size_t const node_capacity = 2;
+    // Boxes overlapping many others at one spot stop subdividing here
+    static std::size_t const max_depth = 16;
+
+    struct entry {
+      std::size_t object;
+      sandbox::rectangle bounding_box;
+      std::uint32_t next;
+    };
+
+    struct pool {
+      std::vector<node> nodes;
+      std::vector<entry> entries;
+
+      void clear(rectangle const & rectangle) {
+        nodes.clear();
+        nodes.emplace_back(rectangle, no_index);
+        entries.clear();
+      }
+    };
+
     rectangle const rectangle_;
-    node * root_;
+    pool pool_;
+    std::array<pool, 4> quadrants_;
+    mutable thread_buffers<pair_t> pair_buffers_;
+
+    void insert(pool & pool, std::uint32_t const index, std::size_t const depth, std::pair<std::size_t, rectangle const> const & object_with_bounding_box);
+    void find(std::uint32_t const index, rectangle const & rectangle, std::vector<std::size_t> & objects) const;
+    void visit(std::uint32_t const index, std::function<void (node const * const)> const & callback) const;
+
+    void subdivide(pool & pool, std::uint32_t const index);
+    void splice(std::size_t const quadrant, std::size_t const node_base, std::size_t const entry_base);
+
+    bool owns(rectangle const & rectangle, vector const & point) const;
+    void report(std::uint32_t const index, entry const & a, entry const & b, std::vector<pair_t> & pairs) const;
   };
 
 }
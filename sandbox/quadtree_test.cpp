@@ -1,5 +1,7 @@
 #include <boost/test/unit_test.hpp>
 
+#include <random>
+
 #include "quadtree.hpp"
 
 BOOST_AUTO_TEST_SUITE(quadtree)
@@ -23,4 +25,100 @@ BOOST_AUTO_TEST_CASE(init) {
   qt.insert(o5);*/
 }
 
+BOOST_AUTO_TEST_CASE(find) {
+  using namespace sandbox;
+
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(-10.0f, 200.0f);
+
+  std::vector<rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 200; ++i) {
+    vector const top_left(position(generator), position(generator));
+    bounding_boxes.emplace_back(top_left, top_left + vector(15.0f, 15.0f));
+  }
+  // Identical boxes stacked deeper than the subdivision limit
+  for(unsigned int i(0); i < 5; ++i) {
+    bounding_boxes.emplace_back(vector(50.0f, 50.0f), vector(60.0f, 60.0f));
+  }
+
+  sandbox::quadtree qt(rectangle(vector(0.0f, 0.0f), vector(200.0f, 200.0f)));
+  std::vector<std::size_t> objects;
+  for(unsigned int pass(0); pass < 2; ++pass) {
+    qt.clear();
+    for(std::size_t i(0); i < bounding_boxes.size(); ++i) {
+      qt.insert(std::make_pair(i, bounding_boxes[i]));
+    }
+
+    for(auto const & query : bounding_boxes) {
+      objects.clear();
+      qt.find(query, objects);
+
+      std::vector<std::size_t> expected;
+      for(std::size_t i(0); i < bounding_boxes.size(); ++i) {
+        if(query.overlaps(bounding_boxes[i])) expected.push_back(i);
+      }
+      BOOST_REQUIRE(objects == expected);
+    }
+  }
+
+  // Appends to what the caller already has
+  objects.assign(1, 1000);
+  qt.find(bounding_boxes.back(), objects);
+  BOOST_CHECK_EQUAL(objects.front(), 1000u);
+  BOOST_CHECK_GT(objects.size(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(find_all_pairs) {
+  using namespace sandbox;
+
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> position(-20.0f, 200.0f);
+  rectangle const root(vector(0.0f, 0.0f), vector(200.0f, 200.0f));
+
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(4);
+
+  // Serial and parallel builds
+  for(auto const count : { 20u, 400u }) {
+    std::vector<rectangle> bounding_boxes;
+    for(unsigned int i(0); i < count; ++i) {
+      vector const top_left(position(generator), position(generator));
+      bounding_boxes.emplace_back(top_left, top_left + vector(12.0f, 12.0f));
+    }
+    // Touching the centre lines and the far edges of the tree
+    bounding_boxes.emplace_back(vector(90.0f, 90.0f), vector(100.0f, 100.0f));
+    bounding_boxes.emplace_back(vector(100.0f, 100.0f), vector(110.0f, 110.0f));
+    bounding_boxes.emplace_back(vector(190.0f, 190.0f), vector(200.0f, 200.0f));
+    bounding_boxes.emplace_back(vector(200.0f, 200.0f), vector(210.0f, 210.0f));
+    for(unsigned int i(0); i < 5; ++i) {
+      bounding_boxes.emplace_back(vector(50.0f, 50.0f), vector(60.0f, 60.0f));
+    }
+
+    sandbox::quadtree qt(root);
+    qt.build(bounding_boxes);
+
+    std::vector<sandbox::quadtree::pair_t> pairs;
+    qt.find_all_pairs(pairs);
+
+    std::vector<sandbox::quadtree::pair_t> expected;
+    for(std::size_t a(0); a < bounding_boxes.size(); ++a) {
+      for(std::size_t b(a + 1); b < bounding_boxes.size(); ++b) {
+        auto const & a_box(bounding_boxes[a]);
+        auto const & b_box(bounding_boxes[b]);
+        rectangle const overlap(
+          vector(std::max(a_box.top_left().x(), b_box.top_left().x()), std::max(a_box.top_left().y(), b_box.top_left().y())),
+          vector(std::min(a_box.bottom_right().x(), b_box.bottom_right().x()), std::min(a_box.bottom_right().y(), b_box.bottom_right().y())));
+        if(a_box.overlaps(b_box) && overlap.overlaps(root)) expected.emplace_back(a, b);
+      }
+    }
+    BOOST_REQUIRE(pairs == expected);
+
+    std::vector<std::size_t> objects;
+    qt.find(bounding_boxes.back(), objects);
+    BOOST_CHECK_GE(objects.size(), 5u);
+  }
+
+  scheduler.concurrency(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
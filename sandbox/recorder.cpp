@@ -0,0 +1,342 @@
+#include "recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace sandbox {
+
+  namespace {
+
+    char const magic[8] = { 'S', 'B', 'X', 'T', 'R', 'A', 'J', '\0' };
+    char const index_magic[8] = { 'S', 'B', 'X', 'I', 'N', 'D', 'E', 'X' };
+    std::uint32_t const version(1);
+    std::uint32_t const byte_order(0x01020304);
+
+    // Frame flags carry a tag so that a scan notices when it runs off the
+    // frames
+    std::uint32_t const frame_tag(0x46524d00);
+    std::uint32_t const keyframe_flag(1);
+
+    struct header {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t byte_order;
+      float resolution;
+      float angle_resolution;
+    };
+
+    struct frame_header {
+      std::uint32_t size;
+      std::uint32_t flags;
+      std::uint32_t bodies;
+      float time;
+    };
+
+    struct index_entry {
+      std::uint64_t frame;
+      std::uint64_t offset;
+    };
+
+    struct trailer {
+      char magic[8];
+      std::uint64_t offset;
+      std::uint64_t keyframes;
+      std::uint64_t frames;
+    };
+
+    static_assert(sizeof(header) == 24 && sizeof(frame_header) == 16 && sizeof(index_entry) == 16 && sizeof(trailer) == 32, "trajectory records are padded");
+
+    std::int64_t quantize(float const value, float const resolution) {
+      return std::llround(static_cast<double>(value) / resolution);
+    }
+
+    float dequantize(std::int64_t const value, float const resolution) {
+      return static_cast<float>(value * static_cast<double>(resolution));
+    }
+
+    // Variable length integers, 7 bits per byte, small magnitudes of either
+    // sign in few bytes through zigzag encoding
+    void put(std::vector<unsigned char> & buffer, std::uint64_t value) {
+      while(value >= 0x80) {
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+      }
+      buffer.push_back(static_cast<unsigned char>(value));
+    }
+
+    void put_signed(std::vector<unsigned char> & buffer, std::int64_t const value) {
+      put(buffer, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+    }
+
+    std::uint64_t get(unsigned char const * & data, unsigned char const * const end) {
+      std::uint64_t value(0);
+      for(unsigned int shift(0); shift < 64; shift += 7) {
+        if(data == end) break;
+        auto const byte(*data++);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return value;
+      }
+      throw std::runtime_error("Corrupt trajectory frame");
+    }
+
+    std::int64_t get_signed(unsigned char const * & data, unsigned char const * const end) {
+      auto const value(get(data, end));
+      return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+
+  }
+
+  recorder::recorder(std::ostream & stream, float const resolution, float const angle_resolution, std::uint32_t const keyframe_interval) :
+    stream_(stream), resolution_(resolution), angle_resolution_(angle_resolution), keyframe_interval_(std::max<std::uint32_t>(keyframe_interval, 1)), frames_(0), known_(0),
+    ready_(false), stop_(false), closed_(false), offset_(sizeof(header)), written_(0) {
+    header head;
+    std::memcpy(head.magic, magic, sizeof(magic));
+    head.version = version;
+    head.byte_order = byte_order;
+    head.resolution = resolution_;
+    head.angle_resolution = angle_resolution_;
+    stream_.write(reinterpret_cast<char const *>(&head), sizeof(head));
+
+    writer_ = std::thread(&recorder::run, this);
+  }
+
+  recorder::~recorder() {
+    try {
+      close();
+    } catch(std::exception const &) {
+    }
+  }
+
+  void recorder::record(float const time, bodies const & bodies) {
+    auto const & positions(bodies.positions());
+    auto const & orientations(bodies.orientations());
+    auto const & sleeping(bodies.sleeping());
+    auto const & kinematic(bodies.kinematic());
+
+    // Sleeping bodies keep the transforms of the last frame they were awake
+    // in and kinematic ones those of the last frame they moved in. All of
+    // them go into the first frame and those after the bodies changed.
+    bool const all(bodies.size() != known_);
+    known_ = bodies.size();
+    if(all) kinematic_.resize(bodies.size());
+    for(std::size_t body(0); body < bodies.size(); ++body) {
+      if(sleeping[body] && !all) continue;
+      sample const current = { static_cast<std::uint32_t>(body), positions[body].x(), positions[body].y(), orientations[body] };
+      if(kinematic[body]) {
+        auto & last(kinematic_[body]);
+        if(!all && current.x == last.x && current.y == last.y && current.orientation == last.orientation) continue;
+        last = current;
+      }
+      front_.samples.push_back(current);
+    }
+    front_.frames.push_back({ time, static_cast<std::uint32_t>(bodies.size()), front_.samples.size() });
+    ++frames_;
+
+    // Handed over only when the writer is idle, otherwise the batch grows
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if(lock && !ready_) {
+      std::swap(front_, back_);
+      ready_ = true;
+      lock.unlock();
+      wake_.notify_one();
+    }
+  }
+
+  void recorder::close() {
+    if(closed_) return;
+    closed_ = true;
+
+    {
+      std::lock_guard<std::mutex> const lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+    write(front_);
+    front_ = batch();
+
+    for(auto const & keyframe : keyframes_) {
+      index_entry const entry = { keyframe.first, keyframe.second };
+      stream_.write(reinterpret_cast<char const *>(&entry), sizeof(entry));
+    }
+    trailer end;
+    std::memcpy(end.magic, index_magic, sizeof(index_magic));
+    end.offset = offset_;
+    end.keyframes = keyframes_.size();
+    end.frames = written_;
+    stream_.write(reinterpret_cast<char const *>(&end), sizeof(end));
+    stream_.flush();
+    if(!stream_) throw std::runtime_error("Writing the trajectory failed");
+  }
+
+  void recorder::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for(;;) {
+      wake_.wait(lock, [this]() {
+        return ready_ || stop_;
+      });
+      if(!ready_) return;
+
+      lock.unlock();
+      write(back_);
+      back_.frames.clear();
+      back_.samples.clear();
+      lock.lock();
+      ready_ = false;
+    }
+  }
+
+  void recorder::write(batch const & batch) {
+    std::size_t begin(0);
+    for(auto const & frame : batch.frames) {
+      bool const keyframe(frame.bodies * 3 != state_.size() || written_ % keyframe_interval_ == 0);
+      state_.resize(frame.bodies * 3, 0);
+
+      // Bodies that moved since the last frame as the distance to the next
+      // one and the three differences
+      buffer_.clear();
+      std::uint32_t next(0);
+      for(auto index(begin); index < frame.end; ++index) {
+        auto const & sample(batch.samples[index]);
+        std::int64_t const values[3] = { quantize(sample.x, resolution_), quantize(sample.y, resolution_), quantize(sample.orientation, angle_resolution_) };
+        auto const state(&state_[sample.body * 3]);
+        if(values[0] == state[0] && values[1] == state[1] && values[2] == state[2]) continue;
+
+        if(!keyframe) {
+          put(buffer_, sample.body - next);
+          for(std::size_t component(0); component < 3; ++component) {
+            put_signed(buffer_, values[component] - state[component]);
+          }
+          next = sample.body + 1;
+        }
+        std::copy(values, values + 3, state);
+      }
+      begin = frame.end;
+
+      if(keyframe) {
+        for(auto const value : state_) {
+          put_signed(buffer_, value);
+        }
+        keyframes_.emplace_back(written_, offset_);
+      }
+
+      frame_header const head = { static_cast<std::uint32_t>(buffer_.size()), frame_tag | (keyframe ? keyframe_flag : 0), frame.bodies, frame.time };
+      stream_.write(reinterpret_cast<char const *>(&head), sizeof(head));
+      stream_.write(reinterpret_cast<char const *>(buffer_.data()), buffer_.size());
+      offset_ += sizeof(head) + buffer_.size();
+      ++written_;
+    }
+  }
+
+  trajectory::trajectory(std::istream & stream) : stream_(stream), frames_(0), frame_(0), next_offset_(0), time_(0.0f) {
+    header head;
+    stream_.seekg(0);
+    if(!stream_.read(reinterpret_cast<char *>(&head), sizeof(head)) || std::memcmp(head.magic, magic, sizeof(magic))) throw std::runtime_error("Not a trajectory");
+    if(head.byte_order != byte_order) throw std::runtime_error("Trajectory of another byte order");
+    if(head.version != version) throw std::runtime_error("Unsupported trajectory version " + std::to_string(head.version));
+    resolution_ = head.resolution;
+    angle_resolution_ = head.angle_resolution;
+
+    index();
+    frame_ = frames_;
+  }
+
+  void trajectory::index() {
+    stream_.seekg(0, std::ios::end);
+    std::uint64_t const size(static_cast<std::uint64_t>(stream_.tellg()));
+
+    // The index written on close, checked against where it should be
+    trailer end;
+    if(size >= sizeof(header) + sizeof(trailer)) {
+      stream_.seekg(size - sizeof(trailer));
+      if(stream_.read(reinterpret_cast<char *>(&end), sizeof(end)) && !std::memcmp(end.magic, index_magic, sizeof(index_magic)) &&
+         end.offset >= sizeof(header) && end.offset <= size - sizeof(trailer) && end.keyframes == (size - sizeof(trailer) - end.offset) / sizeof(index_entry)) {
+        stream_.seekg(end.offset);
+        for(std::uint64_t keyframe(0); keyframe < end.keyframes; ++keyframe) {
+          index_entry entry;
+          stream_.read(reinterpret_cast<char *>(&entry), sizeof(entry));
+          keyframes_.emplace_back(entry.frame, entry.offset);
+        }
+        if(stream_) {
+          frames_ = static_cast<std::size_t>(end.frames);
+          return;
+        }
+        keyframes_.clear();
+      }
+    }
+
+    // Cut short, the frames that made it are found by walking them
+    stream_.clear();
+    std::uint64_t offset(sizeof(header));
+    while(offset + sizeof(frame_header) <= size) {
+      frame_header head;
+      stream_.seekg(offset);
+      if(!stream_.read(reinterpret_cast<char *>(&head), sizeof(head))) break;
+      if((head.flags & ~keyframe_flag) != frame_tag || head.size > size - offset - sizeof(head)) break;
+      if(head.flags & keyframe_flag) keyframes_.emplace_back(frames_, offset);
+      ++frames_;
+      offset += sizeof(head) + head.size;
+    }
+    stream_.clear();
+    if(keyframes_.empty() || keyframes_.front().first) frames_ = 0;
+  }
+
+  void trajectory::seek(std::size_t const frame) {
+    if(frame >= frames_) throw std::out_of_range("Frame " + std::to_string(frame) + " of " + std::to_string(frames_));
+
+    auto const keyframe(std::upper_bound(keyframes_.begin(), keyframes_.end(), std::make_pair(static_cast<std::uint64_t>(frame), ~std::uint64_t(0))) - 1);
+    if(frame_ >= frames_ || frame_ > frame || keyframe->first > frame_) {
+      frame_ = static_cast<std::size_t>(keyframe->first);
+      next_offset_ = keyframe->second;
+      read();
+    }
+    while(frame_ < frame) {
+      read();
+      ++frame_;
+    }
+  }
+
+  void trajectory::read() {
+    frame_header head;
+    stream_.seekg(next_offset_);
+    if(!stream_.read(reinterpret_cast<char *>(&head), sizeof(head)) || (head.flags & ~keyframe_flag) != frame_tag) throw std::runtime_error("Corrupt trajectory frame");
+    buffer_.resize(head.size);
+    if(!stream_.read(reinterpret_cast<char *>(buffer_.data()), buffer_.size())) throw std::runtime_error("Corrupt trajectory frame");
+    next_offset_ += sizeof(head) + head.size;
+    time_ = head.time;
+
+    unsigned char const * data(buffer_.data());
+    auto const end(data + buffer_.size());
+    if(head.flags & keyframe_flag) {
+      state_.resize(head.bodies * std::size_t(3));
+      for(auto & value : state_) {
+        value = get_signed(data, end);
+      }
+      positions_.resize(head.bodies);
+      orientations_.resize(head.bodies);
+      for(std::size_t body(0); body < head.bodies; ++body) {
+        positions_[body] = vector(dequantize(state_[body * 3], resolution_), dequantize(state_[body * 3 + 1], resolution_));
+        orientations_[body] = dequantize(state_[body * 3 + 2], angle_resolution_);
+      }
+      return;
+    }
+
+    if(head.bodies != positions_.size()) throw std::runtime_error("Corrupt trajectory frame");
+    std::uint64_t next(0);
+    while(data != end) {
+      auto const body(next + get(data, end));
+      if(body >= head.bodies) throw std::runtime_error("Corrupt trajectory frame");
+      auto const state(&state_[body * 3]);
+      for(std::size_t component(0); component < 3; ++component) {
+        state[component] += get_signed(data, end);
+      }
+      positions_[body] = vector(dequantize(state[0], resolution_), dequantize(state[1], resolution_));
+      orientations_[body] = dequantize(state[2], angle_resolution_);
+      next = body + 1;
+    }
+  }
+
+}
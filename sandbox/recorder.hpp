@@ -0,0 +1,176 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "vector.hpp"
+#include "bodies.hpp"
+
+namespace sandbox {
+
+  // Streams the position and orientation of every body to a file, one frame
+  // per call to simulation::step, for looking at long runs offline. The
+  // stepping thread only copies the transforms of bodies that are awake and
+  // of kinematic bodies that moved into a batch, which is handed to a writer
+  // thread whenever that one is done with the previous batch, so stepping
+  // never waits for the stream. The writer quantizes the transforms and
+  // encodes every frame as the bodies that changed since the previous one,
+  // with a keyframe of all bodies every keyframe_interval frames and whenever
+  // the body count changes. Sleeping bodies and kinematic bodies standing
+  // still are neither copied nor written.
+  //
+  // The stream holds a header, the frames, each with its size, time and body
+  // count, and on close an index of the keyframes that trajectory uses to
+  // seek. A recording cut short before close is still readable.
+  class recorder {
+  public:
+    // Positions are rounded to multiples of resolution and orientations to
+    // multiples of angle_resolution. The stream must outlive the recorder.
+    recorder(std::ostream & stream, float const resolution = 1.0f / 64.0f, float const angle_resolution = 1.0f / 8192.0f, std::uint32_t const keyframe_interval = 256);
+    ~recorder();
+
+    recorder(recorder const &) = delete;
+    recorder & operator =(recorder const &) = delete;
+
+    float resolution() const {
+      return resolution_;
+    }
+
+    float angle_resolution() const {
+      return angle_resolution_;
+    }
+
+    std::uint32_t keyframe_interval() const {
+      return keyframe_interval_;
+    }
+
+    // Frames recorded so far, written or not
+    std::size_t frames() const {
+      return frames_;
+    }
+
+    // Called by the simulation at the end of every step
+    void record(float const time, bodies const & bodies);
+
+    // Writes the pending frames and the index and stops the writer. Throws
+    // std::runtime_error when the stream failed; the destructor closes too
+    // but swallows that.
+    void close();
+
+  private:
+    struct frame {
+      float time;
+      std::uint32_t bodies;
+      std::size_t end;
+    };
+
+    struct sample {
+      std::uint32_t body;
+      float x;
+      float y;
+      float orientation;
+    };
+
+    struct batch {
+      std::vector<frame> frames;
+      std::vector<sample> samples;
+    };
+
+    std::ostream & stream_;
+    float const resolution_;
+    float const angle_resolution_;
+    std::uint32_t const keyframe_interval_;
+    std::size_t frames_;
+
+    // Filled by the stepping thread, which captures every body whenever the
+    // body count changes
+    std::size_t known_;
+    // The transforms kinematic bodies were last captured with
+    std::vector<sample> kinematic_;
+    batch front_;
+    // Written by the writer thread while ready_
+    batch back_;
+    bool ready_;
+    bool stop_;
+    bool closed_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::thread writer_;
+
+    // Writer state, the quantized transforms of the last frame written
+    std::vector<std::int64_t> state_;
+    std::vector<unsigned char> buffer_;
+    std::uint64_t offset_;
+    std::uint64_t written_;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> keyframes_;
+
+    void run();
+    void write(batch const & batch);
+  };
+
+  // Reads a recording frame by frame or at random, decoding from the nearest
+  // keyframe. Throws std::runtime_error for anything that is not one.
+  class trajectory {
+  public:
+    // The stream must outlive the trajectory
+    explicit trajectory(std::istream & stream);
+
+    std::size_t frames() const {
+      return frames_;
+    }
+
+    float resolution() const {
+      return resolution_;
+    }
+
+    float angle_resolution() const {
+      return angle_resolution_;
+    }
+
+    // Frame decoded last, frames() before the first seek
+    std::size_t frame() const {
+      return frame_;
+    }
+
+    float time() const {
+      return time_;
+    }
+
+    std::vector<vector> const & positions() const {
+      return positions_;
+    }
+
+    std::vector<float> const & orientations() const {
+      return orientations_;
+    }
+
+    // Decodes frame k, going on from the current frame when no keyframe lies
+    // between them
+    void seek(std::size_t const frame);
+
+  private:
+    std::istream & stream_;
+    float resolution_;
+    float angle_resolution_;
+    std::size_t frames_;
+    // Frame number and offset of every keyframe
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> keyframes_;
+
+    std::size_t frame_;
+    std::uint64_t next_offset_;
+    float time_;
+    std::vector<std::int64_t> state_;
+    std::vector<unsigned char> buffer_;
+    std::vector<vector> positions_;
+    std::vector<float> orientations_;
+
+    void index();
+    void read();
+  };
+
+}
@@ -0,0 +1,185 @@
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "recorder.hpp"
+#include "simulation.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(recorder)
+
+sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+std::shared_ptr<sandbox::object> add(sandbox::simulation & simulation, sandbox::vector const & position, float const width, float const height) {
+  std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(width, height).vertices()), material));
+  object->position(position);
+  simulation.objects().push_back(object);
+  return object;
+}
+
+// Floor and columns of boxes that fall asleep after a few hundred steps
+void columns(sandbox::simulation & simulation) {
+  simulation.solver(sandbox::simulation::solver_t::sequential_impulse);
+  add(simulation, sandbox::vector(200, 380), 400, 40)->kinematic(true);
+  for(unsigned int x(0); x < 4; ++x) {
+    for(unsigned int y(0); y < 3; ++y) {
+      add(simulation, sandbox::vector(60 + x * 80.0f, 350 - y * 20.0f), 20, 20)->angular_velocity(0.5f);
+    }
+  }
+}
+
+struct expected {
+  float time;
+  std::vector<sandbox::vector> positions;
+  std::vector<float> orientations;
+};
+
+expected capture(sandbox::simulation const & simulation) {
+  expected result = { simulation.time(), {}, {} };
+  for(auto const & object : simulation.objects()) {
+    result.positions.push_back(object->position());
+    result.orientations.push_back(object->orientation());
+  }
+  return result;
+}
+
+void check(sandbox::trajectory const & trajectory, expected const & expected) {
+  BOOST_CHECK_EQUAL(trajectory.time(), expected.time);
+  BOOST_REQUIRE_EQUAL(trajectory.positions().size(), expected.positions.size());
+  for(std::size_t body(0); body < expected.positions.size(); ++body) {
+    BOOST_CHECK_SMALL(trajectory.positions()[body].x() - expected.positions[body].x(), trajectory.resolution());
+    BOOST_CHECK_SMALL(trajectory.positions()[body].y() - expected.positions[body].y(), trajectory.resolution());
+    BOOST_CHECK_SMALL(trajectory.orientations()[body] - expected.orientations[body], trajectory.angle_resolution());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(seek) {
+  sandbox::simulation simulation(400, 400);
+  columns(simulation);
+  std::ostringstream stream;
+  simulation.recorder(std::make_shared<sandbox::recorder>(stream, 1.0f / 64.0f, 1.0f / 8192.0f, 16));
+
+  std::vector<expected> frames;
+  for(unsigned int i(0); i < 100; ++i) {
+    simulation.step(0.005f, 0.005f);
+    frames.push_back(capture(simulation));
+  }
+  // A body added part way forces a keyframe
+  add(simulation, sandbox::vector(200, 100), 10, 10);
+  for(unsigned int i(0); i < 20; ++i) {
+    simulation.step(0.005f, 0.005f);
+    frames.push_back(capture(simulation));
+  }
+  simulation.recorder()->close();
+  BOOST_CHECK_EQUAL(simulation.recorder()->frames(), frames.size());
+
+  std::istringstream input(stream.str());
+  sandbox::trajectory trajectory(input);
+  BOOST_REQUIRE_EQUAL(trajectory.frames(), frames.size());
+  BOOST_CHECK_EQUAL(trajectory.frame(), frames.size());
+
+  // In order, then back and forth across keyframes
+  for(std::size_t frame(0); frame < frames.size(); ++frame) {
+    trajectory.seek(frame);
+    check(trajectory, frames[frame]);
+  }
+  for(auto const frame : { 57, 3, 99, 100, 16, 15, 119, 0, 33, 34, 31 }) {
+    trajectory.seek(frame);
+    BOOST_CHECK_EQUAL(trajectory.frame(), frame);
+    check(trajectory, frames[frame]);
+  }
+  BOOST_CHECK_THROW(trajectory.seek(frames.size()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(frozen) {
+  // Sleeping and kinematic bodies only cost the frame header
+  sandbox::simulation simulation(400, 400);
+  columns(simulation);
+  for(unsigned int i(0); i < 400; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_REQUIRE(simulation.awake().empty());
+
+  auto const record([&](unsigned int const steps) {
+    std::ostringstream stream;
+    simulation.recorder(std::make_shared<sandbox::recorder>(stream, 1.0f / 64.0f, 1.0f / 8192.0f, 1000));
+    for(unsigned int i(0); i < steps; ++i) {
+      simulation.step(0.005f, 0.005f);
+    }
+    simulation.recorder()->close();
+    simulation.recorder(nullptr);
+    return stream.str();
+  });
+  auto const one(record(1));
+  auto const many(record(65));
+  BOOST_CHECK_EQUAL(many.size() - one.size(), 64 * 16);
+
+  // The first frame has every body, although they were asleep
+  auto const expected(capture(simulation));
+  std::istringstream input(many);
+  sandbox::trajectory trajectory(input);
+  trajectory.seek(64);
+  check(trajectory, expected);
+}
+
+BOOST_AUTO_TEST_CASE(kinematic) {
+  // A kinematic body standing still is captured once, moved it is again
+  sandbox::simulation simulation(400, 400);
+  columns(simulation);
+  auto const floor(simulation.objects()[0]);
+  std::ostringstream stream;
+  simulation.recorder(std::make_shared<sandbox::recorder>(stream, 1.0f / 64.0f, 1.0f / 8192.0f, 1000));
+
+  std::vector<expected> frames;
+  for(unsigned int i(0); i < 40; ++i) {
+    if(i == 20) floor->position(floor->position() + sandbox::vector(0, 5));
+    simulation.step(0.005f, 0.005f);
+    frames.push_back(capture(simulation));
+  }
+  simulation.recorder()->close();
+
+  auto const data(stream.str());
+  std::istringstream input(data);
+  sandbox::trajectory trajectory(input);
+  for(std::size_t frame(0); frame < frames.size(); ++frame) {
+    trajectory.seek(frame);
+    check(trajectory, frames[frame]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(cut_short) {
+  sandbox::simulation simulation(400, 400);
+  columns(simulation);
+  std::ostringstream stream;
+  simulation.recorder(std::make_shared<sandbox::recorder>(stream, 1.0f / 64.0f, 1.0f / 8192.0f, 8));
+
+  std::vector<expected> frames;
+  for(unsigned int i(0); i < 40; ++i) {
+    simulation.step(0.005f, 0.005f);
+    frames.push_back(capture(simulation));
+  }
+  simulation.recorder()->close();
+
+  // Without the index and half of the last frame, the others remain
+  auto const data(stream.str());
+  std::istringstream input(data.substr(0, data.size() - 32 - 5 * 16 - 4));
+  sandbox::trajectory trajectory(input);
+  BOOST_REQUIRE_EQUAL(trajectory.frames(), 39);
+  trajectory.seek(38);
+  check(trajectory, frames[38]);
+  trajectory.seek(9);
+  check(trajectory, frames[9]);
+}
+
+BOOST_AUTO_TEST_CASE(invalid) {
+  std::istringstream scene("world 100 100\n");
+  BOOST_CHECK_THROW(sandbox::trajectory trajectory(scene), std::runtime_error);
+
+  std::istringstream empty("");
+  BOOST_CHECK_THROW(sandbox::trajectory trajectory(empty), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,3 +1,4 @@
+#include <cmath>
 #include <memory>
 
 #include "renderer.hpp"
@@ -8,6 +9,26 @@ extern std::shared_ptr<sandbox::object> object1;
 
 namespace sandbox {
 
+namespace {
+
+template<typename Vertices>
+void polygon(Vertices const& vertices, vector const& position, float const orientation) {
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+  glTranslatef(0.375f, 0.375f, 0.0f);
+
+  glTranslatef(position.x(), position.y(), 0.0f);
+  glRotatef(orientation * 57.295779513082320876798154814105f, 0.0f, 0.0f, 1.0f);
+
+  glBegin(GL_POLYGON);
+  for(auto vertex : vertices) {
+    glVertex2i(static_cast<int>(vertex.x()), static_cast<int>(vertex.y()));
+  };
+  glEnd();
+}
+
+}
+
 renderer::renderer(int unsigned const width, int unsigned const height) {
   window_ = glfwCreateWindow(width, height, "Sandbox", NULL, NULL);
 
@@ -41,8 +62,8 @@ void renderer::clear() const {
   glClear(GL_COLOR_BUFFER_BIT);
 }
 
-void renderer::render(std::shared_ptr<object> const& object) const {
-  render(object->getShape().vertices(), object->position(), object->orientation());
+void renderer::render(std::shared_ptr<object const> const& object) const {
+  render(object->getShape(), object->position(), object->orientation());
   /*glColor3f(1.0f, 0.0f, 0.0f);
 render(object->shape().core().vertices(), object->position(), object->orientation());
   glColor3f(0.0f, 0.0f, 0.0f);
@@ -50,19 +71,32 @@ render(object->shape().core().vertices(), object->position(), object->orientatio
   glColor3f(1.0f, 1.0f, 1.0f);*/
 }
 
-void renderer::render(std::vector<vector> const& vertices, vector const& position, float const orientation) const {
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
-  glTranslatef(0.375f, 0.375f, 0.0f);
-
-  glTranslatef(position.x(), position.y(), 0.0f);
-  glRotatef(orientation * 57.295779513082320876798154814105f, 0.0f, 0.0f, 1.0f);
+void renderer::render(shape const& shape, vector const& position, float const orientation) const {
+  if(!shape.round()) {
+    polygon(shape.vertices(), position, orientation);
+    return;
+  }
+
+  // Half circles around both ends of the segment, which meet for a circle
+  auto const& start(shape.vertices()[0]);
+  auto const& end(shape.vertices().back());
+  auto const axis(end - start);
+  float const angle(axis ? std::atan2(axis.y(), axis.x()) : 0.0f);
+  int const segments(12);
+  std::vector<vector> outline;
+  for(int i(0); i <= segments; ++i) {
+    float const turn(angle - 1.5707963f + 3.14159265f * i / segments);
+    outline.push_back(end + vector(std::cos(turn), std::sin(turn)) * shape.radius());
+  }
+  for(int i(0); i <= segments; ++i) {
+    float const turn(angle + 1.5707963f + 3.14159265f * i / segments);
+    outline.push_back(start + vector(std::cos(turn), std::sin(turn)) * shape.radius());
+  }
+  polygon(outline, position, orientation);
+}
 
-  glBegin(GL_POLYGON);
-  for(auto vertex : vertices) {
-    glVertex2i(static_cast<int>(vertex.x()), static_cast<int>(vertex.y()));
-  };
-  glEnd();
+void renderer::render(std::vector<vector> const& vertices, vector const& position, float const orientation) const {
+  polygon(vertices, position, orientation);
 }
 
 void renderer::render(std::vector<vector> const& vertices) const {
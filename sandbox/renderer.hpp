@@ -31,8 +31,9 @@ public:
 
 	void clear() const;
 
-	void render(std::shared_ptr<object> const & object) const;
+	void render(std::shared_ptr<object const> const & object) const;
 	
+	void render(shape const & shape, vector const & position, float const orientation) const;
 	void render(std::vector<vector> const & vertices, vector const & position, float const orientation) const;
   void render(std::vector<vector> const & vertices) const;
   void render(vector const & top_left, vector const & top_right, vector const & bottom_right, vector const & bottom_left) const;
@@ -0,0 +1,200 @@
+#include "scene.hpp"
+
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sandbox {
+
+  namespace {
+
+    // Reads the statement of one line, failing with its number
+    class statement {
+    public:
+      statement(std::string const & line, std::size_t const number) : stream_(line), number_(number) {
+      }
+
+      std::runtime_error error(std::string const & message) const {
+        return std::runtime_error("Line " + std::to_string(number_) + ": " + message);
+      }
+
+      bool next(std::string & word) {
+        return static_cast<bool>(stream_ >> word);
+      }
+
+      bool done() {
+        return (stream_ >> std::ws).eof();
+      }
+
+      std::string word(char const * what) {
+        std::string word;
+        if(!next(word)) throw error(std::string("expected ") + what);
+        return word;
+      }
+
+      float number(char const * what) {
+        float number;
+        if(!(stream_ >> number)) throw error(std::string("expected ") + what);
+        return number;
+      }
+
+      std::size_t count(char const * what) {
+        std::size_t count;
+        if(!(stream_ >> count)) throw error(std::string("expected ") + what);
+        return count;
+      }
+
+    private:
+      std::istringstream stream_;
+      std::size_t const number_;
+    };
+
+    template<typename T>
+    T option(statement & statement, std::string const & word, std::map<std::string, T> const & options) {
+      auto const found(options.find(word));
+      if(found == options.end()) throw statement.error("unknown option " + word);
+      return found->second;
+    }
+
+    // Shape of a body, keyword being box, polygon, capsule or circle
+    shape read_shape(std::string const & keyword, statement & statement) {
+      if(keyword == "box") {
+        auto const width(statement.number("width"));
+        return shape(rectangle(width, statement.number("height")).vertices());
+      }
+      if(keyword == "polygon") {
+        auto const count(statement.count("vertex count"));
+        if(count < 3) throw statement.error("polygons need three vertices");
+        std::vector<vector> vertices;
+        for(std::size_t vertex(0); vertex < count; ++vertex) {
+          auto const x(statement.number("vertex x"));
+          vertices.emplace_back(x, statement.number("vertex y"));
+        }
+        return shape(vertices);
+      }
+      if(keyword == "capsule") {
+        auto const half_length(statement.number("length") / 2.0f);
+        return shape::capsule(vector(-half_length, 0.0f), vector(half_length, 0.0f), statement.number("radius"));
+      }
+      return shape::circle(statement.number("radius"));
+    }
+
+  }
+
+  std::shared_ptr<simulation> load_scene(std::istream & stream) {
+    std::shared_ptr<simulation> result;
+    std::map<std::string, material> materials;
+
+    std::string line;
+    for(std::size_t number(1); std::getline(stream, line); ++number) {
+      auto const comment(line.find('#'));
+      if(comment != std::string::npos) line.erase(comment);
+
+      statement statement(line, number);
+      std::string keyword;
+      if(!statement.next(keyword)) continue;
+
+      if(keyword == "world") {
+        if(result) throw statement.error("world given twice");
+        auto const width(statement.number("width"));
+        auto const height(statement.number("height"));
+        result = std::make_shared<simulation>(width, height);
+        continue;
+      }
+
+      if(keyword == "material") {
+        auto const name(statement.word("material name"));
+        auto const density(statement.number("density"));
+        auto const restitution(statement.number("restitution"));
+        float color[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        if(!statement.done()) {
+          color[0] = statement.number("red");
+          color[1] = statement.number("green");
+          color[2] = statement.number("blue");
+          color[3] = statement.number("alpha");
+        }
+        materials.erase(name);
+        materials.emplace(name, material(density, restitution, sandbox::color<>(color[0], color[1], color[2], color[3])));
+        continue;
+      }
+
+      if(!result) throw statement.error(keyword + " before world");
+
+      if(keyword == "solver") {
+        result->solver(option(statement, statement.word("solver"), std::map<std::string, simulation::solver_t> {
+          { "force", simulation::solver_t::force },
+          { "sequential_impulse", simulation::solver_t::sequential_impulse }
+        }));
+      } else if(keyword == "broadphase") {
+        result->broadphase(option(statement, statement.word("broadphase"), std::map<std::string, simulation::broadphase_t> {
+          { "quadtree", simulation::broadphase_t::quadtree },
+          { "sweep_and_prune", simulation::broadphase_t::sweep_and_prune },
+          { "aabb_tree", simulation::broadphase_t::aabb_tree },
+          { "spatial_hash", simulation::broadphase_t::spatial_hash }
+        }));
+      } else if(keyword == "narrowphase") {
+        result->narrowphase(option(statement, statement.word("narrowphase"), std::map<std::string, simulation::narrowphase_t> {
+          { "gjk", simulation::narrowphase_t::gjk },
+          { "sat", simulation::narrowphase_t::sat }
+        }));
+      } else if(keyword == "sleeping") {
+        result->allow_sleeping(option(statement, statement.word("on or off"), std::map<std::string, bool> {
+          { "on", true },
+          { "off", false }
+        }));
+      } else if(keyword == "deterministic") {
+        result->deterministic(option(statement, statement.word("on or off"), std::map<std::string, bool> {
+          { "on", true },
+          { "off", false }
+        }));
+      } else if(keyword == "box" || keyword == "polygon" || keyword == "circle" || keyword == "capsule") {
+        auto const found(materials.find(statement.word("material")));
+        if(found == materials.end()) throw statement.error("unknown material");
+        auto const x(statement.number("x"));
+        vector const position(x, statement.number("y"));
+        auto const body_shape(read_shape(keyword, statement));
+
+        std::shared_ptr<object> const body(new object(body_shape, found->second));
+        body->position(position);
+
+        std::string word;
+        while(statement.next(word)) {
+          if(word == "kinematic") {
+            body->kinematic(true);
+          } else if(word == "angle") {
+            body->orientation(statement.number("angle"));
+          } else if(word == "velocity") {
+            auto const velocity_x(statement.number("velocity x"));
+            body->linear_velocity(vector(velocity_x, statement.number("velocity y")));
+          } else if(word == "spin") {
+            body->angular_velocity(statement.number("spin"));
+          } else {
+            throw statement.error("unknown option " + word);
+          }
+        }
+        result->objects().push_back(body);
+      } else {
+        throw statement.error("unknown statement " + keyword);
+      }
+
+      std::string extra;
+      if(statement.next(extra)) throw statement.error("unexpected " + extra);
+    }
+
+    if(!result) throw std::runtime_error("Scene has no world");
+    return result;
+  }
+
+  void save_state(simulation const & simulation, std::ostream & stream) {
+    auto const & objects(simulation.objects());
+    for(std::size_t index(0); index < objects.size(); ++index) {
+      sandbox::object const & object(*objects[index]);
+      stream << index << ' ' << object.position().x() << ' ' << object.position().y() << ' ' << object.orientation() << ' '
+             << object.linear_velocity().x() << ' ' << object.linear_velocity().y() << ' ' << object.angular_velocity() << ' '
+             << (object.sleeping() ? 1 : 0) << '\n';
+    }
+  }
+
+}
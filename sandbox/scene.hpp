@@ -0,0 +1,38 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <ostream>
+
+#include "simulation.hpp"
+
+namespace sandbox {
+
+  // Worlds described in text, one statement per line and # starting a
+  // comment:
+  //
+  //   world <width> <height>
+  //   material <name> <density> <restitution> [<red> <green> <blue> <alpha>]
+  //   box <material> <x> <y> <width> <height> [options]
+  //   polygon <material> <x> <y> <count> <x1> <y1> ... [options]
+  //   circle <material> <x> <y> <radius> [options]
+  //   capsule <material> <x> <y> <length> <radius> [options]
+  //   solver force|sequential_impulse
+  //   broadphase quadtree|sweep_and_prune|aabb_tree|spatial_hash
+  //   narrowphase gjk|sat
+  //   sleeping on|off
+  //   deterministic on|off
+  //
+  // Bodies take the options kinematic, angle <radians>, velocity <x> <y> and
+  // spin <radians per second>. Polygon vertices and capsules, lying along x,
+  // are relative to the body's position. world has to come before the bodies
+  // and settings, materials before the bodies using them.
+  //
+  // Throws std::runtime_error naming the line of the first error.
+  std::shared_ptr<simulation> load_scene(std::istream & stream);
+
+  // One line per object: its index, position, orientation, linear and
+  // angular velocity and whether it sleeps
+  void save_state(simulation const & simulation, std::ostream & stream);
+
+}
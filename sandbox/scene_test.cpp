@@ -0,0 +1,95 @@
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "scene.hpp"
+
+BOOST_AUTO_TEST_SUITE(scene)
+
+BOOST_AUTO_TEST_CASE(load) {
+  std::istringstream stream(
+    "# two bodies on a floor\n"
+    "world 400 300\n"
+    "material wall 1 0\n"
+    "material bouncy 2 0.5 1 0 0 1\n"
+    "solver sequential_impulse\n"
+    "broadphase aabb_tree\n"
+    "sleeping off\n"
+    "deterministic on\n"
+    "\n"
+    "box wall 200 280 400 40 kinematic\n"
+    "polygon bouncy 100 100 3  -10 0  10 0  0 -15  angle 0.5 velocity 1 2\n"
+    "circle bouncy 200 100 8 spin 3\n"
+    "capsule wall 300 100 20 5 # trailing comment\n");
+
+  auto const simulation(sandbox::load_scene(stream));
+  BOOST_CHECK(simulation->solver() == sandbox::simulation::solver_t::sequential_impulse);
+  BOOST_CHECK(simulation->broadphase() == sandbox::simulation::broadphase_t::aabb_tree);
+  BOOST_CHECK(!simulation->allow_sleeping());
+  BOOST_CHECK(simulation->deterministic());
+
+  auto const & objects(simulation->objects());
+  BOOST_REQUIRE_EQUAL(objects.size(), 4u);
+  sandbox::object const & floor(*objects[0]);
+  BOOST_CHECK(floor.kinematic());
+  BOOST_CHECK(floor.getShape().kind() == sandbox::shape::kind_t::box);
+  BOOST_CHECK_EQUAL(floor.position().y(), 280.0f);
+
+  sandbox::object const & triangle(*objects[1]);
+  BOOST_CHECK(!triangle.kinematic());
+  BOOST_CHECK_EQUAL(triangle.getShape().vertices().size(), 3u);
+  BOOST_CHECK_EQUAL(triangle.orientation(), 0.5f);
+  BOOST_CHECK_EQUAL(triangle.linear_velocity().y(), 2.0f);
+  BOOST_CHECK_EQUAL(triangle.getMaterial().restitution(), 0.5f);
+  BOOST_CHECK_EQUAL(triangle.getMaterial().getColor().green(), 0.0f);
+
+  sandbox::object const & circle(*objects[2]);
+  BOOST_CHECK(circle.getShape().kind() == sandbox::shape::kind_t::circle);
+  BOOST_CHECK_EQUAL(circle.getShape().radius(), 8.0f);
+  BOOST_CHECK_EQUAL(circle.angular_velocity(), 3.0f);
+
+  sandbox::object const & capsule(*objects[3]);
+  BOOST_CHECK(capsule.getShape().kind() == sandbox::shape::kind_t::capsule);
+  BOOST_CHECK_EQUAL(capsule.getShape().vertices()[1].x(), 10.0f);
+
+  simulation->step(0.01f, 0.01f);
+  std::ostringstream state;
+  sandbox::save_state(*simulation, state);
+  std::istringstream lines(state.str());
+  std::size_t count(0);
+  for(std::string line; std::getline(lines, line); ++count) {
+    std::istringstream fields(line);
+    std::size_t index;
+    float values[6];
+    int sleeping;
+    fields >> index >> values[0] >> values[1] >> values[2] >> values[3] >> values[4] >> values[5] >> sleeping;
+    BOOST_CHECK(fields);
+    BOOST_CHECK_EQUAL(index, count);
+  }
+  BOOST_CHECK_EQUAL(count, 4u);
+}
+
+BOOST_AUTO_TEST_CASE(errors) {
+  auto const message([](std::string const & scene) {
+    std::istringstream stream(scene);
+    try {
+      sandbox::load_scene(stream);
+    } catch(std::runtime_error const & error) {
+      return std::string(error.what());
+    }
+    return std::string();
+  });
+
+  BOOST_CHECK_EQUAL(message("box wall 0 0 1 1\n"), "Line 1: box before world");
+  BOOST_CHECK_EQUAL(message("world 10 10\nbox wall 0 0 1 1\n"), "Line 2: unknown material");
+  BOOST_CHECK_EQUAL(message("world 10 10\nmaterial m 1 0\n\nbox m 0 0 1\n"), "Line 4: expected height");
+  BOOST_CHECK_EQUAL(message("world 10 10\nmaterial m 1 0\ncircle m 0 0 1 heavy\n"), "Line 3: unknown option heavy");
+  BOOST_CHECK_EQUAL(message("world 10 10\nsolver fast\n"), "Line 2: unknown option fast");
+  BOOST_CHECK_EQUAL(message("world 10 10\nsleeping on off\n"), "Line 2: unexpected off");
+  BOOST_CHECK_EQUAL(message("world 10 10\nteapot\n"), "Line 2: unknown statement teapot");
+  BOOST_CHECK_EQUAL(message("# empty\n"), "Scene has no world");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
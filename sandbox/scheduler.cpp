@@ -1,42 +1,154 @@
 #include "scheduler.hpp"
 
-#include <functional>
+#include "trace.hpp"
 
 namespace sandbox {
 
-  std::future<void> scheduler::schedule(std::function<void()> const & function) {
-    std::packaged_task<void()> * const task(new std::packaged_task<void()>(function));
-    auto future(task->get_future());
-    tasks_.push(task);
-    return future;
+  namespace {
+    thread_local std::size_t current_queue(0);
   }
 
-  std::vector<std::future<void>> scheduler::schedule(std::vector<std::function<void()>> const & functions) {
-    std::vector<std::future<void>> futures;
-    tasks_.reserve(functions.size());
-    for (auto const & function : functions) {
-      std::packaged_task<void()> * const task(new std::packaged_task<void()>(function));
-      futures.emplace_back(task->get_future());
-      tasks_.push(task);
+  bool scheduler::queue::push(task const & task) {
+    std::lock_guard<std::mutex> const lock(mutex_);
+    if(tail_ - head_ == capacity_) return false;
+    tasks_[tail_++ % capacity_] = task;
+    return true;
+  }
+
+  bool scheduler::queue::pop(task & task) {
+    std::lock_guard<std::mutex> const lock(mutex_);
+    if(tail_ == head_) return false;
+    task = tasks_[--tail_ % capacity_];
+    return true;
+  }
+
+  bool scheduler::queue::steal(task & task) {
+    std::lock_guard<std::mutex> const lock(mutex_);
+    if(tail_ == head_) return false;
+    task = tasks_[head_++ % capacity_];
+    return true;
+  }
+
+  scheduler & scheduler::instance() {
+    static scheduler instance;
+    return instance;
+  }
+
+  scheduler::scheduler() : queued_(0), sleeping_(0), stop_(false) {
+    start(0);
+  }
+
+  scheduler::~scheduler() {
+    shutdown();
+  }
+
+  std::size_t scheduler::current() {
+    return current_queue;
+  }
+
+  void scheduler::concurrency(std::size_t const threads) {
+    shutdown();
+    start(threads);
+  }
+
+  void scheduler::start(std::size_t const threads) {
+    std::size_t const count(threads ? threads : std::thread::hardware_concurrency());
+    start_workers(count > 1 ? count - 1 : 0);
+  }
+
+  void scheduler::start_workers(std::size_t const workers) {
+    stop_ = false;
+    queues_.clear();
+    for(std::size_t i(0); i < workers + 1; ++i) {
+      queues_.emplace_back(new queue());
+    }
+    for(std::size_t i(1); i < workers + 1; ++i) {
+      workers_.emplace_back(&scheduler::runner, this, i);
+    }
+  }
+
+  void scheduler::shutdown() {
+    {
+      std::lock_guard<std::mutex> const lock(sleep_mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+
+    for(auto & worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+
+    // Anything still queued runs on the calling thread so that waiters finish
+    for(std::size_t i(0); i < queues_.size(); ++i) {
+      task task;
+      while(queues_[i]->pop(task)) {
+        --queued_;
+        run(task);
+      }
+    }
+  }
+
+  void scheduler::schedule(task const & task) {
+    ++queued_;
+    if(!queues_[current_queue]->push(task)) {
+      --queued_;
+      run(task);
+      return;
+    }
+
+    if(sleeping_) {
+      { std::lock_guard<std::mutex> const lock(sleep_mutex_); }
+      wake_.notify_one();
     }
-    return futures;
   }
 
-  scheduler * scheduler::instance_ = new scheduler();
+  void scheduler::wait(std::atomic<std::size_t> & pending) {
+    while(pending.load(std::memory_order_acquire)) {
+      if(!run_one(current_queue)) std::this_thread::yield();
+    }
+  }
+
+  void scheduler::runner(std::size_t const index) {
+    current_queue = index;
+
+    while(!stop_) {
+      if(run_one(index)) continue;
 
-  scheduler::scheduler() : tasks_(1 << 16) {
-    for (std::size_t i(0); i < std::thread::hardware_concurrency() - 1; ++i) {
-      std::thread(std::bind(&scheduler::runner, this)).detach();
+      // Spin briefly before parking, work usually arrives in bursts
+      bool found(false);
+      for(unsigned int spin(0); spin < 64 && !found && !stop_; ++spin) {
+        std::this_thread::yield();
+        found = run_one(index);
+      }
+      if(found) continue;
+
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      ++sleeping_;
+      wake_.wait(lock, [&]() { return stop_ || queued_; });
+      --sleeping_;
     }
   }
 
-  void scheduler::runner() {
-    for (;;) {
-      tasks_.consume_one([](std::packaged_task<void()> * const task) {
-        task->operator()();
-        delete task;
-      });
+  bool scheduler::run_one(std::size_t const index) {
+    task task;
+    bool found(queues_[index]->pop(task));
+    for(std::size_t i(1); !found && i < queues_.size(); ++i) {
+      found = queues_[(index + i) % queues_.size()]->steal(task);
+    }
+    if(!found) return false;
+
+    --queued_;
+    run(task);
+    return true;
+  }
+
+  void scheduler::run(task const & task) {
+    {
+      SANDBOX_TRACE_SCOPE("task");
+      task.function(task.context);
     }
+    task.pending->fetch_sub(1, std::memory_order_acq_rel);
   }
 
 }
@@ -1,31 +1,89 @@
 #pragma once
 
-#include <future>
-
-#include <boost/lockfree/queue.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace sandbox {
 
+  // Work-stealing thread pool. Every worker owns a deque, threads outside of
+  // the pool share queue 0. Tasks are plain function pointers copied by value
+  // into the deques, so scheduling never allocates. Idle workers park on a
+  // condition variable and threads waiting for work help execute it.
   class scheduler {
-  
   public:
-    static scheduler * instance() {
-      return instance_;
+    struct task {
+      void (*function)(void * context);
+      void * context;
+      std::atomic<std::size_t> * pending;
+    };
+
+    static scheduler & instance();
+
+    // Number of threads executing tasks, including the waiting caller
+    std::size_t concurrency() const {
+      return queues_.size();
     }
 
-    std::future<void> schedule(std::function<void()> const & function);
-    std::vector<std::future<void>> schedule(std::vector<std::function<void()>> const & functions);
+    // Restarts the pool so that this many threads, the waiting caller
+    // included, execute tasks. Zero picks the hardware concurrency. Must not
+    // race with schedule().
+    void concurrency(std::size_t const threads);
+
+    // The task's pending counter must have been incremented by the caller; it
+    // is decremented once the task has run.
+    void schedule(task const & task);
+    void wait(std::atomic<std::size_t> & pending);
+
+    void shutdown();
+
+    // Index of the calling thread's queue, 0 for threads outside the pool
+    static std::size_t current();
 
   private:
-    static scheduler * instance_;
+    class queue {
+    public:
+      queue() : head_(0), tail_(0) {
+      }
+
+      bool push(task const & task);
+      bool pop(task & task);
+      bool steal(task & task);
+
+    private:
+      static std::size_t const capacity_ = 1024;
+
+      std::mutex mutex_;
+      std::array<task, capacity_> tasks_;
+      std::size_t head_;
+      std::size_t tail_;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues_;
+    std::vector<std::thread> workers_;
 
-    boost::lockfree::queue<std::packaged_task<void()> *> tasks_;
+    std::atomic<std::size_t> queued_;
+    std::atomic<std::size_t> sleeping_;
+    std::atomic<bool> stop_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
 
     scheduler();
     ~scheduler();
 
-    void runner();
+    scheduler(scheduler const &) = delete;
+    scheduler & operator =(scheduler const &) = delete;
 
+    void start(std::size_t const threads);
+    void start_workers(std::size_t const workers);
+    void runner(std::size_t const index);
+    bool run_one(std::size_t const index);
+    static void run(task const & task);
   };
 
 }
@@ -0,0 +1,108 @@
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "scheduler.hpp"
+#include "misc.hpp"
+
+BOOST_AUTO_TEST_SUITE(scheduler)
+
+void increment(void * const context) {
+  ++*static_cast<std::atomic<int> *>(context);
+}
+
+BOOST_AUTO_TEST_CASE(schedule) {
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(4);
+  BOOST_CHECK_EQUAL(scheduler.concurrency(), 4u);
+
+  std::atomic<int> counter(0);
+  std::atomic<std::size_t> pending(2000);
+  for(unsigned int i(0); i < 2000; ++i) {
+    scheduler.schedule({ &increment, &counter, &pending });
+  }
+  scheduler.wait(pending);
+  BOOST_CHECK_EQUAL(counter, 2000);
+
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_CASE(concurrency) {
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(1);
+  BOOST_CHECK_EQUAL(scheduler.concurrency(), 1u);
+
+  // Without workers everything runs on the caller
+  std::atomic<int> counter(0);
+  std::atomic<std::size_t> pending(100);
+  for(unsigned int i(0); i < 100; ++i) {
+    scheduler.schedule({ &increment, &counter, &pending });
+  }
+  scheduler.wait(pending);
+  BOOST_CHECK_EQUAL(counter, 100);
+
+  scheduler.concurrency(3);
+  BOOST_CHECK_EQUAL(scheduler.concurrency(), 3u);
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_CASE(shutdown) {
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(3);
+
+  std::atomic<int> counter(0);
+  std::atomic<std::size_t> pending(10);
+  for(unsigned int i(0); i < 10; ++i) {
+    scheduler.schedule({ &increment, &counter, &pending });
+  }
+  scheduler.shutdown();
+  BOOST_CHECK_EQUAL(counter, 10);
+  BOOST_CHECK_EQUAL(pending, 0u);
+
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_for) {
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(4);
+
+  std::vector<int> values(10000);
+  sandbox::parallel_for(0, values.size(), [&](std::size_t const index) {
+    values[index] += static_cast<int>(index);
+  }, 16);
+  for(std::size_t i(0); i < values.size(); ++i) {
+    BOOST_REQUIRE_EQUAL(values[i], static_cast<int>(i));
+  }
+
+  std::vector<int> small(3);
+  sandbox::parallel_for(0, small.size(), [&](std::size_t const index) {
+    small[index] = 1;
+  });
+  BOOST_CHECK_EQUAL(small[0] + small[1] + small[2], 3);
+
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_reduce) {
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(4);
+
+  auto const sum(sandbox::parallel_reduce(0, 10000, std::size_t(0), [](std::size_t & sum, std::size_t const index) {
+    sum += index;
+  }, [](std::size_t & sum, std::size_t const partial) {
+    sum += partial;
+  }, 64));
+  BOOST_CHECK_EQUAL(sum, 49995000u);
+
+  auto const odd(sandbox::parallel_reduce(0, 1000, std::vector<std::size_t>(), [](std::vector<std::size_t> & odd, std::size_t const index) {
+    if(index % 2) odd.push_back(index);
+  }, [](std::vector<std::size_t> & odd, std::vector<std::size_t> && partial) {
+    odd.insert(odd.end(), partial.begin(), partial.end());
+  }));
+  BOOST_CHECK_EQUAL(odd.size(), 500u);
+
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,56 +3,121 @@
 #include <tuple>
 
 #include "shape.hpp"
+#include "kernels.hpp"
 
 namespace sandbox {
 
-shape shape::core() const {
-  std::vector<vector> core(vertices_);
-  std::transform(core.begin(), core.end(), core.begin(), [&](vector const& vertex) {
-    return vertex - (vertex.normalize() * 4.0f);
-  });
-  return shape(core);
-}
+namespace {
+
+float const pi(3.14159265f);
 
-float shape::area() const {
-  float area(0.0f);
-  for(int unsigned i(vertices_.size() - 1), j(0); j < vertices_.size(); i = j, ++j) {
-    vector const& vertex1(vertices_[i]);
-    vector const& vertex2(vertices_[j]);
-    area += vertex1.x() * vertex2.y() - vertex2.x() * vertex1.y();
-  }
-  return area / 2.0f;
 }
 
-vector shape::centroid() const {
+void shape::update() {
+  area_ = 0.0f;
   float x(0.0f);
   float y(0.0f);
   for(int unsigned i(vertices_.size() - 1), j(0); j < vertices_.size(); i = j, ++j) {
     vector const& vertex1(vertices_[i]);
     vector const& vertex2(vertices_[j]);
     float const cross(vertex1.cross(vertex2));
+    area_ += cross;
     x += (vertex1.x() + vertex2.x()) * cross;
     y += (vertex1.y() + vertex2.y()) * cross;
   }
-  float const area(6 * this->area());
-  return vector(x / area, y / area);
+  centroid_ = area_ ? vector(x / (3.0f * area_), y / (3.0f * area_)) : vector();
+  area_ /= 2.0f;
+
+  // Which side is outside depends on the winding
+  normals_.resize(vertices_.size());
+  for(int unsigned i(0); i < vertices_.size(); ++i) {
+    vector const edge(vertices_[i + 1 == vertices_.size() ? 0 : i + 1] - vertices_[i]);
+    normals_[i] = (area_ < 0.0f ? edge.right() : edge.left()).normalize();
+  }
+
+  // Four sides meeting at right angles
+  auto const tolerance(1e-4f);
+  kind_ = kind_t::polygon;
+  if(vertices_.size() == 4 && std::abs(normals_[0].dot(normals_[1])) <= tolerance &&
+     normals_[0].dot(normals_[2]) <= tolerance - 1.0f && normals_[1].dot(normals_[3]) <= tolerance - 1.0f) {
+    kind_ = kind_t::box;
+    extents_ = vector((vertices_[2] - vertices_[1]).length() / 2.0f, (vertices_[1] - vertices_[0]).length() / 2.0f);
+  }
 }
 
-rectangle shape::bounding_box() const {
-  auto x_min(vertices_[0].x()), x_max(vertices_[0].x()), y_min(vertices_[0].y()), y_max(vertices_[0].y());
-  for(vector vertex : vertices_) {
-    auto const x(vertex.x());
-    auto const y(vertex.y());
-    if(x < x_min)
-      x_min = x;
-    else if(x > x_max)
-      x_max = x;
-    if(y < y_min)
-      y_min = y;
-    else if(y > y_max)
-      y_max = y;
+shape shape::circle(float const radius, vector const & center) {
+  shape circle;
+  circle.kind_ = kind_t::circle;
+  circle.vertices_.push_back(center);
+  circle.radius_ = radius;
+  circle.area_ = pi * radius * radius;
+  circle.centroid_ = center;
+  return circle;
+}
+
+shape shape::capsule(vector const & a, vector const & b, float const radius) {
+  shape capsule;
+  capsule.kind_ = kind_t::capsule;
+  capsule.vertices_.push_back(a);
+  capsule.vertices_.push_back(b);
+  capsule.radius_ = radius;
+  capsule.area_ = pi * radius * radius + 2.0f * radius * (b - a).length();
+  capsule.centroid_ = (a + b) / 2.0f;
+  return capsule;
+}
+
+float shape::moment_of_inertia(float const mass) const {
+  if(kind_ == kind_t::circle) {
+    return mass * (radius_ * radius_ / 2.0f + centroid_.length_squared());
+  }
+
+  if(kind_ == kind_t::capsule) {
+    // A box between two half discs, each weighing its share of the mass, the
+    // half discs' centroids 4r / 3pi beyond the ends
+    float const length((vertices_[1] - vertices_[0]).length());
+    float const disc(pi * radius_ * radius_);
+    float const box(2.0f * radius_ * length);
+    float const disc_mass(mass * disc / (disc + box));
+    float const box_mass(mass - disc_mass);
+    float const half(length / 2.0f);
+    float const offset(4.0f * radius_ / (3.0f * pi));
+    float const disc_inertia(disc_mass * (radius_ * radius_ / 2.0f + half * half + 2.0f * half * offset));
+    float const box_inertia(box_mass * (4.0f * radius_ * radius_ + length * length) / 12.0f);
+    return disc_inertia + box_inertia + mass * centroid_.length_squared();
+  }
+
+  float numerator(0.0f);
+  float denominator(0.0f);
+  for (int unsigned i(vertices_.size() - 1), j(0); j < vertices_.size(); i = j, ++j) {
+    vector const & vertex1(vertices_[i]);
+    vector const & vertex2(vertices_[j]);
+    float const cross(vertex2.cross(vertex1));
+    numerator += cross * (vertex2.dot(vertex2) + vertex2.dot(vertex1) + vertex1.dot(vertex1));
+    denominator += cross;
   }
-  return rectangle(vector(x_min, y_min), vector(x_max, y_max));
+  return mass / 6.0f * (numerator / denominator);
+}
+
+shape shape::core() const {
+  if(round()) {
+    shape core(*this);
+    core.radius_ = std::max(0.0f, radius_ - 4.0f);
+    core.area_ = pi * core.radius_ * core.radius_ + 2.0f * core.radius_ * (vertices_.back() - vertices_[0]).length();
+    return core;
+  }
+
+  vertices_t core(vertices_);
+  std::transform(core.begin(), core.end(), core.begin(), [&](vector const& vertex) {
+    return vertex - (vertex.normalize() * 4.0f);
+  });
+  return shape(core);
+}
+
+rectangle shape::bounding_box() const {
+  auto const bounds(kernels::bounds(vertices_.data(), vertices_.size()));
+  if(!radius_) return bounds;
+  vector const radius(radius_, radius_);
+  return rectangle(bounds.top_left() - radius, bounds.bottom_right() + radius);
 }
 
 bool shape::corner(vector const& vector) const {
@@ -64,16 +129,32 @@ bool shape::corner(vector const& vector) const {
 }
 
 int unsigned shape::support(vector const& direction) const {
-  int unsigned support(0);
-  float maximum_dot_product(direction.dot(vertices_[0]));
-  for(int unsigned i(1); i < vertices_.size(); ++i) {
-    float const dot_product = direction.dot(vertices_[i]);
-    if(dot_product > maximum_dot_product) {
-      support = i;
-      maximum_dot_product = dot_product;
+  return static_cast<int unsigned>(kernels::support(vertices_.data(), vertices_.size(), direction));
+}
+
+vector shape::support_point(vector const& direction) const {
+  vector const& vertex(vertices_[support(direction)]);
+  return radius_ ? vertex + direction.normalize() * radius_ : vertex;
+}
+
+vector shape::closest(vector const& point) const {
+  if(round()) {
+    vector const center(segment(vertices_[0], vertices_.back()).closest(point));
+    vector const outward((point - center).normalize());
+    return center + (outward ? outward : vector(0.0f, -1.0f)) * radius_;
+  }
+
+  vector closest(vertices_[0]);
+  float minimum(std::numeric_limits<float>::max());
+  for(int unsigned i(vertices_.size() - 1), j(0); j < vertices_.size(); i = j, ++j) {
+    vector const candidate(segment(vertices_[i], vertices_[j]).closest(point));
+    float const distance((candidate - point).length_squared());
+    if(distance < minimum) {
+      minimum = distance;
+      closest = candidate;
     }
   }
-  return support;
+  return closest;
 }
 
 segment shape::feature(vector const& direction) const {
@@ -89,7 +170,7 @@ segment shape::feature(vector const& direction) const {
 bool shape::intersects(shape const& shape) const {
   vector direction(shape.centroid() - centroid());
 
-  std::vector<vector> simplex;
+  small_vector<vector, 3> simplex;
   simplex.push_back(vertices_[support(direction)] - shape.vertices()[shape.support(-direction)]);
   direction = -direction;
 
@@ -211,22 +292,34 @@ std::tuple<bool, vector, float, vector, vector> shape::distance(shape const& sha
     }
   }
 
+  // Out of iterations, direction still points at the origin like at the top
+  // of the loop and has to be flipped and normalized the same way
+  direction = -direction.normalize();
   std::tuple<vector, vector> const closest_points(get_closest_points(a1, a2, a, b1, b2, b));
   return std::make_tuple(true, direction, -c.dot(direction), std::get<0>(closest_points), std::get<1>(closest_points));
 }
 
 shape shape::transform(vector const& position, float const orientation) const {
-  float const sin(std::sin(orientation));
-  float const cos(std::cos(orientation));
-
-  std::vector<vector> transformed_vertices(vertices_);
-  std::transform(transformed_vertices.begin(),
-                 transformed_vertices.end(),
-                 transformed_vertices.begin(),
-                 [&](vector const& vertex) {
-    return vector(cos * vertex.x() - sin * vertex.y(), sin * vertex.x() + cos * vertex.y()) + position;
-  });
+  shape result;
+  transform(position, orientation, result);
+  return result;
+}
+
+void shape::transform(vector const& position, float const orientation, shape& result) const {
+  transform(position, std::sin(orientation), std::cos(orientation), result);
+}
 
-  return shape(transformed_vertices);
+void shape::transform(vector const& position, float const sin, float const cos, shape& result) const {
+  result.vertices_.resize(vertices_.size());
+  kernels::transform(vertices_.data(), vertices_.size(), position, sin, cos, result.vertices_.data());
+
+  // A rigid transform keeps the area, the rest just turns with the vertices
+  result.normals_.resize(normals_.size());
+  kernels::transform(normals_.data(), normals_.size(), vector(), sin, cos, result.normals_.data());
+  result.kind_ = kind_;
+  result.radius_ = radius_;
+  result.area_ = area_;
+  result.extents_ = extents_;
+  kernels::transform(&centroid_, 1, position, sin, cos, &result.centroid_);
 }
 }
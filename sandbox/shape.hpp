@@ -6,38 +6,110 @@
 #include "vector.hpp"
 #include "segment.hpp"
 #include "rectangle.hpp"
+#include "small_vector.hpp"
 
 namespace sandbox {
 	
 class shape {
   public:
-  shape() {
+	// Polygons up to this many vertices are stored inline
+	typedef small_vector<vector, 8> vertices_t;
+
+	// Boxes have a collision routine of their own in the narrowphase. Circles
+	// and capsules are round: a point or a segment in vertices() grown by
+	// radius(), without normals.
+	enum class kind_t {
+		polygon,
+		box,
+		circle,
+		capsule
+	};
+
+  shape() : kind_(kind_t::polygon), radius_(0.0f), area_(0.0f) {
   }
 
-	shape(std::vector<vector> const & vertices) : vertices_(vertices) {}
+	shape(std::vector<vector> const & vertices) : kind_(kind_t::polygon), vertices_(vertices.begin(), vertices.end()), radius_(0.0f) {
+		update();
+	}
+
+	shape(vertices_t const & vertices) : kind_(kind_t::polygon), vertices_(vertices), radius_(0.0f) {
+		update();
+	}
+
+	static shape circle(float const radius, vector const & center = vector());
+	static shape capsule(vector const & a, vector const & b, float const radius);
 
-	std::vector<vector> const & vertices() const {
+	kind_t kind() const {
+		return kind_;
+	}
+
+	bool round() const {
+		return kind_ == kind_t::circle || kind_ == kind_t::capsule;
+	}
+
+	float radius() const {
+		return radius_;
+	}
+
+	vertices_t const & vertices() const {
 		return vertices_;
 	}
 
+	// Outward unit normal of the edge from vertex i to vertex i + 1
+	vertices_t const & normals() const {
+		return normals_;
+	}
+
 	shape core() const;
 
-	float area() const;
-	vector centroid() const;
+	float area() const {
+		return area_;
+	}
+
+	vector const & centroid() const {
+		return centroid_;
+	}
+
+	// About the origin of the shape's space, for the shape weighing mass
+	float moment_of_inertia(float const mass) const;
+
+	// Half the size of a box along normals 0 and 1
+	vector const & extents() const {
+		return extents_;
+	}
 
   rectangle bounding_box() const;
 
   bool corner(vector const & vertex) const;
+	// Vertex furthest along direction, of the segment for round shapes
 	int unsigned support(vector const & direction) const;
+	// Point of the outline furthest along direction
+	vector support_point(vector const & direction) const;
+	// Point of the outline closest to point
+	vector closest(vector const & point) const;
 	segment feature(vector const & direction) const;
 		
 	bool intersects(shape const & shape) const;
 	std::tuple<bool, vector, float, vector, vector> distance(shape const & shape) const;
 
 	shape transform(vector const & position, float const orientation) const;
+	// Writes into result, reusing its storage
+	void transform(vector const & position, float const orientation, shape & result) const;
+	// Turned by the angle with the given sine and cosine
+	void transform(vector const & position, float const sin, float const cos, shape & result) const;
 
 private:
-	std::vector<vector> const vertices_;
+	kind_t kind_;
+	vertices_t vertices_;
+	float radius_;
+	vertices_t normals_;
+	float area_;
+	vector centroid_;
+	vector extents_;
+
+	// Derives the kind, normals, area and centroid of a polygon from its
+	// vertices
+	void update();
 };
 
 }
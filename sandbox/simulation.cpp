@@ -1,383 +1,763 @@
 #include <algorithm>
-#include <set>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <future>
-#include <mutex>
 #include <cmath>
 #include <exception>
 #include <memory>
 
 #include "simulation.hpp"
 #include "contact.hpp"
-#include "matrix.hpp"
-#include "renderer.hpp"
+#include "kernels.hpp"
 #include "misc.hpp"
 
-extern std::shared_ptr<sandbox::renderer> renderer;
-extern std::shared_ptr<sandbox::object> object1;
-
 namespace sandbox {
 
-void simulation::update_world_shapes() {
-  world_shapes_.clear();
-  parallel_for_range(objects_.begin(), objects_.end(), [&](std::shared_ptr<object> const& object) {
-    auto const world_shape(
-        std::make_pair(object, object->getShape().transform(object->position(), object->orientation())));
-    std::lock_guard<std::mutex> lock(world_shapes_mutex_);
-    world_shapes_.emplace(world_shape);
+namespace {
+
+// FNV-1a over 32 bit words fed low byte first, so the hash does not depend
+// on byte order
+class hasher {
+public:
+  hasher() : hash_(14695981039346656037ull) {
+  }
+
+  std::uint64_t hash() const {
+    return hash_;
+  }
+
+  void word(std::uint32_t const value) {
+    for(unsigned int byte(0); byte < 4; ++byte) {
+      hash_ ^= (value >> (8 * byte)) & 0xff;
+      hash_ *= 1099511628211ull;
+    }
+  }
+
+  void index(std::size_t const value) {
+    word(static_cast<std::uint32_t>(value));
+    word(static_cast<std::uint32_t>(static_cast<std::uint64_t>(value) >> 32));
+  }
+
+  void number(float const value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    word(bits);
+  }
+
+  void point(vector const& value) {
+    number(value.x());
+    number(value.y());
+  }
+
+  void contact(sandbox::contact const& value) {
+    point(value.ap());
+    point(value.bp());
+    point(value.normal());
+    number(value.force());
+    number(value.impulse());
+  }
+
+private:
+  std::uint64_t hash_;
+};
+
+}
+
+std::uint64_t simulation::state_hash() const {
+  hasher hasher;
+  hasher.number(time_);
+  hasher.number(accumulator_);
+
+  hasher.index(objects_.size());
+  for(auto const& object : objects_) {
+    hasher.point(object->position());
+    hasher.number(object->orientation());
+    hasher.point(object->linear_velocity());
+    hasher.number(object->angular_velocity());
+    hasher.word(object->sleeping() ? 1 : 0);
+  }
+
+  // Rest times are only kept once the objects have been stepped
+  auto const& sleep_times(bodies_.sleep_times());
+  hasher.index(sleep_times.size());
+  for(auto const sleep_time : sleep_times) {
+    hasher.number(sleep_time);
+  }
+
+  auto const& entries(contact_cache_.entries());
+  hasher.index(entries.size());
+  for(auto const& entry : entries) {
+    hasher.index(entry.pair.first);
+    hasher.index(entry.pair.second);
+    hasher.word((entry.touching ? 1 : 0) | (entry.face ? 2 : 0));
+    if(entry.touching) hasher.contact(entry.contact);
+    if(entry.face) hasher.contact(entry.second);
+  }
+  return hasher.hash();
+}
+
+void simulation::allow_sleeping(bool const value) {
+  allow_sleeping_ = value;
+  if(value) return;
+
+  auto const& sleeping(bodies_.sleeping());
+  for(std::size_t body(0); body < bodies_.size(); ++body) {
+    if(sleeping[body]) bodies_.wake(body);
+  }
+}
+
+void simulation::reset_sleeping() {
+  auto const& kinematic(bodies_.kinematic());
+  auto& sleeping(bodies_.sleeping());
+  auto& sleep_times(bodies_.sleep_times());
+
+  // Everything starts awake and every shape is computed once, kinematic
+  // bodies keep theirs from then on
+  world_shapes_.resize(bodies_.size());
+  world_cores_.resize(bodies_.size());
+  bounding_boxes_.resize(bodies_.size());
+  parallel_for(0, bodies_.size(), [&](std::size_t const body) {
+    update_world_shape(body);
+  });
+
+  sleep_links_.resize(bodies_.size());
+  sleep_states_.assign(bodies_.size(), 0);
+  awake_.clear();
+  resting_.clear();
+  for(std::size_t body(0); body < bodies_.size(); ++body) {
+    sleeping[body] = 0;
+    sleep_times[body] = 0.0f;
+    sleep_links_[body] = body;
+    if(kinematic[body]) {
+      resting_.insert(body, bounding_boxes_[body]);
+    } else {
+      awake_.push_back(body);
+    }
+  }
+  bodies_.woken().clear();
+  awake_changed_ = true;
+}
+
+void simulation::restore(std::vector<char> const& sleeping, std::vector<std::size_t> const& sleep_links, std::vector<float> const& sleep_times, std::vector<std::size_t> const& woken, std::vector<contact_cache::entry>& entries) {
+  bodies_.synchronize(objects_);
+  reset_sleeping();
+
+  // Sleeping bodies go back into their rings and the resting tree, the way
+  // update_sleeping left them
+  std::size_t kept(0);
+  for(auto const body : awake_) {
+    if(!sleeping[body]) {
+      awake_[kept++] = body;
+      continue;
+    }
+    bodies_.sleeping()[body] = 1;
+    sleep_links_[body] = sleep_links[body];
+    resting_.insert(body, bounding_boxes_[body]);
+  }
+  awake_.resize(kept);
+  bodies_.sleep_times() = sleep_times;
+  bodies_.woken() = woken;
+  contact_cache_.update(entries);
+}
+
+void simulation::wake_requested() {
+  auto const& kinematic(bodies_.kinematic());
+  auto const& sleeping(bodies_.sleeping());
+  auto& woken(bodies_.woken());
+  if(woken.empty()) return;
+
+  // Kinematic bodies may have been moved as well, their shapes are only
+  // computed here
+  for(auto const body : woken) {
+    if(kinematic[body]) {
+      update_world_shape(body);
+      resting_.remove(body);
+      resting_.insert(body, bounding_boxes_[body]);
+    } else if(sleeping[body]) {
+      wake_island(body);
+    }
+  }
+  woken.clear();
+  std::sort(awake_.begin(), awake_.end());
+}
+
+void simulation::wake_island(std::size_t const body) {
+  auto& sleeping(bodies_.sleeping());
+  auto& sleep_times(bodies_.sleep_times());
+
+  auto current(body);
+  do {
+    auto const next(sleep_links_[current]);
+    sleeping[current] = 0;
+    sleep_times[current] = 0.0f;
+    sleep_links_[current] = current;
+    resting_.remove(current);
+    awake_.push_back(current);
+    current = next;
+  } while(current != body);
+  awake_changed_ = true;
+}
+
+bool simulation::wake_touched() {
+  auto const& sleeping(bodies_.sleeping());
+
+  // At most one body of a pair is asleep, its whole island wakes with it
+  bool woken(false);
+  for(auto const& collision : collisions_) {
+    if(sleeping[collision.first]) {
+      wake_island(collision.first);
+      woken = true;
+    } else if(sleeping[collision.second]) {
+      wake_island(collision.second);
+      woken = true;
+    }
+  }
+  if(woken) std::sort(awake_.begin(), awake_.end());
+  return woken;
+}
+
+void simulation::update_sleeping(float const time_step) {
+  auto const& kinematic(bodies_.kinematic());
+  auto& sleeping(bodies_.sleeping());
+  auto& sleep_times(bodies_.sleep_times());
+  auto const& dirty(bodies_.dirty());
+  auto& linear_velocities(bodies_.linear_velocities());
+  auto& angular_velocities(bodies_.angular_velocities());
+  auto& forces(bodies_.forces());
+  auto& torques(bodies_.torques());
+
+  // 0 stays awake, 1 rested long enough, 2 sleeps with its island
+  auto const linear_tolerance(linear_sleep_tolerance_ * linear_sleep_tolerance_);
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    auto const body(awake_[index]);
+    if(linear_velocities[body].length_squared() > linear_tolerance || std::abs(angular_velocities[body]) > angular_sleep_tolerance_) {
+      sleep_times[body] = 0.0f;
+    } else {
+      sleep_times[body] += time_step;
+    }
+    sleep_states_[body] = allow_sleeping_ && sleep_times[body] >= time_to_sleep_;
   });
+  if(!allow_sleeping_) return;
+
+  // An island only sleeps once all of its bodies rest, and then as a ring
+  auto const& pairs(islands_.pairs());
+  auto const& offsets(islands_.offsets());
+  parallel_for(0, islands_.size(), [&](std::size_t const island) {
+    bool rest(true);
+    for(auto index(offsets[island]); index < offsets[island + 1] && rest; ++index) {
+      auto const& pair(pairs[index]);
+      rest = sleep_states_[pair.first] && (kinematic[pair.second] || sleep_states_[pair.second]);
+    }
+
+    auto const head(pairs[offsets[island]].first);
+    auto const join([&](std::size_t const body) {
+      if(sleep_states_[body] != 1) return;
+      sleep_states_[body] = 2;
+      sleep_links_[body] = sleep_links_[head];
+      sleep_links_[head] = body;
+    });
+    for(auto index(offsets[island]); index < offsets[island + 1]; ++index) {
+      auto const& pair(pairs[index]);
+      if(!rest) {
+        sleep_states_[pair.first] = 0;
+        if(!kinematic[pair.second]) sleep_states_[pair.second] = 0;
+      } else {
+        join(pair.first);
+        if(!kinematic[pair.second]) join(pair.second);
+      }
+    }
+  }, 1, 1);
+
+  // Bodies in no island rested alone, their rings hold just themselves
+  std::size_t kept(0);
+  for(auto const body : awake_) {
+    if(!sleep_states_[body]) {
+      awake_[kept++] = body;
+      continue;
+    }
+    sleep_states_[body] = 0;
+    sleeping[body] = 1;
+    linear_velocities[body] = vector();
+    angular_velocities[body] = 0.0f;
+    forces[body] = vector();
+    torques[body] = 0.0f;
+    if(dirty[body]) update_world_shape(body);
+    resting_.insert(body, bounding_boxes_[body]);
+  }
+  if(kept != awake_.size()) {
+    awake_.resize(kept);
+    awake_changed_ = true;
+  }
+}
+
+void simulation::update_world_shape(std::size_t const body) {
+  auto const& position(bodies_.positions()[body]);
+  auto const orientation(bodies_.orientations()[body]);
+  float sin, cos;
+  if(deterministic_) {
+    kernels::sin_cos(orientation, sin, cos);
+  } else {
+    sin = std::sin(orientation);
+    cos = std::cos(orientation);
+  }
+  bodies_.getShape(body).transform(position, sin, cos, world_shapes_[body]);
+  bodies_.getCore(body).transform(position, sin, cos, world_cores_[body]);
+  bounding_boxes_[body] = world_shapes_[body].bounding_box();
+  bodies_.dirty()[body] = 0;
 }
 
-void simulation::update_bounding_boxes() {
-  bounding_boxes_.clear();
-  parallel_for_range(objects_.begin(), objects_.end(), [&](object_t const& object) {
-    auto const bounding_box(std::make_pair(object, world_shapes_[object].bounding_box()));
-    std::lock_guard<std::mutex> lock(bounding_boxes_mutex_);
-    bounding_boxes_.emplace(bounding_box);
+void simulation::update_world_shapes() {
+  auto const& dirty(bodies_.dirty());
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    auto const body(awake_[index]);
+    if(dirty[body]) update_world_shape(body);
   });
 }
 
-void simulation::update_quadtree() {
-  quadtree_.clear();
-  for(auto const& object : objects_) {
-    quadtree_.insert(std::make_pair(object, bounding_boxes_[object]));
+void simulation::update_broadphase() {
+  awake_boxes_.resize(awake_.size());
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    awake_boxes_[index] = bounding_boxes_[awake_[index]];
+  });
+
+  // Incremental broadphases follow boxes by position, which now belong to
+  // other bodies
+  if(awake_changed_) {
+    sweep_and_prune_.clear();
+    aabb_tree_.clear();
+    awake_changed_ = false;
+  }
+
+  switch(broadphase_) {
+    case broadphase_t::quadtree:
+      quadtree_.build(awake_boxes_);
+      break;
+
+    case broadphase_t::sweep_and_prune:
+      sweep_and_prune_.update(awake_boxes_);
+      break;
+
+    case broadphase_t::aabb_tree:
+      aabb_tree_.update(awake_boxes_);
+      break;
+
+    case broadphase_t::spatial_hash:
+      spatial_hash_.update(awake_boxes_);
+      break;
   }
 }
 
 void simulation::find_collisions() {
-  collisions_.clear();
-  parallel_for_range(objects_.begin(), objects_.end(), [&](object_t const& object) {
-    if(!object->kinematic()) {
-      std::unordered_set<object_t> colliders(quadtree_.find(bounding_boxes_[object]));
-      colliders.erase(object);
-      std::lock_guard<std::mutex> const lock(collisions_mutex_);
-      for(auto const& collider : colliders) {
-        if(!object->frozen() || !collider->frozen()) {
-          if(!collisions_.count(collider) || !collisions_[collider].count(object)) {
-            collisions_[object].emplace(collider);
-          }
-        }
+  auto const& kinematic(bodies_.kinematic());
+  collision_buffers_.clear();
+
+  // Pair lists come as (a, b) with a < b in positions of awake_, which keeps
+  // a < b for the bodies. The tree reports overlaps of its fat boxes so the
+  // tight boxes are tested again.
+  auto const add_collisions([&](std::vector<std::pair<std::size_t, std::size_t>> const& pairs) {
+    parallel_for(0, pairs.size(), [&](std::size_t const index) {
+      auto const a(awake_[pairs[index].first]);
+      auto const b(awake_[pairs[index].second]);
+      if(bounding_boxes_[a].overlaps(bounding_boxes_[b])) {
+        collision_buffers_.local().emplace_back(a, b);
       }
-    }
+    });
+  });
+
+  // Awake bodies against resting ones, the dynamic body comes first
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    auto const body(awake_[index]);
+    auto const& bounding_box(bounding_boxes_[body]);
+    resting_.query(bounding_box, [&](std::size_t const other) {
+      if(!bounding_box.overlaps(bounding_boxes_[other])) return;
+      if(kinematic[other] || body < other) {
+        collision_buffers_.local().emplace_back(body, other);
+      } else {
+        collision_buffers_.local().emplace_back(other, body);
+      }
+    });
   });
+
+  switch(broadphase_) {
+    case broadphase_t::quadtree:
+      quadtree_.find_all_pairs(broadphase_pairs_);
+      add_collisions(broadphase_pairs_);
+      break;
+
+    case broadphase_t::sweep_and_prune:
+      add_collisions(sweep_and_prune_.pairs());
+      break;
+
+    case broadphase_t::aabb_tree:
+      add_collisions(aabb_tree_.pairs());
+      break;
+
+    case broadphase_t::spatial_hash:
+      add_collisions(spatial_hash_.pairs());
+      break;
+  }
+
+  collision_buffers_.merge(collisions_);
 }
 
 void simulation::find_islands() {
-  std::unordered_map<object_t, std::shared_ptr<std::set<std::pair<object_t, object_t>>>> islands;
-  std::for_each(
-      collisions_.begin(), collisions_.end(), [&](std::pair<object_t, std::unordered_set<object_t>> const& collision) {
-        auto& object(collision.first);
-        auto& colliders(collision.second);
-
-        std::for_each(colliders.begin(), colliders.end(), [&](object_t const& collider) {
-          std::shared_ptr<std::set<std::pair<object_t, object_t>>> island;
-
-          if(islands.count(object)) {
-            island = islands[object];
-          } else if(islands.count(collider)) {
-            island = islands[collider];
-          } else {
-            island = std::make_shared<std::set<std::pair<object_t, object_t>>>();
-          }
-
-          if(!island->count(std::make_pair(object, collider)) && !island->count(std::make_pair(collider, object))) {
-            island->emplace(std::make_pair(object, collider));
-            islands[object] = island;
-            islands[collider] = island;
-          }
-        });
-      });
-
-  islands_.clear();
-  for(auto const& island : islands) {
-    islands_.emplace(island.second);
-  }
+  islands_.build(collisions_, bodies_.kinematic());
 }
 
 void simulation::find_contacts() {
-  contacts_ = std::vector<std::vector<contact>>(islands_.size());
-
-  std::size_t index(0);
-  std::for_each(
-      islands_.begin(), islands_.end(), [&](std::shared_ptr<std::set<std::pair<object_t, object_t>>> const& island) {
-        std::vector<std::pair<object_t, object_t>> const collision_list(island->begin(), island->end());
-
-        parallel_for_range(
-            collision_list.begin(), collision_list.end(), [&, index](std::pair<object_t, object_t> const& collision) {
-              auto const& a(collision.first);
-              auto const& b(collision.second);
-
-              shape const& a_shape(world_shapes_[a]);
-              shape const& b_shape(world_shapes_[b]);
-
-              if(a_shape.intersects(b_shape)) {
-                shape const a_core(a->getShape().core().transform(a->position(), a->orientation()));
-                shape const b_core(b->getShape().core().transform(b->position(), b->orientation()));
-
-                std::tuple<bool, vector, float, vector, vector> const distance_data(b_core.distance(a_core));
-
-                auto const& normal(std::get<1>(distance_data));
-
-                auto ap(std::get<4>(distance_data));
-                auto bp(std::get<3>(distance_data));
-
-                auto const a_feature(a_shape.feature(-normal));
-                auto const b_feature(b_shape.feature(normal));
-
-                auto const a_segment(segment(a_feature.closest(b_feature.a()), a_feature.closest(b_feature.b())));
-                auto const b_segment(segment(b_feature.closest(a_feature.a()), b_feature.closest(a_feature.b())));
-
-                if(a_segment.getVector().parallel(b_segment.getVector())) {
-                  contact const contact(a, b, a_segment.middle(), b_segment.middle(), normal);
-                  if(contact.relative_velocity() >= 0.0f) {
-                    std::lock_guard<std::mutex> lock(contacts_mutex_);
-                    contacts_[index].emplace_back(contact);
-                  }
-                } else {
-                  if(a_core.corner(ap)) {
-                    ap += (ap - a->position()).normalize() * 2.0f;
-                    bp = b_feature.closest(ap);
-                  } else if(b_core.corner(bp)) {
-                    bp += (bp - b->position()).normalize() * 2.0f;
-                    ap = a_feature.closest(bp);
-                  }
-
-                  contact const contact(a, b, ap, bp, normal);
-                  if(contact.relative_velocity() >= 0.0f) {
-                    std::lock_guard<std::mutex> lock(contacts_mutex_);
-                    contacts_[index].emplace_back(contact);
-                  }
-                }
-              }
-            });
-
-        ++index;
-      });
+  auto const& candidates(islands_.pairs());
+
+  // Pairs that barely moved relative to each other keep last step's contact,
+  // the others go through the narrowphase and carry the cached force and impulse over
+  cache_entries_.resize(candidates.size());
+  contact_buffers_.clear();
+  parallel_for(0, candidates.size(), [&](std::size_t const candidate) {
+    auto const& pair(candidates[candidate]);
+    auto& entry(cache_entries_[candidate]);
+    auto const cached(contact_cache_.find(pair));
+
+    contact contact, second;
+    if(cached && contact_cache_.reusable(*cached, bodies_)) {
+      entry = *cached;
+      if(entry.touching) contact = contact_cache_.follow(entry, bodies_);
+      if(entry.face) second = contact_cache_.follow(entry, entry.second, bodies_);
+    } else {
+      entry = contact_cache::create(pair, bodies_);
+      narrowphase(entry);
+      if(cached) {
+        entry.contact.force(cached->contact.force());
+        entry.contact.impulse(cached->contact.impulse());
+        entry.second.force(cached->second.force());
+        entry.second.impulse(cached->second.impulse());
+      }
+      contact = entry.contact;
+      second = entry.second;
+    }
+
+    // Separating contacts only matter to the impulse solver, which can hold
+    // them together within the step
+    auto const approaching([&](sandbox::contact const& contact) {
+      return solver_ == solver_t::sequential_impulse || contact.relative_velocity(bodies_) >= 0.0f;
+    });
+    if(entry.touching && approaching(contact)) {
+      contact_buffers_.local().emplace_back(candidate, contact);
+    }
+    if(entry.face && approaching(second)) {
+      contact_buffers_.local().emplace_back(candidate, second);
+    }
+  });
+  contact_cache_.update(cache_entries_);
+
+  contact_buffers_.merge(candidate_contacts_,
+                         [](std::pair<std::size_t, contact> const& lhs, std::pair<std::size_t, contact> const& rhs) {
+                           return lhs.first < rhs.first;
+                         });
+
+  // Candidates are grouped by island, so their contacts are as well
+  auto const& offsets(islands_.offsets());
+  contacts_.clear();
+  contact_offsets_.assign(1, 0);
+  std::size_t island(0);
+  for(auto const& candidate_contact : candidate_contacts_) {
+    while(candidate_contact.first >= offsets[island + 1]) {
+      contact_offsets_.push_back(contacts_.size());
+      ++island;
+    }
+    contacts_.push_back(candidate_contact.second);
+  }
+  while(island < islands_.size()) {
+    contact_offsets_.push_back(contacts_.size());
+    ++island;
+  }
+}
+
+void simulation::narrowphase(contact_cache::entry& entry) const {
+  auto const a(entry.pair.first);
+  auto const b(entry.pair.second);
+  shape const& a_shape(world_shapes_[a]);
+  shape const& b_shape(world_shapes_[b]);
+
+  // Round shapes have no vertices for GJK to work with
+  if(narrowphase_ == narrowphase_t::gjk && !a_shape.round() && !b_shape.round()) {
+    entry.collider = collider_t::gjk;
+    narrowphase_gjk(entry);
+    return;
+  }
+
+  manifold manifold;
+  entry.touching = collide(a_shape, b_shape, manifold, entry.collider);
+  if(!entry.touching) return;
+
+  // The force solver takes one contact per pair, the middle of a face
+  auto const& normal(manifold.normal);
+  if(manifold.count == 1) {
+    entry.contact = contact(a, b, manifold.a_points[0], manifold.b_points[0], normal);
+  } else if(solver_ == solver_t::sequential_impulse) {
+    entry.face = true;
+    entry.contact = contact(a, b, manifold.a_points[0], manifold.b_points[0], normal);
+    entry.second = contact(a, b, manifold.a_points[1], manifold.b_points[1], normal);
+  } else {
+    entry.contact = contact(a, b, (manifold.a_points[0] + manifold.a_points[1]) / 2.0f, (manifold.b_points[0] + manifold.b_points[1]) / 2.0f, normal);
+  }
+}
+
+void simulation::narrowphase_gjk(contact_cache::entry& entry) const {
+  auto const& positions(bodies_.positions());
+  auto const a(entry.pair.first);
+  auto const b(entry.pair.second);
+  auto& contact(entry.contact);
+
+  shape const& a_shape(world_shapes_[a]);
+  shape const& b_shape(world_shapes_[b]);
+
+  entry.touching = a_shape.intersects(b_shape);
+  if(!entry.touching) return;
+
+  shape const& a_core(world_cores_[a]);
+  shape const& b_core(world_cores_[b]);
+
+  std::tuple<bool, vector, float, vector, vector> const distance_data(b_core.distance(a_core));
+
+  auto const& normal(std::get<1>(distance_data));
+
+  auto ap(std::get<4>(distance_data));
+  auto bp(std::get<3>(distance_data));
+
+  auto const a_feature(a_shape.feature(-normal));
+  auto const b_feature(b_shape.feature(normal));
+
+  auto const a_segment(segment(a_feature.closest(b_feature.a()), a_feature.closest(b_feature.b())));
+  auto const b_segment(segment(b_feature.closest(a_feature.a()), b_feature.closest(a_feature.b())));
+
+  // A single point cannot hold a box flat on a face, the impulse solver gets
+  // both ends of the overlap once the faces are close to parallel
+  auto const face_tolerance(0.05f);
+  if(solver_ == solver_t::sequential_impulse &&
+     std::abs(a_feature.getVector().normalize().cross(b_feature.getVector().normalize())) <= face_tolerance) {
+    auto face_normal(b_feature.getVector().normalize().left());
+    if(face_normal.dot(normal) < 0.0f) face_normal = -face_normal;
+    entry.face = true;
+    contact = sandbox::contact(a, b, a_segment.a(), b_feature.closest(a_segment.a()), face_normal);
+    entry.second = sandbox::contact(a, b, a_segment.b(), b_feature.closest(a_segment.b()), face_normal);
+  } else if(a_segment.getVector().parallel(b_segment.getVector())) {
+    contact = sandbox::contact(a, b, a_segment.middle(), b_segment.middle(), normal);
+  } else {
+    if(a_core.corner(ap)) {
+      ap += (ap - positions[a]).normalize() * 2.0f;
+      bp = b_feature.closest(ap);
+    } else if(b_core.corner(bp)) {
+      bp += (bp - positions[b]).normalize() * 2.0f;
+      ap = a_feature.closest(bp);
+    }
+
+    contact = sandbox::contact(a, b, ap, bp, normal);
+  }
 }
 
 void simulation::step(float const delta_time, float const time_step) {
+  SANDBOX_TRACE_FRAME();
+  SANDBOX_TRACE_SCOPE("step");
   time_ += delta_time;
   accumulator_ += delta_time;
 
+  if(bodies_.synchronize(objects_)) {
+    contact_cache_.clear();
+    reset_sleeping();
+  }
+  wake_requested();
+
+  auto& forces(bodies_.forces());
+  auto& torques(bodies_.torques());
+
+  SANDBOX_PROFILE_BEGIN(profiler_);
   while(accumulator_ >= time_step) {
-    for(auto object : objects_) {
-      if(!object->kinematic() && !object->frozen()) {
-        object->force() = vector(0.0f, 9.81f);
-        object->torque() = 0.0f;
-      }
+    SANDBOX_PROFILE_STEP(profiler_);
+    for(auto const body : awake_) {
+      forces[body] = vector(0.0f, 9.81f);
+      torques[body] = 0.0f;
     }
 
-    update_world_shapes();
-    update_bounding_boxes();
-    update_quadtree();
+    // The impulse solver works on the velocities the forces leave behind
+    if(solver_ == solver_t::sequential_impulse) {
+      SANDBOX_PROFILE_STAGE(profiler_, forces, apply_forces(time_step));
+    }
 
-    find_collisions();
-    find_islands();
-    find_contacts();
+    SANDBOX_PROFILE_STAGE(profiler_, world_shapes, update_world_shapes());
+
+    // Sleeping islands touched by awake bodies join the step, which may bring
+    // more pairs along
+    do {
+      SANDBOX_PROFILE_STAGE(profiler_, broadphase, update_broadphase());
+      SANDBOX_PROFILE_STAGE(profiler_, collisions, find_collisions());
+    } while(wake_touched());
+    SANDBOX_PROFILE_COUNT(profiler_, bodies, awake_.size());
+    SANDBOX_PROFILE_COUNT(profiler_, pairs, collisions_.size());
+
+    SANDBOX_PROFILE_STAGE(profiler_, islands, find_islands());
+    SANDBOX_PROFILE_STAGE(profiler_, contacts, find_contacts());
+    SANDBOX_PROFILE_COUNT(profiler_, islands, islands_.size());
+    SANDBOX_PROFILE_COUNT(profiler_, hits, static_cast<std::size_t>(std::count_if(contact_cache_.entries().begin(), contact_cache_.entries().end(), [](contact_cache::entry const& entry) {
+      return entry.touching;
+    })));
+
+    SANDBOX_PROFILE_STAGE(profiler_, solve, solve(time_step));
+    SANDBOX_PROFILE_COUNT(profiler_, contacts, contacts_.size());
+    SANDBOX_PROFILE_COUNT(profiler_, iterations, solver_ == solver_t::sequential_impulse ? impulse_solver_.getStatistics().iterations : contacts_.empty() ? 0 : contact_solver_.getStatistics().iterations);
+
+    SANDBOX_PROFILE_STAGE(profiler_, integrate, integrate(time_step));
+    SANDBOX_PROFILE_STAGE(profiler_, sleeping, update_sleeping(time_step));
+    accumulator_ -= time_step;
+  }
+  SANDBOX_PROFILE_END(profiler_);
 
-    if(!contacts_.empty()) {
-      resolve_collisions();
+  if(recorder_) {
+    SANDBOX_TRACE_SCOPE("record");
+    recorder_->record(time_, bodies_);
+  }
+}
 
-      for(auto& island : contacts_) {
-        island.erase(std::remove_if(island.begin(), island.end(), [](contact const& contact) {
-                       return contact.relative_velocity() < 0.0f;
-                     }),
-                     island.end());
+void simulation::solve(float const time_step) {
+  if(solver_ == solver_t::sequential_impulse) {
+    impulse_solver_.solve(contacts_, bodies_, time_step);
+  } else if(!contacts_.empty()) {
+    resolve_collisions();
+
+    // Drop separating contacts, compacting the islands in place
+    std::size_t kept(0);
+    for(std::size_t island(0); island < islands_.size(); ++island) {
+      auto const begin(contact_offsets_[island]);
+      auto const end(contact_offsets_[island + 1]);
+      contact_offsets_[island] = kept;
+      for(auto index(begin); index < end; ++index) {
+        if(contacts_[index].relative_velocity(bodies_) >= 0.0f) contacts_[kept++] = contacts_[index];
       }
-
-      resolve_contacts();
     }
+    contact_offsets_[islands_.size()] = kept;
+    contacts_.resize(kept);
 
-    integrate(time_step);
-    accumulator_ -= time_step;
+    resolve_contacts();
   }
+  contact_cache_.store(contacts_);
+}
+
+void simulation::apply_forces(float const time_step) {
+  auto& linear_velocities(bodies_.linear_velocities());
+  auto& angular_velocities(bodies_.angular_velocities());
+  auto& forces(bodies_.forces());
+  auto& torques(bodies_.torques());
+
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    auto const body(awake_[index]);
+    linear_velocities[body] += forces[body] * time_step;
+    angular_velocities[body] += torques[body] * time_step;
+    forces[body] = vector();
+    torques[body] = 0.0f;
+  });
 }
 
 void simulation::resolve_collisions() {
-  std::for_each(contacts_.begin(), contacts_.end(), [&](std::vector<contact> const& island) {
-    parallel_for_range(island.begin(), island.end(), [&](contact const& contact) {
-      auto const& a(contact.a());
-      auto const& b(contact.b());
+  auto const& masses(bodies_.masses());
+  auto const& moments_of_inertia(bodies_.moments_of_inertia());
+  auto const& positions(bodies_.positions());
+  auto const& kinematic(bodies_.kinematic());
+  auto& linear_velocities(bodies_.linear_velocities());
+  auto& angular_velocities(bodies_.angular_velocities());
+
+  // Islands share no dynamic bodies, so whole islands run concurrently, each
+  // one in order on a single thread, largest first
+  parallel_for(0, islands_.size(), [&](std::size_t const island) {
+    for(auto index(contact_offsets_[island]); index < contact_offsets_[island + 1]; ++index) {
+      auto const& contact(contacts_[index]);
+      auto const a(contact.a());
+      auto const b(contact.b());
       auto const& normal(contact.normal());
 
-      auto const ar(contact.ap() - a->position());
-      auto const br(contact.bp() - b->position());
+      auto const ar(contact.ap() - positions[a]);
+      auto const br(contact.bp() - positions[b]);
 
-      float const restitution(std::max(a->getMaterial().restitution(), b->getMaterial().restitution()));
+      float const restitution(
+          std::max(bodies_.getMaterial(a).restitution(), bodies_.getMaterial(b).restitution()));
 
       float impulse_numerator, impulse_denominator, impulse;
-      if(a->kinematic()) {
-        auto const brv(b->linear_velocity() + br.cross(b->angular_velocity()));
+      if(kinematic[a]) {
+        auto const brv(linear_velocities[b] + br.cross(angular_velocities[b]));
 
         impulse_numerator = (brv * -(1.0f + restitution)).dot(normal);
-        impulse_denominator = 1.0f / b->mass() + (br.cross(normal) * br.cross(normal)) / b->moment_of_inertia();
+        impulse_denominator = 1.0f / masses[b] + (br.cross(normal) * br.cross(normal)) / moments_of_inertia[b];
         impulse = impulse_numerator / impulse_denominator;
 
-        b->linear_velocity() += normal * (impulse / b->mass());
-        b->angular_velocity() += br.cross(normal * impulse) / b->moment_of_inertia();
-      } else if(b->kinematic()) {
-        auto const arv(a->linear_velocity() + ar.cross(a->angular_velocity()));
+        linear_velocities[b] += normal * (impulse / masses[b]);
+        angular_velocities[b] += br.cross(normal * impulse) / moments_of_inertia[b];
+      } else if(kinematic[b]) {
+        auto const arv(linear_velocities[a] + ar.cross(angular_velocities[a]));
 
         impulse_numerator = (arv * -(1.0f + restitution)).dot(normal);
-        impulse_denominator = 1.0f / a->mass() + (ar.cross(normal) * ar.cross(normal)) / a->moment_of_inertia();
+        impulse_denominator = 1.0f / masses[a] + (ar.cross(normal) * ar.cross(normal)) / moments_of_inertia[a];
         impulse = impulse_numerator / impulse_denominator;
 
-        a->linear_velocity() += normal * (impulse / a->mass());
-        a->angular_velocity() += ar.cross(normal * impulse) / a->moment_of_inertia();
+        linear_velocities[a] += normal * (impulse / masses[a]);
+        angular_velocities[a] += ar.cross(normal * impulse) / moments_of_inertia[a];
       } else {
-        vector const vab(a->linear_velocity() + ar.cross(a->angular_velocity()) - b->linear_velocity() -
-                         br.cross(b->angular_velocity()));
+        vector const vab(linear_velocities[a] + ar.cross(angular_velocities[a]) - linear_velocities[b] -
+                         br.cross(angular_velocities[b]));
 
         impulse_numerator = (vab * -(1.0f + restitution)).dot(normal);
-        impulse_denominator = 1.0f / a->mass() + 1.0f / b->mass() +
-                              (ar.cross(normal) * ar.cross(normal)) / a->moment_of_inertia() +
-                              (br.cross(normal) * br.cross(normal)) / b->moment_of_inertia();
+        impulse_denominator = 1.0f / masses[a] + 1.0f / masses[b] +
+                              (ar.cross(normal) * ar.cross(normal)) / moments_of_inertia[a] +
+                              (br.cross(normal) * br.cross(normal)) / moments_of_inertia[b];
         impulse = impulse_numerator / impulse_denominator;
 
-        a->linear_velocity() += normal * (impulse / a->mass());
-        a->angular_velocity() += ar.cross(normal * impulse) / a->moment_of_inertia();
+        linear_velocities[a] += normal * (impulse / masses[a]);
+        angular_velocities[a] += ar.cross(normal * impulse) / moments_of_inertia[a];
 
-        b->linear_velocity() -= normal * (impulse / b->mass());
-        b->angular_velocity() -= br.cross(normal * impulse) / b->moment_of_inertia();
+        linear_velocities[b] -= normal * (impulse / masses[b]);
+        angular_velocities[b] -= br.cross(normal * impulse) / moments_of_inertia[b];
       }
-    });
-  });
+    }
+  }, 1, 1);
 }
 
 void simulation::resolve_contacts() {
-  std::for_each(contacts_.begin(), contacts_.end(), [&](std::vector<contact> const& island) {
-    auto const n(island.size());
-    matrix<> A(n, n);
-
-    for(unsigned int i(0); i < n; ++i) {
-      auto const& contact_i(island[i]);
-      auto const& i_a(contact_i.a());
-      auto const& i_b(contact_i.b());
-      auto const& i_normal(contact_i.normal());
-
-      auto const i_ar(contact_i.ap() - i_a->position());
-      auto const i_br(contact_i.bp() - i_b->position());
-
-      parallel_for_range_index(island.begin(), island.end(), [&](contact const& contact_j, std::size_t const j) {
-        auto const& j_a(contact_j.a());
-        auto const& j_b(contact_j.b());
-        auto const& j_normal(contact_j.normal());
-
-        auto const j_ar(contact_j.ap() - j_a->position());
-        auto const j_br(contact_j.bp() - j_b->position());
-
-        if(i_a == j_a) {
-          A(i, j) += i_normal.dot(j_normal / i_a->mass() + i_ar.cross(j_ar.cross(j_normal)) / i_a->moment_of_inertia());
-        }
-        if(i_a == j_b) {
-          A(i, j) -= i_normal.dot(j_normal / i_a->mass() + i_ar.cross(j_br.cross(j_normal)) / i_a->moment_of_inertia());
-        }
-        if(!i_b->kinematic() && i_b == j_a) {
-          A(i, j) -= i_normal.dot(j_normal / i_b->mass() + i_br.cross(j_ar.cross(j_normal)) / i_b->moment_of_inertia());
-        }
-        if(!i_b->kinematic() && i_b == j_b) {
-          A(i, j) += i_normal.dot(j_normal / i_b->mass() + i_br.cross(j_br.cross(j_normal)) / i_b->moment_of_inertia());
-        }
-      });
-    }
-
-    matrix<> B(n);
-    parallel_for_range_index(island.begin(), island.end(), [&](contact const& contact, std::size_t const i) {
-      auto const& a(contact.a());
-      auto const& b(contact.b());
-      auto const& normal(contact.normal());
-
-      auto const ar(contact.ap() - a->position());
-      auto const br(contact.bp() - b->position());
-
-      if(!b->kinematic()) {
-        auto const arv(a->linear_velocity() + ar.cross(a->angular_velocity()));
-        auto const brv(b->linear_velocity() + br.cross(b->angular_velocity()));
-        B(i) += 2.0f * normal.cross(b->angular_velocity()).dot(arv - brv);
-      }
-
-      B(i) += normal.dot(a->force() / a->mass() + ar.cross(a->torque() / a->moment_of_inertia()) +
-                         ar.cross(a->angular_velocity()).cross(a->angular_velocity()));
-      B(i) -= normal.dot(b->force() / b->mass() + br.cross(b->torque() / b->moment_of_inertia()) +
-                         br.cross(b->angular_velocity()).cross(b->angular_velocity()));
-    });
-
-    // http://www.coneural.org/reports/Coneural-05-01.pdf
-    matrix<> f(n);
-    for(unsigned int i(0); i < n; ++i) {
-      auto q(B(i));
-      for(unsigned int j(0); j < n; ++j) {
-        if(j != i) {
-          q += A(i, j) * f(j);
-        }
-      }
-      if(q >= -10e10) {
-        f(i) = 0.0f;
-      } else {
-        f(i) -= q / A(i, i);
-      }
-    }
-
-    parallel_for_range_index(island.begin(), island.end(), [&](contact const& contact, std::size_t const i) {
-      auto a(contact.a());
-      auto b(contact.b());
-      auto const& normal(contact.normal());
-
-      auto const force(f(i));
-
-      if(!a->kinematic()) {
-        auto const ar(contact.ap() - a->position());
-        a->force() += normal * (force / a->mass());
-        a->torque() += ar.cross(normal * force) / a->moment_of_inertia();
-      }
-      if(!b->kinematic()) {
-        auto const br(contact.bp() - b->position());
-        b->force() -= normal * (force / b->mass());
-        b->torque() -= br.cross(normal * force) / b->moment_of_inertia();
-      }
-    });
-  });
+  contact_solver_.solve(contacts_, contact_offsets_, bodies_);
 }
 
 std::tuple<vector, vector, float, float> simulation::evaluate(
-    std::shared_ptr<object> const& initial,
+    std::size_t const initial,
     float const time,
     float const time_step,
     std::tuple<vector, vector, float, float> const& derivative) const {
-  return std::make_tuple(initial->linear_velocity() + std::get<1>(derivative) * time_step,
-                         initial->force(),
-                         initial->angular_velocity() + std::get<3>(derivative) * time_step,
-                         initial->torque());
+  return std::make_tuple(bodies_.linear_velocities()[initial] + std::get<1>(derivative) * time_step,
+                         bodies_.forces()[initial],
+                         bodies_.angular_velocities()[initial] + std::get<3>(derivative) * time_step,
+                         bodies_.torques()[initial]);
 }
 
 void simulation::integrate(float const time_step) {
-  parallel_for_range(objects_.begin(), objects_.end(), [&](object_t const& object) {
-    if(!object->kinematic()) {
-      auto const a(evaluate(object, time_, 0.0f, std::tuple<vector, vector, float, float>()));
-      auto const b(evaluate(object, time_ + time_step * 0.5, time_step * 0.5, a));
-      auto const c(evaluate(object, time_ + time_step * 0.5, time_step * 0.5, b));
-      auto const d(evaluate(object, time_ + time_step, time_step, c));
-
-      object->position() +=
-          (std::get<0>(a) + (std::get<0>(b) + std::get<0>(c)) * 2.0f + std::get<0>(d)) * (1.0f / 6.0f) * time_step;
-      object->linear_velocity() +=
-          (std::get<1>(a) + (std::get<1>(b) + std::get<1>(c)) * 2.0f + std::get<1>(d)) * (1.0f / 6.0f) * time_step;
-      object->orientation() +=
-          (std::get<2>(a) + (std::get<2>(b) + std::get<2>(c)) * 2.0f + std::get<2>(d)) * (1.0f / 6.0f) * time_step;
-      object->angular_velocity() +=
-          (std::get<3>(a) + (std::get<3>(b) + std::get<3>(c)) * 2.0f + std::get<3>(d)) * (1.0f / 6.0f) * time_step;
-
-      auto const movement_threshold(0.01f);
-      if(object->linear_velocity().length() <= movement_threshold &&
-         std::abs(object->angular_velocity()) <= movement_threshold) {
-        object->frozen(true);
-        object->linear_velocity() = vector();
-        object->angular_velocity() = 0.0f;
-      } else {
-        object->frozen(false);
-      }
+  auto& dirty(bodies_.dirty());
+  auto& positions(bodies_.positions());
+  auto& linear_velocities(bodies_.linear_velocities());
+  auto& orientations(bodies_.orientations());
+  auto& angular_velocities(bodies_.angular_velocities());
+
+  parallel_for(0, awake_.size(), [&](std::size_t const index) {
+    auto const body(awake_[index]);
+    auto const a(evaluate(body, time_, 0.0f, std::tuple<vector, vector, float, float>()));
+    auto const b(evaluate(body, time_ + time_step * 0.5, time_step * 0.5, a));
+    auto const c(evaluate(body, time_ + time_step * 0.5, time_step * 0.5, b));
+    auto const d(evaluate(body, time_ + time_step, time_step, c));
+
+    auto const movement((std::get<0>(a) + (std::get<0>(b) + std::get<0>(c)) * 2.0f + std::get<0>(d)) * (1.0f / 6.0f) * time_step);
+    auto const rotation((std::get<2>(a) + (std::get<2>(b) + std::get<2>(c)) * 2.0f + std::get<2>(d)) * (1.0f / 6.0f) * time_step);
+    if(movement.length_squared() > 0.0f || rotation != 0.0f) {
+      positions[body] += movement;
+      orientations[body] += rotation;
+      dirty[body] = 1;
     }
+    linear_velocities[body] +=
+        (std::get<1>(a) + (std::get<1>(b) + std::get<1>(c)) * 2.0f + std::get<1>(d)) * (1.0f / 6.0f) * time_step;
+    angular_velocities[body] +=
+        (std::get<3>(a) + (std::get<3>(b) + std::get<3>(c)) * 2.0f + std::get<3>(d)) * (1.0f / 6.0f) * time_step;
   });
 }
-}
+}
\ No newline at end of file
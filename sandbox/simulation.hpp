@@ -1,16 +1,29 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <ostream>
 #include <vector>
 #include <string>
 #include <unordered_map>
-#include <set>
 #include <unordered_set>
 #include <thread>
-#include <mutex>
+#include <tuple>
 
 #include "object.hpp"
+#include "bodies.hpp"
 #include "contact.hpp"
+#include "contact_cache.hpp"
+#include "contact_solver.hpp"
+#include "impulse_solver.hpp"
+#include "islands.hpp"
 #include "quadtree.hpp"
+#include "sweep_and_prune.hpp"
+#include "aabb_tree.hpp"
+#include "spatial_hash.hpp"
+#include "profiler.hpp"
+#include "recorder.hpp"
+#include "misc.hpp"
 
 namespace sandbox {
 
@@ -18,7 +31,116 @@ namespace sandbox {
   public:
       typedef std::shared_ptr<object> object_t;
 
-      simulation(float const width, float const height) : width_(width), height_(height), time_(0.0f), accumulator_(0.0f), quadtree_(rectangle(vector(0.0f, 0.0f), vector(width_, height_))) {
+      enum class broadphase_t {
+        quadtree,
+        sweep_and_prune,
+        aabb_tree,
+        spatial_hash
+      };
+
+      // force resolves collisions with one impulse per contact and resting
+      // contacts with the force solver, sequential_impulse does both on the
+      // velocities with the impulse solver
+      enum class solver_t {
+        force,
+        sequential_impulse
+      };
+
+      // gjk tests every pair for overlap with GJK and finds the contact from
+      // the distance between the cores, sat sends pairs of boxes and other
+      // polygons to separating axis routines of their own. Pairs with a
+      // circle or capsule always go to their own routines.
+      enum class narrowphase_t {
+        gjk,
+        sat
+      };
+
+      simulation(float const width, float const height) : width_(width), height_(height), time_(0.0f), accumulator_(0.0f), deterministic_(false), allow_sleeping_(true), linear_sleep_tolerance_(0.1f), angular_sleep_tolerance_(0.005f), time_to_sleep_(0.5f), broadphase_(broadphase_t::quadtree), quadtree_(rectangle(vector(0.0f, 0.0f), vector(width_, height_))), awake_changed_(false), narrowphase_(narrowphase_t::sat), solver_(solver_t::force) {
+      }
+
+      broadphase_t broadphase() const {
+        return broadphase_;
+      }
+
+      void broadphase(broadphase_t const value) {
+        broadphase_ = value;
+      }
+
+      narrowphase_t narrowphase() const {
+        return narrowphase_;
+      }
+
+      void narrowphase(narrowphase_t const value) {
+        narrowphase_ = value;
+      }
+
+      solver_t solver() const {
+        return solver_;
+      }
+
+      void solver(solver_t const value) {
+        solver_ = value;
+      }
+
+      // Stepping gives the same bits whatever the number of threads: parallel
+      // stages merge their results sorted, and islands and solver batches
+      // follow body indices rather than timing or addresses. Deterministic
+      // mode also turns bodies with kernels::sin_cos instead of the C
+      // library, so builds on other platforms agree as well as long as their
+      // compilers keep multiply-adds apart (-ffp-contract=off, /fp:precise).
+      // Set it before the first step.
+      bool deterministic() const {
+        return deterministic_;
+      }
+
+      void deterministic(bool const value) {
+        deterministic_ = value;
+        contact_cache_.deterministic(value);
+      }
+
+      // Hash of the state that decides every later step: the time, each
+      // object's position, orientation, velocities and rest, and the cached
+      // contacts warm starting the next one. Independent of byte order, for
+      // comparing replays and lockstep runs.
+      std::uint64_t state_hash() const;
+
+      bool allow_sleeping() const {
+        return allow_sleeping_;
+      }
+
+      // Turning sleeping off wakes every sleeping body on the next step
+      void allow_sleeping(bool const value);
+
+      // Speeds below which a body counts as resting, in pixels and radians
+      // per second
+      float linear_sleep_tolerance() const {
+        return linear_sleep_tolerance_;
+      }
+
+      void linear_sleep_tolerance(float const value) {
+        linear_sleep_tolerance_ = value;
+      }
+
+      float angular_sleep_tolerance() const {
+        return angular_sleep_tolerance_;
+      }
+
+      void angular_sleep_tolerance(float const value) {
+        angular_sleep_tolerance_ = value;
+      }
+
+      // Seconds every body of an island has to rest before it falls asleep
+      float time_to_sleep() const {
+        return time_to_sleep_;
+      }
+
+      void time_to_sleep(float const value) {
+        time_to_sleep_ = value;
+      }
+
+      // Dynamic bodies that are not sleeping, in index order
+      std::vector<std::size_t> const & awake() const {
+        return awake_;
       }
 
       std::vector<object_t> const & objects() const {
@@ -29,18 +151,95 @@ namespace sandbox {
         return objects_;
       }
 
-      std::unordered_map<object_t, rectangle> const & bounding_boxes() const {
+      sandbox::bodies const & getBodies() const {
+        return bodies_;
+      }
+
+      std::vector<shape> const & world_shapes() const {
+        return world_shapes_;
+      }
+
+      std::vector<rectangle> const & bounding_boxes() const {
         return bounding_boxes_;
       }
 
-      std::vector<std::vector<contact>> const & contacts() const {
+      sandbox::islands const & getIslands() const {
+        return islands_;
+      }
+
+      // Contacts grouped by island, island i being
+      // [contact_offsets()[i], contact_offsets()[i + 1])
+      std::vector<contact> const & contacts() const {
         return contacts_;
       }
 
+      std::vector<std::size_t> const & contact_offsets() const {
+        return contact_offsets_;
+      }
+
+      sandbox::contact_cache const & getContactCache() const {
+        return contact_cache_;
+      }
+
+      sandbox::contact_cache & getContactCache() {
+        return contact_cache_;
+      }
+
+      sandbox::contact_solver const & getContactSolver() const {
+        return contact_solver_;
+      }
+
+      sandbox::contact_solver & getContactSolver() {
+        return contact_solver_;
+      }
+
+      sandbox::impulse_solver const & getImpulseSolver() const {
+        return impulse_solver_;
+      }
+
+      sandbox::impulse_solver & getImpulseSolver() {
+        return impulse_solver_;
+      }
+
       quadtree const & getQuadtree() const {
         return quadtree_;
       }
 
+      sandbox::sweep_and_prune const & getSweepAndPrune() const {
+        return sweep_and_prune_;
+      }
+
+      sandbox::aabb_tree const & getAabbTree() const {
+        return aabb_tree_;
+      }
+
+      sandbox::spatial_hash const & getSpatialHash() const {
+        return spatial_hash_;
+      }
+
+      sandbox::spatial_hash & getSpatialHash() {
+        return spatial_hash_;
+      }
+
+      // Stage times and counts of the latest calls to step, recorded only
+      // with SANDBOX_PROFILE defined
+      sandbox::profiler const & getProfiler() const {
+        return profiler_;
+      }
+
+      sandbox::profiler & getProfiler() {
+        return profiler_;
+      }
+
+      // Records the bodies after every step when set
+      std::shared_ptr<sandbox::recorder> const & recorder() const {
+        return recorder_;
+      }
+
+      void recorder(std::shared_ptr<sandbox::recorder> const & value) {
+        recorder_ = value;
+      }
+
       float time() const {
         return time_;
       }
@@ -48,43 +247,92 @@ namespace sandbox {
       void step(float const delta_time, float const time_step);
 
     private:
+      friend void save_snapshot(simulation const & simulation, std::ostream & stream, bool const caches);
+      friend std::shared_ptr<simulation> load_snapshot(void const * const data, std::size_t const size);
+
       float const width_;
       float const height_;
 
       float time_;
       float accumulator_;
+      bool deterministic_;
 
-      std::vector<object_t> objects_;
+      bool allow_sleeping_;
+      float linear_sleep_tolerance_;
+      float angular_sleep_tolerance_;
+      float time_to_sleep_;
 
-      std::unordered_map<object_t, shape> world_shapes_;
-      std::mutex world_shapes_mutex_;
+      std::vector<object_t> objects_;
+      sandbox::bodies bodies_;
 
-      std::unordered_map<object_t, rectangle> bounding_boxes_;
-      std::mutex bounding_boxes_mutex_;
+      // World space shapes and cores, recomputed only for bodies marked dirty
+      std::vector<shape> world_shapes_;
+      std::vector<shape> world_cores_;
+      std::vector<rectangle> bounding_boxes_;
 
+      broadphase_t broadphase_;
       sandbox::quadtree quadtree_;
+      sandbox::sweep_and_prune sweep_and_prune_;
+      sandbox::aabb_tree aabb_tree_;
+      sandbox::spatial_hash spatial_hash_;
+      std::vector<std::pair<std::size_t, std::size_t>> broadphase_pairs_;
+
+      // Only awake bodies go through the selected broadphase, by their
+      // position in awake_. Kinematic and sleeping bodies rest in a tree of
+      // their own that the awake bodies query.
+      std::vector<std::size_t> awake_;
+      std::vector<rectangle> awake_boxes_;
+      bool awake_changed_;
+      sandbox::aabb_tree resting_;
+
+      // Bodies of a sleeping island form a ring, each linking to the next,
+      // so that touching one wakes them all
+      std::vector<std::size_t> sleep_links_;
+      std::vector<char> sleep_states_;
+
+      std::vector<std::pair<std::size_t, std::size_t>> collisions_;
+      thread_buffers<std::pair<std::size_t, std::size_t>> collision_buffers_;
+
+      sandbox::islands islands_;
+
+      std::vector<std::pair<std::size_t, contact>> candidate_contacts_;
+      thread_buffers<std::pair<std::size_t, contact>> contact_buffers_;
+      sandbox::contact_cache contact_cache_;
+      std::vector<contact_cache::entry> cache_entries_;
+      narrowphase_t narrowphase_;
 
-      std::unordered_map<object_t, std::unordered_set<object_t>> collisions_;
-      std::mutex collisions_mutex_;
+      std::vector<contact> contacts_;
+      std::vector<std::size_t> contact_offsets_;
+      solver_t solver_;
+      sandbox::contact_solver contact_solver_;
+      sandbox::impulse_solver impulse_solver_;
 
-      std::set<std::shared_ptr<std::set<std::pair<object_t, object_t>>>> islands_;
-      std::mutex islands_mutex_;
+      sandbox::profiler profiler_;
+      std::shared_ptr<sandbox::recorder> recorder_;
 
-      std::vector<std::vector<contact>> contacts_;
-      std::mutex contacts_mutex_;
+      void reset_sleeping();
+      void restore(std::vector<char> const & sleeping, std::vector<std::size_t> const & sleep_links, std::vector<float> const & sleep_times, std::vector<std::size_t> const & woken, std::vector<contact_cache::entry> & entries);
+      void wake_requested();
+      void wake_island(std::size_t const body);
+      bool wake_touched();
+      void update_sleeping(float const time_step);
 
+      void update_world_shape(std::size_t const body);
       void update_world_shapes();
-      void update_bounding_boxes();
-      void update_quadtree();
+      void update_broadphase();
 
       void find_collisions();
       void find_islands();
       void find_contacts();
+      void narrowphase(contact_cache::entry & entry) const;
+      void narrowphase_gjk(contact_cache::entry & entry) const;
 
+      void solve(float const time_step);
+      void apply_forces(float const time_step);
       void resolve_collisions();
       void resolve_contacts();
 
-      std::tuple<vector, vector, float, float> evaluate(object_t const & initial, float const time, float const time_step, std::tuple<vector, vector, float, float> const & derivative) const;
+      std::tuple<vector, vector, float, float> evaluate(std::size_t const initial, float const time, float const time_step, std::tuple<vector, vector, float, float> const & derivative) const;
       void integrate(float const time_step);
   };
 
@@ -1,6 +1,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "simulation.hpp"
+#include "scheduler.hpp"
 #include "color.hpp"
 
 BOOST_AUTO_TEST_SUITE(simulation)
@@ -9,17 +10,335 @@ BOOST_AUTO_TEST_CASE(collision) {
   sandbox::simulation simulation(200, 200);
 
   std::shared_ptr<sandbox::object> const o1(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
-  o1->position() = sandbox::vector(40, 40) + sandbox::vector(10, 10);
+  o1->position(sandbox::vector(40, 40) + sandbox::vector(10, 10));
 
   std::shared_ptr<sandbox::object> const o2(new sandbox::object(sandbox::shape(sandbox::rectangle(50, 50).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
-  o2->position() = sandbox::vector(10, 60) + sandbox::vector(25, 25);
+  o2->position(sandbox::vector(10, 60) + sandbox::vector(25, 25));
   o2->kinematic(true);
 
   simulation.objects().push_back(o1);
   simulation.objects().push_back(o2);
 
-  simulation.step(0.0f1, 0.0f1);
-  simulation.step(0.0f1, 0.0f1);
+  simulation.step(0.01f, 0.01f);
+  simulation.step(0.01f, 0.01f);
+}
+
+BOOST_AUTO_TEST_CASE(bodies) {
+  std::shared_ptr<sandbox::object> o1(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
+  o1->position(sandbox::vector(100, 100));
+  o1->linear_velocity(sandbox::vector(10, 0));
+
+  {
+    sandbox::simulation simulation(200, 200);
+    simulation.objects().push_back(o1);
+    simulation.step(0.01f, 0.01f);
+
+    auto const & bodies(simulation.getBodies());
+    BOOST_CHECK_EQUAL(bodies.size(), 1u);
+    BOOST_CHECK(bodies.positions()[0] == o1->position());
+    BOOST_CHECK(o1->position().x() > 100.0f);
+
+    o1->linear_velocity(sandbox::vector());
+    BOOST_CHECK(!bodies.linear_velocities()[0]);
+  }
+
+  BOOST_CHECK(o1->position().x() > 100.0f);
+}
+
+std::vector<sandbox::vector> stack(sandbox::simulation::broadphase_t const broadphase) {
+  sandbox::simulation simulation(400, 400);
+  simulation.broadphase(broadphase);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  for(unsigned int y(0); y < 5; ++y) {
+    for(unsigned int x(0); x < 3; ++x) {
+      std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+      object->position(sandbox::vector(150 + x * 25.0f, 345 - y * 25.0f));
+      simulation.objects().push_back(object);
+    }
+  }
+
+  for(unsigned int i(0); i < 100; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+
+  std::vector<sandbox::vector> positions;
+  for(auto const & object : simulation.objects()) {
+    positions.push_back(object->position());
+  }
+  return positions;
+}
+
+BOOST_AUTO_TEST_CASE(broadphases) {
+  auto const quadtree(stack(sandbox::simulation::broadphase_t::quadtree));
+
+  for(auto const broadphase : { sandbox::simulation::broadphase_t::sweep_and_prune, sandbox::simulation::broadphase_t::aabb_tree, sandbox::simulation::broadphase_t::spatial_hash }) {
+    auto const positions(stack(broadphase));
+    BOOST_REQUIRE_EQUAL(quadtree.size(), positions.size());
+    for(std::size_t i(0); i < quadtree.size(); ++i) {
+      BOOST_CHECK_EQUAL(quadtree[i].x(), positions[i].x());
+      BOOST_CHECK_EQUAL(quadtree[i].y(), positions[i].y());
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(sequential_impulse) {
+  sandbox::simulation simulation(400, 400);
+  simulation.solver(sandbox::simulation::solver_t::sequential_impulse);
+  // Keeps the settled stack in the solver to the last step
+  simulation.allow_sleeping(false);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  for(unsigned int y(0); y < 10; ++y) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+    object->position(sandbox::vector(200, 345 - y * 25.0f));
+    simulation.objects().push_back(object);
+  }
+
+  for(unsigned int i(0); i < 2000; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+
+  // The stack neither sinks nor topples
+  for(unsigned int y(0); y < 10; ++y) {
+    auto const & object(simulation.objects()[y + 1]);
+    BOOST_CHECK_SMALL(object->position().x() - 200.0f, 2.0f);
+    BOOST_CHECK_SMALL(object->position().y() - (350.0f - y * 20.0f), 1.0f);
+    BOOST_CHECK_SMALL(object->orientation(), 0.02f);
+  }
+  BOOST_CHECK_GT(simulation.getImpulseSolver().getStatistics().contacts, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(sleeping) {
+  sandbox::simulation simulation(400, 400);
+  simulation.solver(sandbox::simulation::solver_t::sequential_impulse);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  auto const add([&](sandbox::vector const & position) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+    object->position(position);
+    simulation.objects().push_back(object);
+    return object;
+  });
+  auto const bottom(add(sandbox::vector(100, 350)));
+  auto const top(add(sandbox::vector(100, 330)));
+  auto const lone(add(sandbox::vector(300, 350)));
+  auto const falling(add(sandbox::vector(300, 200)));
+  falling->linear_velocity(sandbox::vector(0, 50));
+
+  // Everything resting falls asleep after time_to_sleep, the falling box
+  // stays awake
+  for(unsigned int i(0); i < 200; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_CHECK(bottom->sleeping());
+  BOOST_CHECK(top->sleeping());
+  BOOST_CHECK(lone->sleeping());
+  BOOST_CHECK(!falling->sleeping());
+  BOOST_CHECK_EQUAL(simulation.awake().size(), 1u);
+  BOOST_CHECK(!bottom->linear_velocity());
+
+  // Landing on the lone box wakes it, the stack is not touched
+  for(unsigned int i(0); i < 1000 && lone->sleeping(); ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_CHECK(!lone->sleeping());
+  BOOST_CHECK_GT(falling->position().y(), 300.0f);
+  BOOST_CHECK(top->sleeping());
+
+  // Waking one body wakes its island
+  top->wake();
+  simulation.step(0.005f, 0.005f);
+  BOOST_CHECK(!top->sleeping());
+  BOOST_CHECK(!bottom->sleeping());
+
+  for(unsigned int i(0); i < 2000; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_CHECK(bottom->sleeping());
+  BOOST_CHECK(lone->sleeping());
+  BOOST_CHECK(falling->sleeping());
+  BOOST_CHECK(simulation.awake().empty());
+  BOOST_CHECK_SMALL(top->position().y() - 330.0f, 1.0f);
+  BOOST_CHECK_SMALL(falling->position().y() - 330.0f, 1.0f);
+
+  simulation.allow_sleeping(false);
+  simulation.step(0.005f, 0.005f);
+  BOOST_CHECK_EQUAL(simulation.awake().size(), 4u);
+  BOOST_CHECK(!falling->sleeping());
+}
+
+BOOST_AUTO_TEST_CASE(outside_changes) {
+  sandbox::simulation simulation(400, 400);
+  simulation.solver(sandbox::simulation::solver_t::sequential_impulse);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+  auto const add([&](sandbox::vector const & position, float const width, float const height) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(width, height).vertices()), material));
+    object->position(position);
+    simulation.objects().push_back(object);
+    return object;
+  });
+  auto const floor(add(sandbox::vector(200, 380), 400, 40));
+  floor->kinematic(true);
+  auto const platform(add(sandbox::vector(60, 300), 100, 20));
+  platform->kinematic(true);
+  auto const box(add(sandbox::vector(300, 350), 20, 20));
+  for(unsigned int i(0); i < 200; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_REQUIRE(box->sleeping());
+
+  // A push wakes a sleeping body without asking
+  box->linear_velocity(sandbox::vector(50, 0));
+  for(unsigned int i(0); i < 50; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_CHECK(!box->sleeping());
+  BOOST_CHECK_GT(box->position().x(), 305.0f);
+
+  // A kinematic body moved under a falling one catches it where it is now
+  auto const falling(add(sandbox::vector(200, 260), 20, 20));
+  simulation.step(0.005f, 0.005f);
+  platform->position(sandbox::vector(200, 300));
+  for(unsigned int i(0); i < 600; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  BOOST_CHECK_SMALL(falling->position().y() - 280.0f, 1.0f);
+}
+
+BOOST_AUTO_TEST_CASE(world_shapes) {
+  sandbox::simulation simulation(200, 200);
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const wall(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 100).vertices()), material));
+  wall->position(sandbox::vector(10, 100));
+  wall->kinematic(true);
+  simulation.objects().push_back(wall);
+
+  std::shared_ptr<sandbox::object> const box(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+  box->position(sandbox::vector(100, 100));
+  box->angular_velocity(1.0f);
+  simulation.objects().push_back(box);
+
+  simulation.step(0.01f, 0.01f);
+  auto const & bodies(simulation.getBodies());
+
+  // The core is computed once and shared with the body store
+  BOOST_CHECK_EQUAL(&bodies.getCore(1), &box->getCore());
+  BOOST_CHECK_EQUAL(box->getCore().vertices().size(), box->getShape().core().vertices().size());
+
+  // Shapes are those the step started from
+  auto const check([&](std::size_t const body, sandbox::object const & object, sandbox::vector const & position, float const orientation) {
+    auto const expected(object.getShape().transform(position, orientation));
+    auto const & vertices(simulation.world_shapes()[body].vertices());
+    BOOST_REQUIRE_EQUAL(vertices.size(), expected.vertices().size());
+    for(std::size_t i(0); i < vertices.size(); ++i) {
+      BOOST_CHECK_SMALL((vertices[i] - expected.vertices()[i]).length(), 1e-4f);
+    }
+  });
+
+  // Shapes move with the bodies, which are left clean afterwards
+  auto const position(box->position());
+  auto const orientation(box->orientation());
+  simulation.step(0.01f, 0.01f);
+  // Reading through a const object leaves the flag alone
+  sandbox::object const & fixed(*wall);
+  check(0, fixed, fixed.position(), fixed.orientation());
+  check(1, *box, position, orientation);
+  BOOST_CHECK(!bodies.dirty()[0]);
+
+  // Moving a kinematic body from outside marks it, the next step applies it
+  wall->position(wall->position() + sandbox::vector(0, 10));
+  BOOST_CHECK(bodies.dirty()[0]);
+  simulation.step(0.01f, 0.01f);
+  check(0, fixed, fixed.position(), fixed.orientation());
+  BOOST_CHECK(!bodies.dirty()[0]);
+  BOOST_CHECK_CLOSE(simulation.bounding_boxes()[0].top_left().y(), 60.0f, 1e-4f);
+}
+
+std::uint64_t pile(sandbox::simulation::solver_t const solver, bool const deterministic, std::size_t const threads) {
+  sandbox::scheduler::instance().concurrency(threads);
+  sandbox::simulation simulation(400, 400);
+  simulation.solver(solver);
+  simulation.deterministic(deterministic);
+
+  sandbox::material const material(1.0f, 0.2f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation.objects().push_back(floor);
+
+  // Enough bodies and pairs for every stage to split its work
+  for(unsigned int y(0); y < 8; ++y) {
+    for(unsigned int x(0); x < 12; ++x) {
+      std::shared_ptr<sandbox::object> const object(new sandbox::object((x + y) % 2 ? sandbox::shape::circle(9.0f) : sandbox::shape(sandbox::rectangle(18, 18).vertices()), material));
+      object->position(sandbox::vector(60 + x * 24.0f + y % 2 * 6.0f, 345 - y * 22.0f));
+      object->linear_velocity(sandbox::vector(x % 3 * 5.0f, 40.0f));
+      object->angular_velocity((x % 2 ? 0.5f : -0.5f));
+      simulation.objects().push_back(object);
+    }
+  }
+
+  for(unsigned int i(0); i < 200; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+  return simulation.state_hash();
+}
+
+BOOST_AUTO_TEST_CASE(determinism) {
+  for(auto const solver : { sandbox::simulation::solver_t::force, sandbox::simulation::solver_t::sequential_impulse }) {
+    for(auto const deterministic : { false, true }) {
+      auto const serial(pile(solver, deterministic, 1));
+      BOOST_CHECK_EQUAL(pile(solver, deterministic, 2), serial);
+      BOOST_CHECK_EQUAL(pile(solver, deterministic, 4), serial);
+    }
+  }
+  sandbox::scheduler::instance().concurrency(0);
+}
+
+BOOST_AUTO_TEST_CASE(state_hash) {
+  sandbox::simulation simulation(200, 200);
+  std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
+  object->position(sandbox::vector(100, 100));
+  simulation.objects().push_back(object);
+  std::shared_ptr<sandbox::object> const wall(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
+  wall->position(sandbox::vector(30, 30));
+  wall->kinematic(true);
+  simulation.objects().push_back(wall);
+
+  auto const initial(simulation.state_hash());
+  BOOST_CHECK_EQUAL(simulation.state_hash(), initial);
+  simulation.step(0.01f, 0.01f);
+  auto const stepped(simulation.state_hash());
+  BOOST_CHECK_NE(stepped, initial);
+  // Hashing reads the transforms without marking the wall as moved
+  BOOST_CHECK_EQUAL(simulation.getBodies().dirty()[1], 0);
+
+  // A single bit of one velocity shows
+  object->angular_velocity(-0.0f);
+  BOOST_CHECK_NE(simulation.state_hash(), stepped);
+  object->angular_velocity(0.0f);
+  BOOST_CHECK_EQUAL(simulation.state_hash(), stepped);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+
+namespace sandbox {
+
+  // Contiguous storage for trivially copyable elements that keeps up to
+  // Capacity of them inline and only allocates past that. It holds no pointer
+  // into itself, so a small_vector can be moved around in memory with a plain
+  // copy of its bytes, the elements along with it.
+  template<typename T, std::size_t Capacity>
+  class small_vector {
+    static_assert(std::is_trivially_copyable<T>::value, "small_vector elements are copied as bytes");
+
+  public:
+    typedef T value_type;
+    typedef T * iterator;
+    typedef T const * const_iterator;
+    typedef std::size_t size_type;
+
+    small_vector() : heap_(nullptr), size_(0), capacity_(Capacity) {
+    }
+
+    explicit small_vector(size_type const size, T const & value = T()) : small_vector() {
+      resize(size, value);
+    }
+
+    template<typename Iterator>
+    small_vector(Iterator first, Iterator last) : small_vector() {
+      assign(first, last);
+    }
+
+    small_vector(std::initializer_list<T> const values) : small_vector() {
+      assign(values.begin(), values.end());
+    }
+
+    small_vector(small_vector const & other) : small_vector() {
+      assign(other.begin(), other.end());
+    }
+
+    small_vector(small_vector && other) : small_vector() {
+      take(other);
+    }
+
+    ~small_vector() {
+      std::free(heap_);
+    }
+
+    small_vector & operator =(small_vector const & other) {
+      if(this != &other) assign(other.begin(), other.end());
+      return *this;
+    }
+
+    small_vector & operator =(small_vector && other) {
+      if(this != &other) {
+        std::free(heap_);
+        heap_ = nullptr;
+        capacity_ = Capacity;
+        take(other);
+      }
+      return *this;
+    }
+
+    size_type size() const {
+      return size_;
+    }
+
+    size_type capacity() const {
+      return capacity_;
+    }
+
+    bool empty() const {
+      return !size_;
+    }
+
+    // True once the elements no longer fit inline
+    bool allocated() const {
+      return heap_ != nullptr;
+    }
+
+    T * data() {
+      return heap_ ? heap_ : reinterpret_cast<T *>(&storage_);
+    }
+
+    T const * data() const {
+      return heap_ ? heap_ : reinterpret_cast<T const *>(&storage_);
+    }
+
+    T & operator [](size_type const index) {
+      return data()[index];
+    }
+
+    T const & operator [](size_type const index) const {
+      return data()[index];
+    }
+
+    T & front() {
+      return data()[0];
+    }
+
+    T const & front() const {
+      return data()[0];
+    }
+
+    T & back() {
+      return data()[size_ - 1];
+    }
+
+    T const & back() const {
+      return data()[size_ - 1];
+    }
+
+    iterator begin() {
+      return data();
+    }
+
+    const_iterator begin() const {
+      return data();
+    }
+
+    iterator end() {
+      return data() + size_;
+    }
+
+    const_iterator end() const {
+      return data() + size_;
+    }
+
+    void reserve(size_type const capacity) {
+      if(capacity <= capacity_) return;
+
+      auto const grown(static_cast<T *>(std::malloc(capacity * sizeof(T))));
+      if(!grown) throw std::bad_alloc();
+      std::memcpy(static_cast<void *>(grown), static_cast<void const *>(data()), size_ * sizeof(T));
+      std::free(heap_);
+      heap_ = grown;
+      capacity_ = capacity;
+    }
+
+    void resize(size_type const size, T const & value = T()) {
+      if(size > capacity_) reserve(std::max(size, capacity_ * 2));
+      std::fill(data() + std::min(size, size_), data() + size, value);
+      size_ = size;
+    }
+
+    template<typename Iterator>
+    void assign(Iterator first, Iterator last) {
+      clear();
+      reserve(static_cast<size_type>(std::distance(first, last)));
+      for(; first != last; ++first) {
+        data()[size_++] = *first;
+      }
+    }
+
+    void push_back(T const & value) {
+      if(size_ == capacity_) {
+        // The value may live in the storage about to be replaced
+        T const copy(value);
+        reserve(capacity_ * 2);
+        data()[size_++] = copy;
+      } else {
+        data()[size_++] = value;
+      }
+    }
+
+    void pop_back() {
+      --size_;
+    }
+
+    iterator erase(const_iterator const position) {
+      auto const index(position - begin());
+      std::memmove(static_cast<void *>(data() + index), static_cast<void const *>(data() + index + 1), (size_ - index - 1) * sizeof(T));
+      --size_;
+      return data() + index;
+    }
+
+    void clear() {
+      size_ = 0;
+    }
+
+  private:
+    typename std::aligned_storage<sizeof(T) * Capacity, alignof(T)>::type storage_;
+    T * heap_;
+    size_type size_;
+    size_type capacity_;
+
+    // Heap storage changes hands, inline elements are copied
+    void take(small_vector & other) {
+      if(other.heap_) {
+        heap_ = other.heap_;
+        capacity_ = other.capacity_;
+        other.heap_ = nullptr;
+        other.capacity_ = Capacity;
+      } else {
+        std::memcpy(static_cast<void *>(data()), static_cast<void const *>(other.data()), other.size_ * sizeof(T));
+      }
+      size_ = other.size_;
+      other.size_ = 0;
+    }
+  };
+
+}
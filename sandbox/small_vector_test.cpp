@@ -0,0 +1,120 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "small_vector.hpp"
+#include "shape.hpp"
+
+BOOST_AUTO_TEST_SUITE(small_vector)
+
+typedef sandbox::small_vector<int, 4> ints_t;
+
+BOOST_AUTO_TEST_CASE(growth) {
+  ints_t ints;
+  BOOST_CHECK(ints.empty());
+  for(int i(0); i < 4; ++i) ints.push_back(i);
+  BOOST_CHECK(!ints.allocated());
+  BOOST_CHECK_EQUAL(ints.capacity(), 4u);
+
+  // Spills to the heap and keeps what was inline
+  ints.push_back(ints[0]);
+  BOOST_CHECK(ints.allocated());
+  BOOST_REQUIRE_EQUAL(ints.size(), 5u);
+  for(int i(0); i < 4; ++i) BOOST_CHECK_EQUAL(ints[i], i);
+  BOOST_CHECK_EQUAL(ints.back(), 0);
+
+  ints.erase(ints.begin() + 1);
+  BOOST_CHECK_EQUAL(ints.size(), 4u);
+  BOOST_CHECK_EQUAL(ints[1], 2);
+  BOOST_CHECK_EQUAL(ints[3], 0);
+
+  ints.resize(6, 7);
+  BOOST_CHECK_EQUAL(ints.size(), 6u);
+  BOOST_CHECK_EQUAL(ints[5], 7);
+  ints.clear();
+  BOOST_CHECK(ints.empty());
+}
+
+BOOST_AUTO_TEST_CASE(copy_and_move) {
+  ints_t const small { 1, 2, 3 };
+  ints_t const large { 1, 2, 3, 4, 5, 6 };
+
+  ints_t copy(small);
+  BOOST_CHECK(!copy.allocated());
+  BOOST_CHECK(std::equal(small.begin(), small.end(), copy.begin()));
+  copy = large;
+  BOOST_CHECK_EQUAL(copy.size(), 6u);
+  BOOST_CHECK(std::equal(large.begin(), large.end(), copy.begin()));
+
+  // Heap storage is handed over rather than copied
+  auto const data(copy.data());
+  ints_t moved(std::move(copy));
+  BOOST_CHECK_EQUAL(moved.data(), data);
+  BOOST_CHECK(copy.empty());
+  BOOST_CHECK(!copy.allocated());
+
+  ints_t inline_moved(small);
+  moved = std::move(inline_moved);
+  BOOST_CHECK(!moved.allocated());
+  BOOST_CHECK(std::equal(small.begin(), small.end(), moved.begin()));
+}
+
+BOOST_AUTO_TEST_CASE(relocation) {
+  // Copying the bytes elsewhere leaves a working container, inline or not
+  for(auto const & ints : { ints_t { 1, 2 }, ints_t { 1, 2, 3, 4, 5 } }) {
+    ints_t source(ints);
+    std::aligned_storage<sizeof(ints_t), alignof(ints_t)>::type storage;
+    std::memcpy(static_cast<void *>(&storage), static_cast<void const *>(&source), sizeof(ints_t));
+    new (&source) ints_t();
+
+    auto & relocated(*reinterpret_cast<ints_t *>(&storage));
+    BOOST_CHECK(std::equal(ints.begin(), ints.end(), relocated.begin()));
+    relocated.push_back(9);
+    BOOST_CHECK_EQUAL(relocated.back(), 9);
+    relocated.~ints_t();
+  }
+}
+
+BOOST_AUTO_TEST_CASE(shape) {
+  // A box in screen coordinates and the same box wound the other way
+  std::vector<sandbox::vector> vertices { { 0, 0 }, { 20, 0 }, { 20, 10 }, { 0, 10 } };
+  sandbox::shape const box(vertices);
+  std::reverse(vertices.begin(), vertices.end());
+  sandbox::shape const reversed(vertices);
+
+  BOOST_CHECK(!box.vertices().allocated());
+  BOOST_CHECK_CLOSE(std::abs(box.area()), 200.0f, 1e-4f);
+  BOOST_CHECK_CLOSE(box.centroid().x(), 10.0f, 1e-4f);
+  BOOST_CHECK_CLOSE(box.centroid().y(), 5.0f, 1e-4f);
+  BOOST_CHECK_CLOSE(reversed.centroid().x(), 10.0f, 1e-4f);
+
+  // Normals point away from the centroid whatever the winding
+  for(auto const & polygon : { box, reversed }) {
+    auto const & points(polygon.vertices());
+    BOOST_REQUIRE_EQUAL(polygon.normals().size(), points.size());
+    for(std::size_t i(0); i < points.size(); ++i) {
+      auto const & normal(polygon.normals()[i]);
+      BOOST_CHECK_CLOSE(normal.length(), 1.0f, 1e-4f);
+      BOOST_CHECK_GT(normal.dot(points[i] - polygon.centroid()), 0.0f);
+      BOOST_CHECK_SMALL(normal.dot(points[(i + 1) % points.size()] - points[i]), 1e-4f);
+    }
+  }
+
+  // Transforming carries the cached values along instead of recomputing them
+  sandbox::shape moved;
+  box.transform(sandbox::vector(100, 50), 0.5f, moved);
+  sandbox::shape const rebuilt(std::vector<sandbox::vector>(moved.vertices().begin(), moved.vertices().end()));
+  BOOST_CHECK_CLOSE(moved.area(), rebuilt.area(), 1e-3f);
+  BOOST_CHECK_CLOSE(moved.centroid().x(), rebuilt.centroid().x(), 1e-3f);
+  BOOST_CHECK_CLOSE(moved.centroid().y(), rebuilt.centroid().y(), 1e-3f);
+  for(std::size_t i(0); i < moved.normals().size(); ++i) {
+    BOOST_CHECK_SMALL(moved.normals()[i].x() - rebuilt.normals()[i].x(), 1e-5f);
+    BOOST_CHECK_SMALL(moved.normals()[i].y() - rebuilt.normals()[i].y(), 1e-5f);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,472 @@
+#include "snapshot.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace sandbox {
+
+  namespace {
+
+    char const magic[8] = { 'S', 'B', 'X', 'S', 'N', 'A', 'P', '\0' };
+    std::uint32_t const byte_order(0x01020304);
+
+    enum section_t : std::uint32_t {
+      world_section = 1,
+      materials_section,
+      shapes_section,
+      points_section,
+      objects_section,
+      contacts_section
+    };
+
+    std::uint32_t const caches_flag(1);
+
+    // Object flags
+    std::uint32_t const kinematic_flag(1);
+    std::uint32_t const sleeping_flag(2);
+    std::uint32_t const woken_flag(4);
+
+    // Contact flags
+    std::uint32_t const touching_flag(1);
+    std::uint32_t const face_flag(2);
+
+    struct header {
+      char magic[8];
+      std::uint32_t version;
+      std::uint32_t byte_order;
+      std::uint32_t flags;
+      std::uint32_t sections;
+      std::uint64_t size;
+    };
+
+    struct section {
+      std::uint32_t kind;
+      std::uint32_t record_size;
+      std::uint64_t offset;
+      std::uint64_t count;
+    };
+
+    struct world_record {
+      float width;
+      float height;
+      float time;
+      float accumulator;
+      std::uint32_t deterministic;
+      std::uint32_t allow_sleeping;
+      float linear_sleep_tolerance;
+      float angular_sleep_tolerance;
+      float time_to_sleep;
+      std::uint32_t broadphase;
+      std::uint32_t narrowphase;
+      std::uint32_t solver;
+      float linear_threshold;
+      float angular_threshold;
+      std::uint32_t impulse_iterations;
+      std::uint32_t correction;
+      float baumgarte;
+      float slop;
+      float friction;
+      std::uint32_t contact_iterations;
+      float tolerance;
+      float cell_size;
+    };
+
+    struct material_record {
+      float density;
+      float restitution;
+      float color[4];
+    };
+
+    // Vertices are [first, first + count) of the points, the center of a
+    // circle and the ends of a capsule for round shapes
+    struct shape_record {
+      std::uint32_t kind;
+      std::uint32_t first;
+      std::uint32_t count;
+      float radius;
+    };
+
+    struct point_record {
+      float x;
+      float y;
+    };
+
+    struct object_record {
+      std::uint32_t shape;
+      std::uint32_t material;
+      std::uint32_t flags;
+      std::uint32_t sleep_link;
+      point_record position;
+      float orientation;
+      point_record linear_velocity;
+      float angular_velocity;
+      float sleep_time;
+    };
+
+    struct contact_record {
+      point_record ap;
+      point_record bp;
+      point_record normal;
+      float force;
+      float impulse;
+    };
+
+    struct entry_record {
+      std::uint32_t a;
+      std::uint32_t b;
+      std::uint32_t collider;
+      std::uint32_t flags;
+      contact_record contact;
+      contact_record second;
+      point_record a_position;
+      point_record b_position;
+      float a_orientation;
+      float b_orientation;
+    };
+
+    static_assert(sizeof(header) == 32 && sizeof(section) == 24, "snapshot header is padded");
+    static_assert(sizeof(world_record) == 88 && sizeof(object_record) == 44 && sizeof(entry_record) == 104, "snapshot records are padded");
+
+    std::uint64_t aligned(std::uint64_t const offset) {
+      return (offset + 7) & ~std::uint64_t(7);
+    }
+
+    std::uint32_t bits(float const value) {
+      std::uint32_t result;
+      std::memcpy(&result, &value, sizeof(result));
+      return result;
+    }
+
+    point_record point(vector const & value) {
+      return { value.x(), value.y() };
+    }
+
+    vector point(point_record const & value) {
+      return vector(value.x, value.y);
+    }
+
+    contact_record record(contact const & value) {
+      return { point(value.ap()), point(value.bp()), point(value.normal()), value.force(), value.impulse() };
+    }
+
+    // Sections to write, the records already laid out in memory
+    struct part {
+      section_t kind;
+      std::uint32_t record_size;
+      std::uint64_t count;
+      void const * data;
+    };
+
+    template<typename Record>
+    part make_part(section_t const kind, std::vector<Record> const & records) {
+      return { kind, static_cast<std::uint32_t>(sizeof(Record)), records.size(), records.data() };
+    }
+
+    class reader {
+    public:
+      reader(unsigned char const * const data, std::size_t const size) : data_(data), size_(size) {
+        if(size_ < sizeof(header) || std::memcmp(data_, magic, sizeof(magic))) throw std::runtime_error("Not a snapshot");
+        std::memcpy(&header_, data_, sizeof(header_));
+        if(header_.byte_order != byte_order) throw std::runtime_error("Snapshot of another byte order");
+        if(header_.version == 0 || header_.version > snapshot_version) throw std::runtime_error("Unsupported snapshot version " + std::to_string(header_.version));
+        if(header_.size > size_ || sizeof(header) + header_.sections * sizeof(section) > header_.size) throw std::runtime_error("Truncated snapshot");
+
+        for(std::uint32_t index(0); index < header_.sections; ++index) {
+          section entry;
+          std::memcpy(&entry, data_ + sizeof(header) + index * sizeof(section), sizeof(entry));
+          if(entry.offset > header_.size || (entry.count && entry.record_size > (header_.size - entry.offset) / entry.count)) throw std::runtime_error("Truncated snapshot");
+          sections_.push_back(entry);
+        }
+      }
+
+      std::uint32_t flags() const {
+        return header_.flags;
+      }
+
+      // Records of the kind, copied out since a mapping need not be aligned.
+      // Newer writers may add fields at the end, those are skipped.
+      template<typename Record>
+      std::vector<Record> read(section_t const kind, bool const required = true) const {
+        std::vector<Record> records;
+        for(auto const & entry : sections_) {
+          if(entry.kind != kind) continue;
+          if(entry.record_size < sizeof(Record)) throw std::runtime_error("Snapshot records too small");
+          records.resize(static_cast<std::size_t>(entry.count));
+          for(std::size_t index(0); index < records.size(); ++index) {
+            std::memcpy(&records[index], data_ + entry.offset + index * entry.record_size, sizeof(Record));
+          }
+          return records;
+        }
+        if(required) throw std::runtime_error("Snapshot section " + std::to_string(kind) + " missing");
+        return records;
+      }
+
+    private:
+      unsigned char const * const data_;
+      std::size_t const size_;
+      header header_;
+      std::vector<section> sections_;
+    };
+
+    void check(bool const valid, char const * const what) {
+      if(!valid) throw std::runtime_error(std::string("Invalid snapshot: ") + what);
+    }
+
+  }
+
+  bool is_snapshot(void const * const data, std::size_t const size) {
+    return size >= sizeof(magic) && !std::memcmp(data, magic, sizeof(magic));
+  }
+
+  void save_snapshot(simulation const & simulation, std::ostream & stream, bool const caches) {
+    auto const & objects(simulation.objects_);
+    auto const & bodies(simulation.bodies_);
+    auto const & impulse_solver(simulation.impulse_solver_);
+
+    std::vector<world_record> const world(1, world_record {
+      simulation.width_, simulation.height_, simulation.time_, simulation.accumulator_,
+      simulation.deterministic_, simulation.allow_sleeping_,
+      simulation.linear_sleep_tolerance_, simulation.angular_sleep_tolerance_, simulation.time_to_sleep_,
+      static_cast<std::uint32_t>(simulation.broadphase_), static_cast<std::uint32_t>(simulation.narrowphase_), static_cast<std::uint32_t>(simulation.solver_),
+      simulation.contact_cache_.linear_threshold(), simulation.contact_cache_.angular_threshold(),
+      static_cast<std::uint32_t>(impulse_solver.iterations()), static_cast<std::uint32_t>(impulse_solver.correction()),
+      impulse_solver.baumgarte(), impulse_solver.slop(), impulse_solver.friction(),
+      static_cast<std::uint32_t>(simulation.contact_solver_.iterations()), simulation.contact_solver_.tolerance(),
+      simulation.spatial_hash_.cell_size()
+    });
+
+    // Islands, rest times and contacts belong to the bodies of the last step,
+    // objects added since would start them over on the next one
+    bool const stepped(bodies.synchronized(objects));
+    std::vector<char> woken(objects.size(), 0);
+    if(stepped) {
+      for(auto const body : bodies.woken()) woken[body] = 1;
+    }
+
+    std::vector<material_record> materials;
+    std::vector<shape_record> shapes;
+    std::vector<point_record> points;
+    std::vector<object_record> records;
+    std::map<std::vector<std::uint32_t>, std::uint32_t> material_indices, shape_indices;
+    std::vector<std::uint32_t> key;
+
+    records.reserve(objects.size());
+    for(std::size_t index(0); index < objects.size(); ++index) {
+      auto const & object(*objects[index]);
+
+      auto const & material(object.getMaterial());
+      auto const & color(material.getColor());
+      material_record const material_entry = { material.density(), material.restitution(), { color.red(), color.green(), color.blue(), color.alpha() } };
+      key.assign({ bits(material_entry.density), bits(material_entry.restitution), bits(color.red()), bits(color.green()), bits(color.blue()), bits(color.alpha()) });
+      auto const material_index(material_indices.emplace(key, static_cast<std::uint32_t>(materials.size())).first->second);
+      if(material_index == materials.size()) materials.push_back(material_entry);
+
+      auto const & shape(object.getShape());
+      auto const & vertices(shape.vertices());
+      key.assign({ static_cast<std::uint32_t>(shape.kind()), bits(shape.radius()) });
+      for(auto const & vertex : vertices) {
+        key.push_back(bits(vertex.x()));
+        key.push_back(bits(vertex.y()));
+      }
+      auto const shape_index(shape_indices.emplace(key, static_cast<std::uint32_t>(shapes.size())).first->second);
+      if(shape_index == shapes.size()) {
+        shapes.push_back({ static_cast<std::uint32_t>(shape.kind()), static_cast<std::uint32_t>(points.size()), static_cast<std::uint32_t>(vertices.size()), shape.radius() });
+        for(auto const & vertex : vertices) points.push_back(point(vertex));
+      }
+
+      std::uint32_t const flags((object.kinematic() ? kinematic_flag : 0) | (object.sleeping() ? sleeping_flag : 0) | (woken[index] ? woken_flag : 0));
+      records.push_back({
+        shape_index, material_index, flags,
+        static_cast<std::uint32_t>(stepped ? simulation.sleep_links_[index] : index),
+        point(object.position()), object.orientation(), point(object.linear_velocity()), object.angular_velocity(),
+        stepped ? bodies.sleep_times()[index] : 0.0f
+      });
+    }
+
+    std::vector<entry_record> entries;
+    if(caches && stepped) {
+      for(auto const & entry : simulation.contact_cache_.entries()) {
+        std::uint32_t const flags((entry.touching ? touching_flag : 0) | (entry.face ? face_flag : 0));
+        entries.push_back({
+          static_cast<std::uint32_t>(entry.pair.first), static_cast<std::uint32_t>(entry.pair.second), static_cast<std::uint32_t>(entry.collider), flags,
+          record(entry.contact), record(entry.second),
+          point(entry.a_position), point(entry.b_position), entry.a_orientation, entry.b_orientation
+        });
+      }
+    }
+
+    std::vector<part> parts;
+    parts.push_back(make_part(world_section, world));
+    parts.push_back(make_part(materials_section, materials));
+    parts.push_back(make_part(shapes_section, shapes));
+    parts.push_back(make_part(points_section, points));
+    parts.push_back(make_part(objects_section, records));
+    if(caches) parts.push_back(make_part(contacts_section, entries));
+
+    std::vector<section> table;
+    auto offset(aligned(sizeof(header) + parts.size() * sizeof(section)));
+    for(auto const & part : parts) {
+      table.push_back({ part.kind, part.record_size, offset, part.count });
+      offset = aligned(offset + part.record_size * part.count);
+    }
+
+    header head;
+    std::memcpy(head.magic, magic, sizeof(magic));
+    head.version = snapshot_version;
+    head.byte_order = byte_order;
+    head.flags = caches ? caches_flag : 0;
+    head.sections = static_cast<std::uint32_t>(parts.size());
+    head.size = offset;
+
+    char const padding[8] = {};
+    std::uint64_t written(sizeof(head) + table.size() * sizeof(section));
+    stream.write(reinterpret_cast<char const *>(&head), sizeof(head));
+    stream.write(reinterpret_cast<char const *>(table.data()), table.size() * sizeof(section));
+    for(std::size_t index(0); index < parts.size(); ++index) {
+      stream.write(padding, table[index].offset - written);
+      stream.write(static_cast<char const *>(parts[index].data), parts[index].record_size * parts[index].count);
+      written = table[index].offset + parts[index].record_size * parts[index].count;
+    }
+    stream.write(padding, head.size - written);
+  }
+
+  std::shared_ptr<simulation> load_snapshot(void const * const data, std::size_t const size) {
+    reader const reader(static_cast<unsigned char const *>(data), size);
+
+    auto const world(reader.read<world_record>(world_section));
+    auto const materials(reader.read<material_record>(materials_section));
+    auto const shapes(reader.read<shape_record>(shapes_section));
+    auto const points(reader.read<point_record>(points_section));
+    auto const records(reader.read<object_record>(objects_section));
+    auto const entries(reader.read<entry_record>(contacts_section, false));
+
+    check(world.size() == 1, "one world");
+    auto const & settings(world[0]);
+    check(settings.broadphase <= static_cast<std::uint32_t>(simulation::broadphase_t::spatial_hash), "broadphase");
+    check(settings.narrowphase <= static_cast<std::uint32_t>(simulation::narrowphase_t::sat), "narrowphase");
+    check(settings.solver <= static_cast<std::uint32_t>(simulation::solver_t::sequential_impulse), "solver");
+    check(settings.correction <= static_cast<std::uint32_t>(impulse_solver::correction_t::split_impulse), "correction");
+
+    std::shared_ptr<simulation> result(new simulation(settings.width, settings.height));
+    result->time_ = settings.time;
+    result->accumulator_ = settings.accumulator;
+    result->deterministic(settings.deterministic != 0);
+    result->allow_sleeping_ = settings.allow_sleeping != 0;
+    result->linear_sleep_tolerance_ = settings.linear_sleep_tolerance;
+    result->angular_sleep_tolerance_ = settings.angular_sleep_tolerance;
+    result->time_to_sleep_ = settings.time_to_sleep;
+    result->broadphase_ = static_cast<simulation::broadphase_t>(settings.broadphase);
+    result->narrowphase_ = static_cast<simulation::narrowphase_t>(settings.narrowphase);
+    result->solver_ = static_cast<simulation::solver_t>(settings.solver);
+    result->contact_cache_.linear_threshold(settings.linear_threshold);
+    result->contact_cache_.angular_threshold(settings.angular_threshold);
+    result->impulse_solver_.iterations(settings.impulse_iterations);
+    result->impulse_solver_.correction(static_cast<impulse_solver::correction_t>(settings.correction));
+    result->impulse_solver_.baumgarte(settings.baumgarte);
+    result->impulse_solver_.slop(settings.slop);
+    result->impulse_solver_.friction(settings.friction);
+    result->contact_solver_.iterations(settings.contact_iterations);
+    result->contact_solver_.tolerance(settings.tolerance);
+    result->spatial_hash_.cell_size(settings.cell_size);
+
+    // Built once and copied into every object using them
+    std::vector<material> built_materials;
+    built_materials.reserve(materials.size());
+    for(auto const & entry : materials) {
+      built_materials.emplace_back(entry.density, entry.restitution, color<>(entry.color[0], entry.color[1], entry.color[2], entry.color[3]));
+    }
+
+    std::vector<shape> built_shapes;
+    built_shapes.reserve(shapes.size());
+    for(auto const & entry : shapes) {
+      check(entry.first <= points.size() && entry.count <= points.size() - entry.first, "shape points");
+      auto const first(points.begin() + entry.first);
+      switch(static_cast<shape::kind_t>(entry.kind)) {
+        case shape::kind_t::polygon:
+        case shape::kind_t::box: {
+          check(entry.count >= 3, "polygon vertices");
+          std::vector<vector> vertices;
+          for(auto point(first); point != first + entry.count; ++point) vertices.push_back(sandbox::point(*point));
+          built_shapes.push_back(shape(vertices));
+          break;
+        }
+
+        case shape::kind_t::circle:
+          check(entry.count == 1, "circle center");
+          built_shapes.push_back(shape::circle(entry.radius, point(first[0])));
+          break;
+
+        case shape::kind_t::capsule:
+          check(entry.count == 2, "capsule ends");
+          built_shapes.push_back(shape::capsule(point(first[0]), point(first[1]), entry.radius));
+          break;
+
+        default:
+          check(false, "shape kind");
+      }
+    }
+
+    auto & objects(result->objects_);
+    std::vector<char> sleeping(records.size());
+    std::vector<std::size_t> sleep_links(records.size());
+    std::vector<float> sleep_times(records.size());
+    std::vector<std::size_t> woken;
+    objects.reserve(records.size());
+    for(std::size_t index(0); index < records.size(); ++index) {
+      auto const & entry(records[index]);
+      check(entry.shape < built_shapes.size() && entry.material < built_materials.size(), "object shape or material");
+      check(entry.sleep_link < records.size(), "sleep link");
+
+      std::shared_ptr<object> const created(new object(built_shapes[entry.shape], built_materials[entry.material]));
+      created->position(point(entry.position));
+      created->orientation(entry.orientation);
+      created->linear_velocity(point(entry.linear_velocity));
+      created->angular_velocity(entry.angular_velocity);
+      created->kinematic((entry.flags & kinematic_flag) != 0);
+      objects.push_back(created);
+
+      sleeping[index] = (entry.flags & sleeping_flag) != 0;
+      sleep_links[index] = entry.sleep_link;
+      sleep_times[index] = entry.sleep_time;
+      if(entry.flags & woken_flag) woken.push_back(index);
+    }
+
+    std::vector<contact_cache::entry> cache;
+    cache.reserve(entries.size());
+    for(auto const & record : entries) {
+      check(record.a < records.size() && record.b < records.size(), "contact pair");
+      check(record.collider <= static_cast<std::uint32_t>(collider_t::capsule), "contact collider");
+
+      contact_cache::entry entry;
+      entry.pair = std::make_pair(record.a, record.b);
+      entry.collider = static_cast<collider_t>(record.collider);
+      entry.touching = (record.flags & touching_flag) != 0;
+      entry.face = (record.flags & face_flag) != 0;
+      auto const restore([&](contact_record const & value, bool const set) {
+        if(!set) return contact(0, 0, vector(), vector(), vector(), value.force, value.impulse);
+        return contact(record.a, record.b, point(value.ap), point(value.bp), point(value.normal), value.force, value.impulse);
+      });
+      entry.contact = restore(record.contact, entry.touching);
+      entry.second = restore(record.second, entry.face);
+      entry.a_position = point(record.a_position);
+      entry.b_position = point(record.b_position);
+      entry.a_orientation = record.a_orientation;
+      entry.b_orientation = record.b_orientation;
+      cache.push_back(entry);
+    }
+
+    result->restore(sleeping, sleep_links, sleep_times, woken, cache);
+    return result;
+  }
+
+  std::shared_ptr<simulation> load_snapshot(std::istream & stream) {
+    std::vector<char> const data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return load_snapshot(data.data(), data.size());
+  }
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+
+#include "simulation.hpp"
+
+namespace sandbox {
+
+  // Whole simulations in binary, to checkpoint long runs and to branch many
+  // runs off one settled state. A snapshot holds the world and its settings,
+  // every object with its shape, material and state, the sleeping islands,
+  // and optionally the contact cache, without which the first step after a
+  // load computes every contact anew and starts the solvers cold.
+  //
+  // The layout is a header, a table of sections and the sections themselves,
+  // flat arrays of fixed size records of 32 bit integers and floats in the
+  // writer's byte order, each starting 8 byte aligned:
+  //
+  //   header    magic "SBXSNAP", version, byte order mark, flags, section
+  //             count, total size
+  //   table     per section its kind, record size, offset and record count
+  //   sections  world, materials, shapes, points, objects and contacts
+  //
+  // Shapes and materials are stored once and referenced by index. Readers
+  // use the first bytes of every record they know, so later versions can
+  // grow records. Loading reads the sections in place from memory, a mapped
+  // file for instance, and needs no text parsing, but still copies the
+  // records out and builds every object and shape the simulation holds.
+
+  std::uint32_t const snapshot_version(1);
+
+  // Paused between steps; caches adds the contact cache
+  void save_snapshot(simulation const & simulation, std::ostream & stream, bool const caches = false);
+
+  // Throws std::runtime_error for anything but a snapshot of a supported
+  // version and this byte order, or one cut short
+  std::shared_ptr<simulation> load_snapshot(void const * const data, std::size_t const size);
+  std::shared_ptr<simulation> load_snapshot(std::istream & stream);
+
+  // Whether data starts like a snapshot, to tell them from scene files
+  bool is_snapshot(void const * const data, std::size_t const size);
+
+}
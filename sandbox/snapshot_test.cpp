@@ -0,0 +1,172 @@
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "snapshot.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(snapshot)
+
+std::shared_ptr<sandbox::simulation> pile(sandbox::simulation::solver_t const solver) {
+  std::shared_ptr<sandbox::simulation> const simulation(new sandbox::simulation(400, 400));
+  simulation->solver(solver);
+  simulation->allow_sleeping(true);
+
+  sandbox::material const material(1.0f, 0.2f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+  sandbox::material const heavy(4.0f, 0.1f, sandbox::color<>(0.5f, 0.5f, 0.5f, 1.0f));
+
+  std::shared_ptr<sandbox::object> const floor(new sandbox::object(sandbox::shape(sandbox::rectangle(400, 40).vertices()), material));
+  floor->position(sandbox::vector(200, 380));
+  floor->kinematic(true);
+  simulation->objects().push_back(floor);
+
+  for(unsigned int y(0); y < 5; ++y) {
+    for(unsigned int x(0); x < 10; ++x) {
+      auto const kind((x + y) % 3);
+      sandbox::shape const shape(kind == 0 ? sandbox::shape::circle(9.0f) : kind == 1 ? sandbox::shape::capsule(sandbox::vector(-6, 0), sandbox::vector(6, 0), 5.0f) : sandbox::shape(sandbox::rectangle(18, 18).vertices()));
+      std::shared_ptr<sandbox::object> const object(new sandbox::object(shape, y % 2 ? heavy : material));
+      object->position(sandbox::vector(80 + x * 24.0f + y % 2 * 6.0f, 345 - y * 22.0f));
+      object->angular_velocity((x % 2 ? 0.5f : -0.5f));
+      simulation->objects().push_back(object);
+    }
+  }
+  return simulation;
+}
+
+void run(sandbox::simulation & simulation, unsigned int const steps) {
+  for(unsigned int i(0); i < steps; ++i) {
+    simulation.step(0.005f, 0.005f);
+  }
+}
+
+std::string save(sandbox::simulation const & simulation, bool const caches) {
+  std::ostringstream stream;
+  sandbox::save_snapshot(simulation, stream, caches);
+  return stream.str();
+}
+
+BOOST_AUTO_TEST_CASE(round_trip) {
+  for(auto const solver : { sandbox::simulation::solver_t::force, sandbox::simulation::solver_t::sequential_impulse }) {
+    auto const original(pile(solver));
+    run(*original, 100);
+    auto const data(save(*original, true));
+    BOOST_CHECK(sandbox::is_snapshot(data.data(), data.size()));
+    BOOST_CHECK_EQUAL(data.size() % 8, 0);
+
+    auto const loaded(sandbox::load_snapshot(data.data(), data.size()));
+    BOOST_CHECK_EQUAL(loaded->objects().size(), original->objects().size());
+    BOOST_CHECK(loaded->solver() == solver);
+    BOOST_CHECK(loaded->allow_sleeping());
+    BOOST_CHECK_EQUAL(loaded->state_hash(), original->state_hash());
+    BOOST_CHECK(loaded->objects()[1]->getShape().kind() == original->objects()[1]->getShape().kind());
+    BOOST_CHECK(loaded->objects()[2]->getShape().kind() == sandbox::shape::kind_t::capsule);
+
+    // With the contact cache the two carry on step for step
+    run(*original, 100);
+    run(*loaded, 100);
+    BOOST_CHECK_EQUAL(loaded->state_hash(), original->state_hash());
+
+    // Saving the loaded one again gives the same bytes
+    BOOST_CHECK(save(*loaded, true) == save(*original, true));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(stream) {
+  auto const original(pile(sandbox::simulation::solver_t::sequential_impulse));
+  run(*original, 50);
+  auto const data(save(*original, false));
+
+  std::istringstream stream(data);
+  auto const loaded(sandbox::load_snapshot(stream));
+  BOOST_CHECK_EQUAL(loaded->state_hash(), sandbox::load_snapshot(data.data(), data.size())->state_hash());
+  BOOST_CHECK_EQUAL(loaded->getContactCache().size(), 0);
+  BOOST_CHECK_EQUAL(loaded->time(), original->time());
+
+  // Without the cache the state differs only in contacts
+  BOOST_CHECK_EQUAL(loaded->objects()[5]->position().x(), original->objects()[5]->position().x());
+  BOOST_CHECK_EQUAL(loaded->objects()[5]->angular_velocity(), original->objects()[5]->angular_velocity());
+  run(*loaded, 10);
+}
+
+BOOST_AUTO_TEST_CASE(sleeping) {
+  std::shared_ptr<sandbox::simulation> const original(new sandbox::simulation(400, 400));
+  original->solver(sandbox::simulation::solver_t::sequential_impulse);
+
+  sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+  auto const add([&](sandbox::vector const & position, float const width, float const height) {
+    std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(width, height).vertices()), material));
+    object->position(position);
+    original->objects().push_back(object);
+    return object;
+  });
+  add(sandbox::vector(200, 380), 400, 40)->kinematic(true);
+  for(unsigned int x(0); x < 4; ++x) {
+    for(unsigned int y(0); y < 3; ++y) {
+      add(sandbox::vector(60 + x * 80.0f, 350 - y * 20.0f), 20, 20);
+    }
+  }
+  auto const falling(add(sandbox::vector(300, 220), 20, 20));
+  falling->linear_velocity(sandbox::vector(0, 50));
+  run(*original, 200);
+  BOOST_REQUIRE(original->objects()[1]->sleeping());
+  BOOST_REQUIRE(!falling->sleeping());
+
+  auto const data(save(*original, true));
+  auto const loaded(sandbox::load_snapshot(data.data(), data.size()));
+  for(std::size_t index(0); index < original->objects().size(); ++index) {
+    BOOST_CHECK_EQUAL(loaded->objects()[index]->sleeping(), original->objects()[index]->sleeping());
+  }
+  BOOST_CHECK(loaded->awake() == original->awake());
+
+  // The falling box lands on a sleeping column in both and wakes it
+  run(*original, 200);
+  run(*loaded, 200);
+  BOOST_CHECK(!original->objects()[10]->sleeping() || !original->objects()[12]->sleeping());
+  BOOST_CHECK_EQUAL(loaded->state_hash(), original->state_hash());
+
+  // A push from outside as well
+  original->objects()[1]->linear_velocity(sandbox::vector(0, -50));
+  loaded->objects()[1]->linear_velocity(sandbox::vector(0, -50));
+  run(*original, 50);
+  run(*loaded, 50);
+  BOOST_CHECK_EQUAL(loaded->state_hash(), original->state_hash());
+}
+
+BOOST_AUTO_TEST_CASE(unstepped) {
+  // Objects added since the last step start over like they would have
+  auto const original(pile(sandbox::simulation::solver_t::force));
+  auto const data(save(*original, true));
+  auto const loaded(sandbox::load_snapshot(data.data(), data.size()));
+  run(*original, 20);
+  run(*loaded, 20);
+  BOOST_CHECK_EQUAL(loaded->state_hash(), original->state_hash());
+}
+
+BOOST_AUTO_TEST_CASE(invalid) {
+  auto const original(pile(sandbox::simulation::solver_t::force));
+  run(*original, 10);
+  auto data(save(*original, true));
+
+  std::string const scene("world 100 100\n");
+  BOOST_CHECK(!sandbox::is_snapshot(scene.data(), scene.size()));
+  BOOST_CHECK_THROW(sandbox::load_snapshot(scene.data(), scene.size()), std::runtime_error);
+
+  // Cut short anywhere
+  for(auto const size : { std::size_t(4), std::size_t(40), data.size() / 2, data.size() - 8 }) {
+    BOOST_CHECK_THROW(sandbox::load_snapshot(data.data(), size), std::runtime_error);
+  }
+
+  // A newer version names itself
+  auto newer(data);
+  newer[8] = static_cast<char>(sandbox::snapshot_version + 1);
+  try {
+    sandbox::load_snapshot(newer.data(), newer.size());
+    BOOST_FAIL("loaded a newer version");
+  } catch(std::runtime_error const & error) {
+    BOOST_CHECK_EQUAL(error.what(), "Unsupported snapshot version " + std::to_string(sandbox::snapshot_version + 1));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
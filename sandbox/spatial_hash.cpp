@@ -0,0 +1,166 @@
+#include "spatial_hash.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sandbox {
+
+  namespace {
+
+    // Cell coordinates are clamped well inside the int32 range, so the packed
+    // key of the minimum corner never shows up as a real cell
+    std::int32_t const cell_limit(1 << 30);
+    std::uint64_t const empty_key(0x8000000080000000ull);
+
+    // Boxes covering more cells than this are kept out of the grid
+    std::size_t const large_cells(16);
+
+    std::uint64_t pack(std::int32_t const x, std::int32_t const y) {
+      return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(y);
+    }
+
+  }
+
+  void spatial_hash::update(std::vector<rectangle> const & bounding_boxes) {
+    pairs_.clear();
+    cells_ = 0;
+    if(bounding_boxes.empty()) return;
+
+    large_flags_.resize(bounding_boxes.size());
+    auto const total(parallel_reduce(0, bounding_boxes.size(), std::size_t(0), [&](std::size_t & count, std::size_t const body) {
+      auto const cells(range(bounding_boxes[body]));
+      auto const covered(static_cast<std::size_t>(cells.x1 - cells.x0 + 1) * static_cast<std::size_t>(cells.y1 - cells.y0 + 1));
+      large_flags_[body] = covered > large_cells;
+      if(!large_flags_[body]) count += covered;
+    }, [](std::size_t & count, std::size_t && partial) {
+      count += partial;
+    }));
+
+    large_.clear();
+    for(std::size_t body(0); body < bounding_boxes.size(); ++body) {
+      if(large_flags_[body]) large_.push_back(body);
+    }
+
+    // At most half full even if every entry lands in its own cell
+    std::size_t capacity(64);
+    while(capacity < total * 2) capacity *= 2;
+    if(capacity > capacity_) {
+      capacity_ = capacity;
+      keys_.reset(new std::atomic<std::uint64_t>[capacity_]);
+      counts_.reset(new std::atomic<std::uint32_t>[capacity_]);
+      offsets_.resize(capacity_ + 1);
+    }
+    entries_.resize(total);
+
+    parallel_for(0, capacity_, [&](std::size_t const slot) {
+      keys_[slot].store(empty_key, std::memory_order_relaxed);
+      counts_[slot].store(0, std::memory_order_relaxed);
+    }, 1024);
+
+    parallel_for(0, bounding_boxes.size(), [&](std::size_t const body) {
+      if(large_flags_[body]) return;
+      auto const cells(range(bounding_boxes[body]));
+      for(auto y(cells.y0); y <= cells.y1; ++y) {
+        for(auto x(cells.x0); x <= cells.x1; ++x) {
+          counts_[insert(pack(x, y))].fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    });
+
+    // Entries are grouped by slot, the counts become fill cursors
+    std::uint32_t offset(0);
+    for(std::size_t slot(0); slot < capacity_; ++slot) {
+      offsets_[slot] = offset;
+      auto const count(counts_[slot].load(std::memory_order_relaxed));
+      offset += count;
+      if(count) ++cells_;
+      counts_[slot].store(0, std::memory_order_relaxed);
+    }
+    offsets_[capacity_] = offset;
+
+    parallel_for(0, bounding_boxes.size(), [&](std::size_t const body) {
+      if(large_flags_[body]) return;
+      auto const cells(range(bounding_boxes[body]));
+      for(auto y(cells.y0); y <= cells.y1; ++y) {
+        for(auto x(cells.x0); x <= cells.x1; ++x) {
+          auto const slot(find(pack(x, y)));
+          entries_[offsets_[slot] + counts_[slot].fetch_add(1, std::memory_order_relaxed)] = static_cast<std::uint32_t>(body);
+        }
+      }
+    });
+
+    pair_buffers_.clear();
+    parallel_for(0, capacity_, [&](std::size_t const slot) {
+      auto const begin(offsets_[slot]);
+      auto const end(offsets_[slot + 1]);
+      if(end - begin < 2) return;
+
+      auto const key(keys_[slot].load(std::memory_order_relaxed));
+      auto const x(static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 32)));
+      auto const y(static_cast<std::int32_t>(static_cast<std::uint32_t>(key)));
+      auto & buffer(pair_buffers_.local());
+
+      for(auto i(begin); i < end; ++i) {
+        auto const a(entries_[i]);
+        auto const & a_box(bounding_boxes[a]);
+        for(auto j(i + 1); j < end; ++j) {
+          auto const b(entries_[j]);
+          auto const & b_box(bounding_boxes[b]);
+          if(!a_box.overlaps(b_box)) continue;
+
+          // Both boxes cover the cell of the intersection's top left corner
+          auto const corner_x(cell(std::max(a_box.top_left().x(), b_box.top_left().x())));
+          auto const corner_y(cell(std::max(a_box.top_left().y(), b_box.top_left().y())));
+          if(corner_x == x && corner_y == y) {
+            buffer.emplace_back(std::min(a, b), std::max(a, b));
+          }
+        }
+      }
+    }, 256);
+
+    // Oversized boxes are tested against every body, each pair once
+    if(!large_.empty()) {
+      parallel_for(0, bounding_boxes.size(), [&](std::size_t const body) {
+        auto & buffer(pair_buffers_.local());
+        for(auto const large : large_) {
+          if(large_flags_[body] && large >= body) break;
+          if(large != body && bounding_boxes[large].overlaps(bounding_boxes[body])) {
+            buffer.emplace_back(std::min(large, body), std::max(large, body));
+          }
+        }
+      });
+    }
+    pair_buffers_.merge(pairs_);
+  }
+
+  std::int32_t spatial_hash::cell(float const value) const {
+    auto const cell(std::floor(value / cell_size_));
+    return static_cast<std::int32_t>(std::max<float>(-cell_limit, std::min<float>(cell_limit, cell)));
+  }
+
+  spatial_hash::cell_range spatial_hash::range(rectangle const & bounding_box) const {
+    return { cell(bounding_box.top_left().x()), cell(bounding_box.top_left().y()), cell(bounding_box.bottom_right().x()), cell(bounding_box.bottom_right().y()) };
+  }
+
+  std::size_t spatial_hash::slot(std::uint64_t const key) const {
+    // Fibonacci hashing, capacity is a power of two
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & (capacity_ - 1);
+  }
+
+  std::size_t spatial_hash::insert(std::uint64_t const key) {
+    for(auto index(slot(key));; index = (index + 1) & (capacity_ - 1)) {
+      auto current(keys_[index].load(std::memory_order_relaxed));
+      if(current == empty_key && keys_[index].compare_exchange_strong(current, key, std::memory_order_relaxed)) {
+        return index;
+      }
+      if(current == key) return index;
+    }
+  }
+
+  std::size_t spatial_hash::find(std::uint64_t const key) const {
+    for(auto index(slot(key));; index = (index + 1) & (capacity_ - 1)) {
+      if(keys_[index].load(std::memory_order_relaxed) == key) return index;
+    }
+  }
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "rectangle.hpp"
+#include "misc.hpp"
+
+namespace sandbox {
+
+  // Uniform grid broadphase for bodies of similar size. Occupied cells live in
+  // an open-addressing table that keeps its storage between updates, bodies
+  // are inserted into it in parallel and then grouped per cell. A pair is only
+  // reported by the cell holding the top left corner of the intersection of
+  // the two boxes, so bodies sharing several cells need no de-duplication.
+  // Boxes much larger than a cell, like walls, bypass the grid and are tested
+  // against every body instead.
+  class spatial_hash {
+  public:
+    typedef std::pair<std::size_t, std::size_t> pair_t;
+
+    spatial_hash(float const cell_size = 32.0f) : cell_size_(cell_size), capacity_(0), cells_(0) {
+    }
+
+    float cell_size() const {
+      return cell_size_;
+    }
+
+    void cell_size(float const value) {
+      cell_size_ = value;
+    }
+
+    // Occupied cells after the last update
+    std::size_t cells() const {
+      return cells_;
+    }
+
+    // Overlapping pairs from the last update, sorted, each as (a, b) with a < b
+    std::vector<pair_t> const & pairs() const {
+      return pairs_;
+    }
+
+    void update(std::vector<rectangle> const & bounding_boxes);
+
+  private:
+    struct cell_range {
+      std::int32_t x0, y0, x1, y1;
+    };
+
+    float cell_size_;
+
+    std::size_t capacity_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> keys_;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> counts_;
+    std::vector<std::uint32_t> offsets_;
+    std::vector<std::uint32_t> entries_;
+    std::size_t cells_;
+
+    std::vector<char> large_flags_;
+    std::vector<std::size_t> large_;
+
+    thread_buffers<pair_t> pair_buffers_;
+    std::vector<pair_t> pairs_;
+
+    std::int32_t cell(float const value) const;
+    cell_range range(rectangle const & bounding_box) const;
+
+    std::size_t slot(std::uint64_t const key) const;
+    std::size_t insert(std::uint64_t const key);
+    std::size_t find(std::uint64_t const key) const;
+  };
+
+}
@@ -0,0 +1,45 @@
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+#include "spatial_hash.hpp"
+#include "test_fixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(spatial_hash)
+
+BOOST_AUTO_TEST_CASE(pairs) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(-100.0f, 200.0f);
+  std::uniform_real_distribution<float> movement(-2.0f, 2.0f);
+
+  std::vector<sandbox::rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 300; ++i) {
+    sandbox::vector const top_left(position(generator), position(generator));
+    bounding_boxes.emplace_back(top_left, top_left + sandbox::vector(20.0f, 20.0f));
+  }
+  // Boxes touching on a cell border and a floor spanning many cells
+  bounding_boxes.emplace_back(sandbox::vector(300.0f, 300.0f), sandbox::vector(320.0f, 320.0f));
+  bounding_boxes.emplace_back(sandbox::vector(320.0f, 300.0f), sandbox::vector(340.0f, 320.0f));
+  bounding_boxes.emplace_back(sandbox::vector(-100.0f, 210.0f), sandbox::vector(240.0f, 230.0f));
+
+  auto & scheduler(sandbox::scheduler::instance());
+  scheduler.concurrency(4);
+
+  for(auto const cell_size : { 8.0f, 20.0f, 32.0f, 100.0f }) {
+    sandbox::spatial_hash spatial_hash(cell_size);
+    auto boxes(bounding_boxes);
+    for(unsigned int step(0); step < 10; ++step) {
+      spatial_hash.update(boxes);
+      BOOST_REQUIRE(spatial_hash.pairs() == test::brute_force(boxes));
+
+      for(auto & bounding_box : boxes) {
+        sandbox::vector const offset(movement(generator), movement(generator));
+        bounding_box = sandbox::rectangle(bounding_box.top_left() + offset, bounding_box.bottom_right() + offset);
+      }
+    }
+  }
+
+  scheduler.concurrency(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+#include "sweep_and_prune.hpp"
+
+#include <algorithm>
+
+namespace sandbox {
+
+  namespace {
+
+    float axis_value(vector const & vertex, int const axis) {
+      return axis ? vertex.y() : vertex.x();
+    }
+
+    // Picks the axis along which box centers are spread the most, with some
+    // hysteresis so that the endpoints are not re-sorted from scratch often
+    int spread_axis(std::vector<rectangle> const & bounding_boxes, int const current) {
+      double sum_x(0.0), sum_y(0.0), sum_xx(0.0), sum_yy(0.0);
+      for(auto const & bounding_box : bounding_boxes) {
+        auto const center((bounding_box.top_left() + bounding_box.bottom_right()) * 0.5f);
+        sum_x += center.x();
+        sum_y += center.y();
+        sum_xx += center.x() * center.x();
+        sum_yy += center.y() * center.y();
+      }
+      double const n(static_cast<double>(bounding_boxes.size()));
+      double const variance_x(sum_xx - sum_x * sum_x / n);
+      double const variance_y(sum_yy - sum_y * sum_y / n);
+      if(current) return variance_x > variance_y * 1.25 ? 0 : 1;
+      return variance_y > variance_x * 1.25 ? 1 : 0;
+    }
+
+  }
+
+  void sweep_and_prune::update(std::vector<rectangle> const & bounding_boxes) {
+    pairs_.clear();
+    if(bounding_boxes.empty()) {
+      endpoints_.clear();
+      return;
+    }
+
+    auto const axis(spread_axis(bounding_boxes, axis_));
+    if(axis != axis_ || endpoints_.size() != bounding_boxes.size() * 2) {
+      axis_ = axis;
+      rebuild(bounding_boxes);
+    } else {
+      for(auto & endpoint : endpoints_) {
+        auto const & bounding_box(bounding_boxes[endpoint.id >> 1]);
+        endpoint.value = axis_value(endpoint.id & 1 ? bounding_box.bottom_right() : bounding_box.top_left(), axis_);
+      }
+
+      // Insertion sort, endpoints only move a few slots between steps
+      for(std::size_t i(1); i < endpoints_.size(); ++i) {
+        auto const current(endpoints_[i]);
+        auto j(i);
+        for(; j > 0 && current < endpoints_[j - 1]; --j) {
+          endpoints_[j] = endpoints_[j - 1];
+        }
+        endpoints_[j] = current;
+      }
+    }
+
+    sweep(bounding_boxes);
+  }
+
+  void sweep_and_prune::rebuild(std::vector<rectangle> const & bounding_boxes) {
+    endpoints_.resize(bounding_boxes.size() * 2);
+    for(std::size_t body(0); body < bounding_boxes.size(); ++body) {
+      auto const & bounding_box(bounding_boxes[body]);
+      endpoints_[body * 2] = { axis_value(bounding_box.top_left(), axis_), static_cast<std::uint32_t>(body * 2) };
+      endpoints_[body * 2 + 1] = { axis_value(bounding_box.bottom_right(), axis_), static_cast<std::uint32_t>(body * 2 + 1) };
+    }
+    std::sort(endpoints_.begin(), endpoints_.end());
+  }
+
+  void sweep_and_prune::sweep(std::vector<rectangle> const & bounding_boxes) {
+    int const other(1 - axis_);
+    active_.clear();
+    active_index_.resize(bounding_boxes.size());
+
+    for(auto const & endpoint : endpoints_) {
+      std::size_t const body(endpoint.id >> 1);
+      if(endpoint.id & 1) {
+        auto const index(active_index_[body]);
+        active_[index] = active_.back();
+        active_index_[active_[index]] = index;
+        active_.pop_back();
+      } else {
+        auto const & bounding_box(bounding_boxes[body]);
+        auto const minimum(axis_value(bounding_box.top_left(), other));
+        auto const maximum(axis_value(bounding_box.bottom_right(), other));
+        for(auto const candidate : active_) {
+          auto const & candidate_box(bounding_boxes[candidate]);
+          if(axis_value(candidate_box.top_left(), other) <= maximum && minimum <= axis_value(candidate_box.bottom_right(), other)) {
+            pairs_.emplace_back(std::min(body, candidate), std::max(body, candidate));
+          }
+        }
+        active_index_[body] = active_.size();
+        active_.push_back(body);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "rectangle.hpp"
+
+namespace sandbox {
+
+  // Sort-and-sweep broadphase. Box endpoints along one axis are kept sorted
+  // between updates, so re-sorting them with insertion sort is close to linear
+  // when bodies move little from step to step. The axis with the largest
+  // spread of box centers is used.
+  class sweep_and_prune {
+  public:
+    typedef std::pair<std::size_t, std::size_t> pair_t;
+
+    sweep_and_prune() : axis_(0) {
+    }
+
+    int axis() const {
+      return axis_;
+    }
+
+    // Overlapping pairs from the last update, each reported once as (a, b)
+    // with a < b
+    std::vector<pair_t> const & pairs() const {
+      return pairs_;
+    }
+
+    void update(std::vector<rectangle> const & bounding_boxes);
+
+    // Forgets the endpoint order, for when the boxes passed in no longer
+    // belong to the bodies they did before
+    void clear() {
+      endpoints_.clear();
+      pairs_.clear();
+    }
+
+  private:
+    struct endpoint {
+      float value;
+      // Body index times two, plus one for the maximum endpoint
+      std::uint32_t id;
+
+      bool operator <(endpoint const & rhs) const {
+        return value < rhs.value || (value == rhs.value && (id & 1) < (rhs.id & 1));
+      }
+    };
+
+    int axis_;
+    std::vector<endpoint> endpoints_;
+    std::vector<std::size_t> active_;
+    std::vector<std::size_t> active_index_;
+    std::vector<pair_t> pairs_;
+
+    void rebuild(std::vector<rectangle> const & bounding_boxes);
+    void sweep(std::vector<rectangle> const & bounding_boxes);
+  };
+
+}
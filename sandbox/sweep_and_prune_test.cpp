@@ -0,0 +1,41 @@
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+
+#include "sweep_and_prune.hpp"
+#include "test_fixtures.hpp"
+
+BOOST_AUTO_TEST_SUITE(sweep_and_prune)
+
+BOOST_AUTO_TEST_CASE(pairs) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(0.0f, 200.0f);
+  std::uniform_real_distribution<float> movement(-2.0f, 2.0f);
+
+  std::vector<sandbox::rectangle> bounding_boxes;
+  for(unsigned int i(0); i < 200; ++i) {
+    sandbox::vector const top_left(position(generator), position(generator));
+    bounding_boxes.emplace_back(top_left, top_left + sandbox::vector(10.0f, 10.0f));
+  }
+  // Touching boxes overlap, same as rectangle::overlaps
+  bounding_boxes.emplace_back(sandbox::vector(300.0f, 300.0f), sandbox::vector(310.0f, 310.0f));
+  bounding_boxes.emplace_back(sandbox::vector(310.0f, 300.0f), sandbox::vector(320.0f, 310.0f));
+
+  sandbox::sweep_and_prune sweep_and_prune;
+  for(unsigned int step(0); step < 20; ++step) {
+    sweep_and_prune.update(bounding_boxes);
+
+    auto pairs(sweep_and_prune.pairs());
+    std::sort(pairs.begin(), pairs.end());
+    auto const expected(test::brute_force(bounding_boxes));
+    BOOST_REQUIRE(pairs == expected);
+
+    for(auto & bounding_box : bounding_boxes) {
+      sandbox::vector const offset(movement(generator), movement(generator));
+      bounding_box = sandbox::rectangle(bounding_box.top_left() + offset, bounding_box.bottom_right() + offset);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "bodies.hpp"
+#include "color.hpp"
+#include "contact.hpp"
+#include "object.hpp"
+#include "rectangle.hpp"
+
+// Fixtures shared by the test suites
+namespace test {
+
+  // A kinematic floor with boxes in columns resting on it, two contacts
+  // between every box and whatever is below it at the box's bottom corners,
+  // normals pointing up. All contacts form one island unless every column is
+  // given its own.
+  struct scene {
+    std::vector<std::unique_ptr<sandbox::object>> objects;
+    sandbox::bodies bodies;
+    std::vector<sandbox::contact> contacts;
+    std::vector<std::size_t> offsets;
+
+    scene(std::size_t const columns, std::size_t const rows, bool const separate = false) : offsets(1, 0) {
+      sandbox::material const material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f));
+      float const floor(20.0f * rows);
+
+      objects.emplace_back(new sandbox::object(sandbox::shape(sandbox::rectangle(40.0f * columns, 20).vertices()), material));
+      objects.back()->position(sandbox::vector(20.0f * columns, floor + 10.0f));
+      objects.back()->kinematic(true);
+      for(std::size_t column(0); column < columns; ++column) {
+        for(std::size_t row(0); row < rows; ++row) {
+          objects.emplace_back(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), material));
+          objects.back()->position(sandbox::vector(40.0f * column + 20.0f, floor - 10.0f - 20.0f * row));
+        }
+      }
+
+      for(auto const & object : objects) {
+        bodies.add(*object);
+      }
+
+      for(std::size_t column(0); column < columns; ++column) {
+        for(std::size_t row(0); row < rows; ++row) {
+          auto const a(1 + column * rows + row);
+          auto const b(row ? a - 1 : 0);
+          auto const x(bodies.positions()[a].x());
+          auto const y(bodies.positions()[a].y() + 10.0f);
+          contacts.emplace_back(a, b, sandbox::vector(x - 10, y), sandbox::vector(x - 10, y), sandbox::vector(0, -1));
+          contacts.emplace_back(a, b, sandbox::vector(x + 10, y), sandbox::vector(x + 10, y), sandbox::vector(0, -1));
+        }
+        if(separate) offsets.push_back(contacts.size());
+      }
+      if(!separate) offsets.push_back(contacts.size());
+    }
+
+    // Gravity as the external force on every box, for the contact solver
+    void gravity() {
+      for(std::size_t body(1); body < bodies.size(); ++body) {
+        bodies.forces()[body] = sandbox::vector(0.0f, 9.81f);
+        bodies.torques()[body] = 0.0f;
+      }
+    }
+
+    // One step of gravity on the velocities, for the impulse solver
+    void gravity(float const time_step) {
+      for(std::size_t body(1); body < bodies.size(); ++body) {
+        bodies.linear_velocities()[body] += sandbox::vector(0.0f, 9.81f * time_step);
+      }
+    }
+  };
+
+  // Every overlapping pair of bounding boxes, the lower index first, sorted
+  inline std::vector<std::pair<std::size_t, std::size_t>> brute_force(std::vector<sandbox::rectangle> const & bounding_boxes) {
+    std::vector<std::pair<std::size_t, std::size_t>> pairs;
+    for(std::size_t a(0); a < bounding_boxes.size(); ++a) {
+      for(std::size_t b(a + 1); b < bounding_boxes.size(); ++b) {
+        if(bounding_boxes[a].overlaps(bounding_boxes[b])) pairs.emplace_back(a, b);
+      }
+    }
+    return pairs;
+  }
+
+}
@@ -0,0 +1,85 @@
+#include "trace.hpp"
+
+#include "scheduler.hpp"
+
+namespace sandbox {
+
+  std::size_t const tracer::capacity;
+  thread_local tracer::ring * tracer::local_(nullptr);
+
+  tracer & tracer::instance() {
+    static tracer instance;
+    return instance;
+  }
+
+  tracer::tracer() : enabled_(false), frame_(0), start_(std::chrono::steady_clock::now()) {
+  }
+
+  tracer::ring & tracer::local() {
+    if(local_) return *local_;
+
+    // Once per thread; the ring stays after the thread is gone so its events
+    // can still be written
+    std::unique_ptr<ring> created(new ring());
+    created->queue = scheduler::current();
+    created->head = 0;
+    created->events.resize(capacity);
+
+    std::lock_guard<std::mutex> const lock(mutex_);
+    created->thread = rings_.size();
+    rings_.push_back(std::move(created));
+    local_ = rings_.back().get();
+    return *local_;
+  }
+
+  void tracer::record(char const * const name, char const phase) {
+    auto & ring(local());
+    auto const head(ring.head.load(std::memory_order_relaxed));
+    auto & event(ring.events[head % capacity]);
+    event.name = name;
+    event.time = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+    event.frame = frame();
+    event.phase = phase;
+    ring.head.store(head + 1, std::memory_order_release);
+  }
+
+  void tracer::clear() {
+    std::lock_guard<std::mutex> const lock(mutex_);
+    for(auto & ring : rings_) {
+      ring->head.store(0, std::memory_order_relaxed);
+    }
+    frame_ = 0;
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void tracer::write(std::ostream & stream, std::uint32_t const first, std::uint32_t const last) const {
+    std::lock_guard<std::mutex> const lock(mutex_);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool separate(false);
+    for(auto const & ring : rings_) {
+      stream << (separate ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->thread << ",\"args\":{\"name\":\"";
+      if(ring->queue) {
+        stream << "worker " << ring->queue;
+      } else {
+        stream << "thread " << ring->thread;
+      }
+      stream << "\"}}";
+      separate = true;
+
+      // Overwritten events are gone, an end may have lost its begin
+      auto const head(ring->head.load(std::memory_order_acquire));
+      auto const begin(head > capacity ? head - capacity : 0);
+      for(auto index(begin); index < head; ++index) {
+        auto const & event(ring->events[index % capacity]);
+        if(event.frame < first || event.frame > last) continue;
+        stream << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":" << ring->thread
+               << ",\"ts\":" << event.time / 1000 << '.' << static_cast<char>('0' + event.time / 100 % 10) << static_cast<char>('0' + event.time / 10 % 10) << static_cast<char>('0' + event.time % 10)
+               << ",\"args\":{\"frame\":" << event.frame << "}}";
+      }
+    }
+
+    stream << "\n]}\n";
+  }
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Scheduler tasks and simulation stages are only traced when built with
+// SANDBOX_TRACE defined, otherwise the hooks expand to nothing
+#define SANDBOX_TRACE_JOIN(a, b) a##b
+#define SANDBOX_TRACE_NAME(line) SANDBOX_TRACE_JOIN(trace_scope_, line)
+
+#ifdef SANDBOX_TRACE
+#define SANDBOX_TRACE_SCOPE(name) sandbox::tracer::scope const SANDBOX_TRACE_NAME(__LINE__)(name)
+#define SANDBOX_TRACE_FRAME() sandbox::tracer::instance().advance()
+#else
+#define SANDBOX_TRACE_SCOPE(name)
+#define SANDBOX_TRACE_FRAME()
+#endif
+
+namespace sandbox {
+
+  // Timeline of begin and end events for the Chrome trace viewer and
+  // Perfetto. Every thread records into a ring buffer of its own, so recording
+  // takes no locks and the oldest events of a thread make room for new ones.
+  // Events carry the frame they happened in, one frame per call to
+  // simulation::step, so a range of frames can be written out. Recording is
+  // off until enabled.
+  class tracer {
+  public:
+    static std::size_t const capacity = 1 << 16;
+
+    // Records begin on construction and end on destruction when enabled
+    class scope {
+    public:
+      explicit scope(char const * const name) : name_(instance().enabled() ? name : nullptr) {
+        if(name_) instance().begin(name_);
+      }
+
+      ~scope() {
+        if(name_) instance().end(name_);
+      }
+
+      scope(scope const &) = delete;
+      scope & operator =(scope const &) = delete;
+
+    private:
+      char const * const name_;
+    };
+
+    static tracer & instance();
+
+    bool enabled() const {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void enabled(bool const value) {
+      enabled_.store(value, std::memory_order_relaxed);
+    }
+
+    std::uint32_t frame() const {
+      return frame_.load(std::memory_order_relaxed);
+    }
+
+    void advance() {
+      frame_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Names must outlive the tracer, string literals do
+    void begin(char const * const name) {
+      record(name, 'B');
+    }
+
+    void end(char const * const name) {
+      record(name, 'E');
+    }
+
+    // Drops every recorded event and restarts the frames and the clock.
+    // Threads must not be recording meanwhile.
+    void clear();
+
+    // Writes the events of frames [first, last] as Chrome trace JSON, to be
+    // called while no thread records
+    void write(std::ostream & stream, std::uint32_t const first = 0, std::uint32_t const last = std::numeric_limits<std::uint32_t>::max()) const;
+
+  private:
+    struct event {
+      char const * name;
+      std::uint64_t time;
+      std::uint32_t frame;
+      char phase;
+    };
+
+    // Written by its thread only, read by write()
+    struct ring {
+      std::size_t thread;
+      std::size_t queue;
+      std::atomic<std::size_t> head;
+      std::vector<event> events;
+    };
+
+    std::atomic<bool> enabled_;
+    std::atomic<std::uint32_t> frame_;
+    std::chrono::steady_clock::time_point start_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<ring>> rings_;
+    static thread_local ring * local_;
+
+    tracer();
+
+    tracer(tracer const &) = delete;
+    tracer & operator =(tracer const &) = delete;
+
+    ring & local();
+    void record(char const * const name, char const phase);
+  };
+
+}
@@ -0,0 +1,114 @@
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+#include "simulation.hpp"
+#include "color.hpp"
+
+BOOST_AUTO_TEST_SUITE(trace)
+
+std::size_t occurrences(std::string const & text, std::string const & pattern) {
+  std::size_t count(0);
+  for(auto found(text.find(pattern)); found != std::string::npos; found = text.find(pattern, found + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+std::string write(std::uint32_t const first = 0, std::uint32_t const last = 0xffffffff) {
+  std::ostringstream stream;
+  sandbox::tracer::instance().write(stream, first, last);
+  return stream.str();
+}
+
+BOOST_AUTO_TEST_CASE(record) {
+  auto & tracer(sandbox::tracer::instance());
+  tracer.clear();
+
+  // Nothing is kept while disabled
+  {
+    sandbox::tracer::scope const scope("ignored");
+  }
+  BOOST_CHECK_EQUAL(occurrences(write(), "ignored"), 0u);
+
+  tracer.enabled(true);
+  for(unsigned int frame(0); frame < 3; ++frame) {
+    tracer.advance();
+    sandbox::tracer::scope const outer("outer");
+    sandbox::tracer::scope const inner("inner");
+  }
+
+  std::vector<std::thread> threads;
+  for(unsigned int thread(0); thread < 2; ++thread) {
+    threads.emplace_back([]() {
+      sandbox::tracer::scope const scope("threaded");
+    });
+  }
+  for(auto & thread : threads) thread.join();
+  tracer.enabled(false);
+  BOOST_CHECK_EQUAL(tracer.frame(), 3u);
+
+  auto const all(write());
+  BOOST_CHECK_EQUAL(all.find("{\"displayTimeUnit\""), 0u);
+  BOOST_CHECK_EQUAL(occurrences(all, "\"name\":\"outer\",\"ph\":\"B\""), 3u);
+  BOOST_CHECK_EQUAL(occurrences(all, "\"name\":\"inner\",\"ph\":\"E\""), 3u);
+  BOOST_CHECK_EQUAL(occurrences(all, "\"name\":\"threaded\",\"ph\":\"B\""), 2u);
+  BOOST_CHECK_GE(occurrences(all, "\"thread_name\""), 3u);
+
+  // Frames filter, the threads recorded in the last one
+  auto const second(write(2, 2));
+  BOOST_CHECK_EQUAL(occurrences(second, "\"name\":\"outer\""), 2u);
+  BOOST_CHECK_EQUAL(occurrences(second, "\"frame\":2"), 4u);
+  BOOST_CHECK_EQUAL(occurrences(second, "threaded"), 0u);
+
+  tracer.clear();
+  BOOST_CHECK_EQUAL(tracer.frame(), 0u);
+  BOOST_CHECK_EQUAL(occurrences(write(), "\"ph\":\"B\""), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(wrap) {
+  auto & tracer(sandbox::tracer::instance());
+  tracer.clear();
+  tracer.enabled(true);
+  for(std::size_t event(0); event < sandbox::tracer::capacity + 10; ++event) {
+    tracer.begin("event");
+  }
+  tracer.enabled(false);
+
+  // The oldest events made room for the newest
+  BOOST_CHECK_EQUAL(occurrences(write(), "\"name\":\"event\""), sandbox::tracer::capacity);
+  tracer.clear();
+}
+
+BOOST_AUTO_TEST_CASE(step) {
+  sandbox::simulation simulation(400, 400);
+  std::shared_ptr<sandbox::object> const object(new sandbox::object(sandbox::shape(sandbox::rectangle(20, 20).vertices()), sandbox::material(1.0f, 0.0f, sandbox::color<>(1.0f, 1.0f, 1.0f, 1.0f))));
+  object->position(sandbox::vector(200, 200));
+  simulation.objects().push_back(object);
+
+  auto & tracer(sandbox::tracer::instance());
+  tracer.clear();
+  tracer.enabled(true);
+  simulation.step(0.02f, 0.01f);
+  simulation.step(0.01f, 0.01f);
+  tracer.enabled(false);
+
+  auto const trace(write(2, 2));
+#ifdef SANDBOX_TRACE
+  BOOST_CHECK_EQUAL(tracer.frame(), 2u);
+  BOOST_CHECK_EQUAL(occurrences(trace, "\"name\":\"step\",\"ph\":\"B\""), 1u);
+  BOOST_CHECK_EQUAL(occurrences(trace, "\"name\":\"broadphase\",\"ph\":\"B\""), 1u);
+  BOOST_CHECK_EQUAL(occurrences(trace, "\"name\":\"integrate\",\"ph\":\"E\""), 1u);
+  BOOST_CHECK_EQUAL(occurrences(write(1, 1), "\"name\":\"collisions\",\"ph\":\"B\""), 2u);
+#else
+  BOOST_CHECK_EQUAL(tracer.frame(), 0u);
+  BOOST_CHECK_EQUAL(occurrences(trace, "\"ph\":\"B\""), 0u);
+#endif
+  tracer.clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END()